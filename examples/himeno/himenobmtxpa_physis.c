@@ -352,15 +352,13 @@ void jacobi_kernel(int i, int j, int k,
   PSGridEmit(p1, v);
   return;
 }
-#if 0
-void gosa_kernel(int i, int j, int k, PSGrid3DFloat p,
-                 PSGrid3DFloat a0, PSGrid3DFloat a1,
-                 PSGrid3DFloat a2, PSGrid3DFloat a3,
-                 PSGrid3DFloat b0, PSGrid3DFloat b1,
-                 PSGrid3DFloat b2, PSGrid3DFloat c0,
-                 PSGrid3DFloat c1, PSGrid3DFloat c2,
-                 PSGrid3DFloat c3, PSGrid3DFloat bnd,
-                 PSGrid3DFloat wrk1, float omega)
+float gosa_kernel(int i, int j, int k, PSGrid3DFloat p,
+                  PSGrid3DFloat a0, PSGrid3DFloat a1,
+                  PSGrid3DFloat a2, PSGrid3DFloat a3,
+                  PSGrid3DFloat b0, PSGrid3DFloat b1,
+                  PSGrid3DFloat b2, PSGrid3DFloat c0,
+                  PSGrid3DFloat c1, PSGrid3DFloat c2,
+                  PSGrid3DFloat bnd, PSGrid3DFloat wrk1)
 {
   float s0, ss;
   s0= PSGridGet(a0, i, j, k) * PSGridGet(p, i+1, j, k)
@@ -381,10 +379,9 @@ void gosa_kernel(int i, int j, int k, PSGrid3DFloat p,
       + PSGridGet(wrk1, i, j, k);
   ss = (s0 * PSGridGet(a3, i, j, k) - PSGridGet(p, i, j, k))
        * PSGridGet(bnd, i, j, k);
-  PSGridEmit(p, ss*ss);
-  return;
+  return ss*ss;
 }
-#endif
+
 float
 jacobi(int nn, PSGrid3DFloat a0, PSGrid3DFloat a1, PSGrid3DFloat a2,
        PSGrid3DFloat a3, PSGrid3DFloat b0, PSGrid3DFloat b1,
@@ -408,12 +405,9 @@ jacobi(int nn, PSGrid3DFloat a0, PSGrid3DFloat a1, PSGrid3DFloat a2,
                             p1, p0, a0, a1, a2, a3, b0, b1, b2,
                             c0, c1, c2, bnd, wrk1, omega),
                nn/2);
-               
-               /* PSStencilRun(PSStencilMap(gosa_kernel, innerDom, */
-  /*                           wrk1, p0, a0, a1, a2, a3, */
-  /*                           b0, b1, b2, c0, c1, c2, bnd, wrk1, omega)); */
-  
-  //gosa = grid_reduce(innerDom, wrk1, float_sum);
+
+  PSReduce(&gosa, PS_SUM, gosa_kernel, innerDom,
+           p0, a0, a1, a2, a3, b0, b1, b2, c0, c1, c2, bnd, wrk1);
   return gosa;
 }
 
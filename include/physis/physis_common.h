@@ -84,6 +84,13 @@ extern "C" {
 
   extern void PSGridCopyin(void *g, const void *src_array);
   extern void PSGridCopyout(void *g, void *dst_array);
+  // Read and write a whole grid as a raw array in the same layout as
+  // the arrays of PSGridCopyin and PSGridCopyout
+  extern void PSGridLoadFile(void *g, const char *path);
+  extern void PSGridSaveFile(void *g, const char *path);
+  // Save and restore all grids; only supported in the MPI targets
+  extern void PSCheckpoint();
+  extern void PSRestart();
   //extern int PSGridDim(void *g, int d);
   extern void PSGridFree(void *p);  
 
@@ -97,6 +104,12 @@ extern "C" {
   typedef __PSDomain PSDomain2D;
   typedef __PSDomain PSDomain3D;
 
+  // Registers the static flops and bytes per point of a stencil
+  // applied iter times to the local part of dom.
+  extern void __PSTraceStencilModel(__PSDomain *dom, int num_dims,
+                                    int iter, double flops,
+                                    double bytes);
+
   extern PSDomain1D PSDomain1DNew(PSIndex minx, PSIndex maxx);
   extern PSDomain2D PSDomain2DNew(PSIndex minx, PSIndex maxx,
                                   PSIndex miny, PSIndex maxy);
@@ -84,6 +84,90 @@ extern "C" {
   extern double *__PSGridEmitAddrDouble3D(__PSGridMPI *g, PSIndex x,
                                           PSIndex y, PSIndex z);
 
+  //! Snapshot of the local buffer layout of a grid.
+  /*!
+    Taken once per kernel invocation so that accesses to local points
+    are computed inline. Accesses outside the local buffer, i.e., to
+    halo points, go through the __PSGridGetAddr functions.
+   */
+  typedef struct {
+    void *p;  // read buffer; the remote grid if activated
+    PSIndex offset[PS_MAX_DIM];
+    PSIndex size[PS_MAX_DIM];
+    void *p_emit;  // write buffer
+    PSIndex local_offset[PS_MAX_DIM];
+    PSIndex local_size[PS_MAX_DIM];
+  } __PSGridMPIDesc;
+
+  extern __PSGridMPIDesc __PSGridGetDesc(__PSGridMPI *g);
+
+#define __PS_DESC_IN(d, i, x) \
+  ((x) >= (d)->offset[i] && (x) < (d)->offset[i] + (d)->size[i])
+#define __PS_DESC_OFFSET1D(o, s, x) ((x) - (o)[0])
+#define __PS_DESC_OFFSET2D(o, s, x, y) \
+  (((x) - (o)[0]) + ((y) - (o)[1]) * (s)[0])
+#define __PS_DESC_OFFSET3D(o, s, x, y, z) \
+  (((x) - (o)[0]) + ((y) - (o)[1]) * (s)[0] + \
+   ((z) - (o)[2]) * (s)[0] * (s)[1])
+
+#define __PS_DEFINE_GRID_ADDR_INLINE(type, tname)                       \
+  static inline type *__PSGridGetAddrInline##tname##1D(                 \
+      __PSGridMPI *g, const __PSGridMPIDesc *d, PSIndex x) {            \
+    if (__PS_DESC_IN(d, 0, x))                                          \
+      return (type*)d->p + __PS_DESC_OFFSET1D(d->offset, d->size, x);   \
+    return __PSGridGetAddr##tname##1D(g, x);                            \
+  }                                                                     \
+  static inline type *__PSGridGetAddrInline##tname##2D(                 \
+      __PSGridMPI *g, const __PSGridMPIDesc *d, PSIndex x, PSIndex y) { \
+    if (__PS_DESC_IN(d, 0, x) && __PS_DESC_IN(d, 1, y))                 \
+      return (type*)d->p + __PS_DESC_OFFSET2D(d->offset, d->size, x, y); \
+    return __PSGridGetAddr##tname##2D(g, x, y);                         \
+  }                                                                     \
+  static inline type *__PSGridGetAddrInline##tname##3D(                 \
+      __PSGridMPI *g, const __PSGridMPIDesc *d,                         \
+      PSIndex x, PSIndex y, PSIndex z) {                                \
+    if (__PS_DESC_IN(d, 0, x) && __PS_DESC_IN(d, 1, y) &&               \
+        __PS_DESC_IN(d, 2, z))                                          \
+      return (type*)d->p +                                              \
+          __PS_DESC_OFFSET3D(d->offset, d->size, x, y, z);              \
+    return __PSGridGetAddr##tname##3D(g, x, y, z);                      \
+  }                                                                     \
+  static inline type *__PSGridGetAddrNoHaloInline##tname##1D(           \
+      const __PSGridMPIDesc *d, PSIndex x) {                            \
+    return (type*)d->p_emit +                                           \
+        __PS_DESC_OFFSET1D(d->local_offset, d->local_size, x);          \
+  }                                                                     \
+  static inline type *__PSGridGetAddrNoHaloInline##tname##2D(           \
+      const __PSGridMPIDesc *d, PSIndex x, PSIndex y) {                 \
+    return (type*)d->p_emit +                                           \
+        __PS_DESC_OFFSET2D(d->local_offset, d->local_size, x, y);       \
+  }                                                                     \
+  static inline type *__PSGridGetAddrNoHaloInline##tname##3D(           \
+      const __PSGridMPIDesc *d, PSIndex x, PSIndex y, PSIndex z) {      \
+    return (type*)d->p_emit +                                           \
+        __PS_DESC_OFFSET3D(d->local_offset, d->local_size, x, y, z);    \
+  }                                                                     \
+  static inline type *__PSGridEmitAddrInline##tname##1D(                \
+      const __PSGridMPIDesc *d, PSIndex x) {                            \
+    return (type*)d->p_emit +                                           \
+        __PS_DESC_OFFSET1D(d->local_offset, d->local_size, x);          \
+  }                                                                     \
+  static inline type *__PSGridEmitAddrInline##tname##2D(               \
+      const __PSGridMPIDesc *d, PSIndex x, PSIndex y) {                 \
+    return (type*)d->p_emit +                                           \
+        __PS_DESC_OFFSET2D(d->local_offset, d->local_size, x, y);       \
+  }                                                                     \
+  static inline type *__PSGridEmitAddrInline##tname##3D(                \
+      const __PSGridMPIDesc *d, PSIndex x, PSIndex y, PSIndex z) {      \
+    return (type*)d->p_emit +                                           \
+        __PS_DESC_OFFSET3D(d->local_offset, d->local_size, x, y, z);    \
+  }
+
+  __PS_DEFINE_GRID_ADDR_INLINE(float, Float)
+  __PS_DEFINE_GRID_ADDR_INLINE(double, Double)
+
+#undef __PS_DEFINE_GRID_ADDR_INLINE
+
 
   
   extern void __PSLoadNeighbor(__PSGridMPI *g,
@@ -91,6 +175,35 @@ extern "C" {
                                const PSVectorInt offset_max,
                                int diagonal, int reuse,
                                int overlap, int periodic);
+  //! Starts loading the neighbor points without waiting.
+  /*!
+    Takes the same arguments as __PSLoadNeighbor. The halo regions
+    must not be read until __PSLoadNeighborEnd returns.
+   */
+  extern void __PSLoadNeighborBegin(__PSGridMPI *g,
+                                    const PSVectorInt offset_min,
+                                    const PSVectorInt offset_max,
+                                    int diagonal, int reuse,
+                                    int overlap, int periodic);
+  //! Completes all loads started by __PSLoadNeighborBegin.
+  extern void __PSLoadNeighborEnd();
+  //! Returns the domain without the boundary shell of a given width.
+  extern __PSDomain __PSDomainShrink(__PSDomain *dom, int width);
+  //! Returns the local domain extended into the halo of a given width.
+  /*!
+    The extended domain is limited to the global domain. Used to
+    redundantly compute the halo points between deep halo exchanges.
+   */
+  extern __PSDomain __PSDomainExtend(__PSDomain *dom, int width);
+  //! Returns a part of the boundary shell of a given width.
+  /*!
+    The shell is partitioned into the forward and backward slabs of
+    each dimension. The slabs of a dimension exclude the shell of the
+    higher dimensions, so that the slabs and the shrunk domain do not
+    overlap with each other.
+   */
+  extern __PSDomain __PSDomainGetShell(__PSDomain *dom, int dim,
+                                       int right, int width);
   extern void __PSLoadSubgrid(__PSGridMPI *g, const __PSGridRange *gr,
                               int reuse);
   extern void __PSLoadSubgrid2D(__PSGridMPI *g, 
@@ -110,6 +223,13 @@ extern "C" {
   extern void __PSActivateRemoteGrid(__PSGridMPI *g,
                                      int active);
   extern int __PSIsRoot();
+  //! Ensures grids are padded with halos of at least a given width.
+  /*!
+    Called before PSInit by the translated code for deep halos. The
+    padding is the maximum of this width and the
+    physis-halo-padding option.
+   */
+  extern void __PSSetMinHaloPadding(int width);
 
   //! Reduces a grid with an operator.
   /*!
@@ -121,6 +241,16 @@ extern "C" {
                                   __PSGridMPI *g);
   extern void __PSReduceGridDouble(void *buf, enum PSReduceOp op,
                                   __PSGridMPI *g);
+  //! Combines the local reduction values of all processes.
+  /*!
+    Called by every process to combine the partial results of a
+    kernel reduction. The result is available at all processes.
+    \param v A pointer to the local value, overwritten with the
+    result.
+    \param op A reduction operator.
+   */
+  extern void __PSReduceAllFloat(float *v, enum PSReduceOp op);
+  extern void __PSReduceAllDouble(double *v, enum PSReduceOp op);
 
 #ifdef __cplusplus
 }
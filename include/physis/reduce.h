@@ -9,6 +9,10 @@
 #ifndef PHYSIS_REDUCTION_H_
 #define PHYSIS_REDUCTION_H_
 
+// FLT_MAX and DBL_MAX are used as the identity of max and min in
+// generated code
+#include <float.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
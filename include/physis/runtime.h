@@ -13,23 +13,39 @@
 
 #include "physis/stopwatch.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
 extern FILE *__ps_trace;
+extern int __ps_profile;
+extern void __PSProfileStencilBegin(const char *msg);
+extern void __PSProfileStencilEnd(void);
+extern void __PSTraceStencilPerformance(float time);
 
 static inline void __PSTraceStencilPre(const char *msg) {
   if (__ps_trace) {
+#ifdef _OPENMP
+    fprintf(__ps_trace, "Physis: Stencil started (%s, %d threads)\n",
+            msg, omp_get_max_threads());
+#else
     fprintf(__ps_trace, "Physis: Stencil started (%s)\n", msg);
+#endif
   }
+  if (__ps_profile) __PSProfileStencilBegin(msg);
   return;
 }
 
   static inline void __PSTraceStencilPost(float time) {
   if (__ps_trace) {
     fprintf(__ps_trace, "Physis: Stencil finished (time: %f)\n", time);
+    __PSTraceStencilPerformance(time);
   }
+  if (__ps_profile) __PSProfileStencilEnd();
   return;
 }
 
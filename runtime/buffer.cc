@@ -7,6 +7,7 @@
 // Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
 
 #include "runtime/buffer.h"
+#include "runtime/host_allocator.h"
 
 namespace physis {
 namespace runtime {
@@ -109,11 +110,11 @@ void Buffer::DeleteChunk(void *p) {
 
 BufferHost::BufferHost(size_t elm_size):
     Buffer(elm_size) {
-  deleter_ = free;
+  deleter_ = HostFree;
 }
 BufferHost::BufferHost(int num_dims,  size_t elm_size):
     Buffer(num_dims, elm_size) {
-  deleter_ = free;
+  deleter_ = HostFree;
 }
 
 BufferHost::~BufferHost() {
@@ -181,7 +182,7 @@ void BufferHost::MPIIsend(int dst, MPI_Comm comm, MPI_Request *req,
 void *BufferHost::GetChunk(const IndexArray &size) {
   size_t s = size.accumulate(num_dims_);
   if (s == 0) return NULL;
-  void *p = calloc(elm_size_, s);
+  void *p = HostAlloc(elm_size_ * s);
   PSAssert(p);
   return p;
 }
@@ -128,6 +128,50 @@ extern "C" {
                               cudaMemcpyDeviceToHost));
   }
 
+  void PSGridLoadFile(void *p, const char *path) {
+    __PSGrid *g = (__PSGrid *)p;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+      LOG_ERROR() << "Failed to open " << path << "\n";
+      PSAbort(1);
+    }
+    void *buf = malloc(g->elm_size * g->num_elms);
+    if (fread(buf, g->elm_size, g->num_elms, fp) != (size_t)g->num_elms) {
+      LOG_ERROR() << "Failed to read " << path << "\n";
+      PSAbort(1);
+    }
+    fclose(fp);
+    PSGridCopyin(p, buf);
+    free(buf);
+  }
+
+  void PSGridSaveFile(void *p, const char *path) {
+    __PSGrid *g = (__PSGrid *)p;
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+      LOG_ERROR() << "Failed to open " << path << "\n";
+      PSAbort(1);
+    }
+    void *buf = malloc(g->elm_size * g->num_elms);
+    PSGridCopyout(p, buf);
+    if (fwrite(buf, g->elm_size, g->num_elms, fp) != (size_t)g->num_elms) {
+      LOG_ERROR() << "Failed to write " << path << "\n";
+      PSAbort(1);
+    }
+    fclose(fp);
+    free(buf);
+  }
+  void PSCheckpoint() {
+    LOG_ERROR() << "Checkpointing not supported\n";
+    PSAbort(1);
+  }
+
+  void PSRestart() {
+    LOG_ERROR() << "Checkpointing not supported\n";
+    PSAbort(1);
+  }
+
+
   void __PSGridSwap(__PSGrid *g) {
 #if defined(AUTO_DOUBLE_BUFFERING)
     std::swap(g->p0, g->p1);
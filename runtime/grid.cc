@@ -90,14 +90,7 @@ template <class T>
 int ReduceGrid(Grid *g, PSReduceOp op, T *out) {
   if (g->num_elms() == 0) return 0;
   //LOG_DEBUG() << "Op: " << op << "\n";
-  boost::function<T (T, T)> func = GetReducer<T>(op);
-  T *d = (T *)g->_data();
-  T v = d[0];
-  for (size_t i = 1; i < g->num_elms(); ++i) {
-    v = func(v, d[i]);
-  }
-  //LOG_DEBUG() << "Reduce grid: " << v << "\n";
-  *out = v;
+  *out = ReduceArray<T>(op, (T *)g->_data(), g->num_elms());
   return g->num_elms();
 }
 
@@ -102,7 +102,7 @@ class GridSpace {
   GridSpace() {}
   virtual ~GridSpace() {}
   Grid *FindGrid(int id) const;
-  void DeleteGrid(Grid *g);
+  virtual void DeleteGrid(Grid *g);
   void DeleteGrid(int id);
   //void ReduceGrid(Grid *g, void *buf);
 
@@ -9,10 +9,14 @@
 #include "runtime/grid_mpi.h"
 
 #include <limits.h>
+#include <pthread.h>
+#include <algorithm>
 
 #include "runtime/grid_util.h"
+#include "runtime/host_allocator.h"
 #include "runtime/mpi_util.h"
 #include "runtime/mpi_wrapper.h"
+#include "runtime/profiler.h"
 
 using namespace std;
 
@@ -62,6 +66,8 @@ GridMPI::GridMPI(PSType type, int elm_size, int num_dims,
     Grid(type, elm_size, num_dims, size, double_buffering, attr),
     global_offset_(global_offset),  
     local_offset_(local_offset), local_size_(local_size),
+    halo_padded_(false), local_real_offset_(local_offset),
+    local_real_size_(local_size),
     halo_has_diagonal_(false),
     remote_grid_(NULL), remote_grid_active_(false) {
   
@@ -87,20 +93,37 @@ GridMPI *GridMPI::Create(PSType type, int elm_size,
                          const IndexArray &global_offset,
                          const IndexArray &local_offset,
                          const IndexArray &local_size,
-                         int attr) {
+                         int attr,
+                         const UnsignedArray &halo_fw_max_width,
+                         const UnsignedArray &halo_bw_max_width) {
   GridMPI *gm = new GridMPI(type, elm_size, num_dims, size,
                             double_buffering, global_offset,
                             local_offset, local_size, attr);
+  for (int i = 0; i < num_dims; ++i) {
+    gm->halo_fw_max_width_[i] = halo_fw_max_width[i];
+    gm->halo_bw_max_width_[i] = halo_bw_max_width[i];
+  }
   gm->InitBuffer();
   return gm;
 }
 
 void GridMPI::InitBuffer() {
+  halo_padded_ = !empty_ &&
+      (halo_fw_max_width_ != 0 || halo_bw_max_width_ != 0);
+  local_real_offset_ = local_offset_;
+  local_real_size_ = local_size_;
+  if (halo_padded_) {
+    for (int i = 0; i < num_dims_; ++i) {
+      local_real_offset_[i] -= halo_bw_max_width_[i];
+      local_real_size_[i] += halo_bw_max_width_[i] + halo_fw_max_width_[i];
+    }
+    LOG_DEBUG() << "Padded local size: " << local_real_size_ << "\n";
+  }
   data_buffer_[0] = new BufferHost(num_dims_, elm_size_);
-  data_buffer_[0]->Allocate(local_size_);
+  data_buffer_[0]->Allocate(local_real_size_);
   if (double_buffering_) {
     data_buffer_[1] = new BufferHost(num_dims_, elm_size_);
-    data_buffer_[1]->Allocate(local_size_);    
+    data_buffer_[1]->Allocate(local_real_size_);    
   } else {
     data_buffer_[1] = data_buffer_[0];
   }
@@ -305,6 +328,9 @@ void GridMPI::CopyoutHalo(int dim, unsigned width, bool fw, bool diagonal) {
   }
 
   char *halo_buf = GetHaloBuf(dim, width, fw, diagonal);
+  performance::ProfileScope prof(performance::PROFILE_HALO_PACK,
+                                 CalcHaloSize(dim, width, diagonal)
+                                 * elm_size_);
   
 #if 0  
   LOG_DEBUG() << "FW?: " << fw << ", width: " << width <<
@@ -354,8 +380,12 @@ void GridMPI::Resize(const IndexArray &local_offset,
                      const IndexArray &local_size) {
   // Resizing double buffered object not supported
   PSAssert(!double_buffering_);
+  // Only remote grids are resized, which are never padded.
+  PSAssert(!halo_padded_);
   local_size_ = local_size;
   local_offset_ = local_offset;
+  local_real_size_ = local_size;
+  local_real_offset_ = local_offset;
   buffer()->EnsureCapacity(local_size_);
   FixupBufferPointers();
 }
@@ -376,16 +406,38 @@ template <class T>
 int ReduceGridMPI(GridMPI *g, PSReduceOp op, T *out) {
   size_t nelms = g->local_size().accumulate(g->num_dims());
   if (nelms == 0) return 0;
-  boost::function<T (T, T)> func = GetReducer<T>(op);
   T *d = (T *)g->_data();
-  T v = d[0];
-  for (size_t i = 1; i < nelms; ++i) {
-    v = func(v, d[i]);
+  if (!g->halo_padded()) {
+    *out = ReduceArray<T>(op, d, nelms);
+  } else {
+    // Skip the halo padding
+    *out = ReduceSubarray<T>(op, g->num_dims(), d, g->local_real_size(),
+                             g->local_offset() - g->local_real_offset(),
+                             g->local_size());
   }
-  *out = v;
   return nelms;
 }
 
+void GridMPI::CopyinLocal(const void *buf) {
+  if (empty_) return;
+  if (!halo_padded_) {
+    memcpy(data_[0], buf, local_size_.accumulate(num_dims_) * elm_size_);
+    return;
+  }
+  CopyinSubgrid(elm_size_, num_dims_, data_[0], local_real_size_,
+                buf, local_offset_ - local_real_offset_, local_size_);
+}
+
+void GridMPI::CopyoutLocal(void *buf) {
+  if (empty_) return;
+  if (!halo_padded_) {
+    memcpy(buf, data_[0], local_size_.accumulate(num_dims_) * elm_size_);
+    return;
+  }
+  CopyoutSubgrid(elm_size_, num_dims_, data_[0], local_real_size_,
+                 buf, local_offset_ - local_real_offset_, local_size_);
+}
+
 int GridMPI::Reduce(PSReduceOp op, void *out) {
   int rv = 0;
   switch (type_) {
@@ -460,7 +512,10 @@ GridSpaceMPI::GridSpaceMPI(int num_dims, const IndexArray &global_size,
                            int my_rank):
     num_dims_(num_dims), global_size_(global_size),
     proc_num_dims_(proc_num_dims), proc_size_(proc_size),
-    my_rank_(my_rank), buf(NULL), cur_buf_size(0) {
+    my_rank_(my_rank), halo_padding_(0), simultaneous_exchange_(false),
+    halo_transport_(HALO_TRANSPORT_P2P), shared_comm_(MPI_COMM_NULL),
+    async_checkpoint_(false), checkpoint_comm_(MPI_COMM_NULL),
+    checkpoint_running_(false), buf(NULL), cur_buf_size(0) {
   assert(num_dims_ == proc_num_dims_);
   
   num_procs_ = proc_size_.accumulate(proc_num_dims_);
@@ -496,6 +551,21 @@ GridSpaceMPI::GridSpaceMPI(int num_dims, const IndexArray &global_size,
 
 GridSpaceMPI::~GridSpaceMPI() {
   FREE(buf);
+  // Requests cannot be freed once MPI is finalized
+  int finalized;
+  CHECK_MPI(MPI_Finalized(&finalized));
+  if (!finalized) {
+    FreeHaloExchangePlans(-1);
+    FreeGridWindows(-1);
+    FreeSharedGridBuffers(-1);
+    if (shared_comm_ != MPI_COMM_NULL) {
+      CHECK_MPI(MPI_Comm_free(&shared_comm_));
+    }
+    WaitCheckpoint();
+    if (checkpoint_comm_ != MPI_COMM_NULL) {
+      CHECK_MPI(MPI_Comm_free(&checkpoint_comm_));
+    }
+  }
 }
 
 void GridSpaceMPI::PartitionGrid(int num_dims, const IndexArray &size,
@@ -538,46 +608,151 @@ GridMPI *GridSpaceMPI::CreateGrid(PSType type, int elm_size,
                 local_offset, local_size);
 
   LOG_DEBUG() << "local_size: " << local_size << "\n";
+  UnsignedArray halo_max_width;
+  for (int i = 0; i < num_dims; ++i) {
+    halo_max_width[i] = halo_padding_;
+  }
   GridMPI *g = GridMPI::Create(type, elm_size, num_dims, grid_size,
                                double_buffering,
                                grid_global_offset, local_offset,
-                               local_size, attr);
+                               local_size, attr,
+                               halo_max_width, halo_max_width);
   LOG_DEBUG() << "grid created\n";
   RegisterGrid(g);
+  // Halos are put into the padding of the neighbors through windows
+  // over both buffers, which are created here as grids are created
+  // at all processes at the same time. Processes with empty
+  // subgrids take part with empty windows. A single process has no
+  // neighbors but itself, and keeps exchanging halos with messages.
+  if (halo_transport_ == HALO_TRANSPORT_RMA && halo_padding_ > 0 &&
+      num_procs_ > 1) {
+    CreateGridWindow(g, g->data_[0]);
+    if (g->double_buffering_) {
+      CreateGridWindow(g, g->data_[1]);
+    }
+  }
+  // Likewise, buffers are replaced with shared ones so that the
+  // neighbors on the same node can copy halos from them
+  if (halo_transport_ == HALO_TRANSPORT_SHM && halo_padding_ > 0) {
+    InitSharedComm();
+    CreateSharedGridBuffer(g, 0);
+    if (g->double_buffering_) {
+      CreateSharedGridBuffer(g, 1);
+    }
+  }
   return g;
 }
 
-// Note: width is unsigned. 
-void GridSpaceMPI::ExchangeBoundariesAsync(
+// Halos of different dimensions and directions use distinct tags so
+// that they can be in flight at the same time. Tag 0 is used by the
+// grid request protocol. 
+static int HaloTag(int dim, bool fw) {
+  return 1 + dim * 2 + (fw ? 0 : 1);
+}
+
+static bool HasFwPeer(GridMPI *g, int dim, bool periodic) {
+  return periodic ||
+      g->local_offset()[dim] + g->local_size()[dim] < g->size()[dim];
+}
+
+static bool HasBwPeer(GridMPI *g, int dim, bool periodic) {
+  return periodic || g->local_offset()[dim] > 0;
+}
+
+// Creates a datatype for a subarray of a num_dims-dimensional array
+// of elm_size-byte elements.
+static MPI_Datatype CreateSubarrayType(int num_dims, int elm_size,
+                                       const IndexArray &size,
+                                       const IndexArray &offset,
+                                       const IndexArray &subsize) {
+  int sizes[PS_MAX_DIM], subsizes[PS_MAX_DIM], starts[PS_MAX_DIM];
+  for (int i = 0; i < num_dims; ++i) {
+    sizes[i] = size[i];
+    subsizes[i] = subsize[i];
+    starts[i] = offset[i];
+  }
+  MPI_Datatype elm_type, subarray_type;
+  CHECK_MPI(MPI_Type_contiguous(elm_size, MPI_BYTE, &elm_type));
+  CHECK_MPI(MPI_Type_create_subarray(num_dims, sizes, subsizes, starts,
+                                     MPI_ORDER_FORTRAN, elm_type,
+                                     &subarray_type));
+  CHECK_MPI(MPI_Type_commit(&subarray_type));
+  CHECK_MPI(MPI_Type_free(&elm_type));
+  return subarray_type;
+}
+
+// Creates a datatype for a halo slab of dimension dim in the padded
+// local buffer. The slab starts at slab_offset relative to the first
+// interior element.
+static MPI_Datatype CreateHaloSlabType(GridMPI *g, int dim,
+                                       PSIndex slab_offset,
+                                       unsigned width, bool diagonal) {
+  int nd = g->num_dims();
+  IndexArray offset, subsize;
+  for (int i = 0; i < nd; ++i) {
+    PSIndex pad = g->local_offset()[i] - g->local_real_offset()[i];
+    if (i == dim) {
+      subsize[i] = width;
+      offset[i] = pad + slab_offset;
+    } else if (diagonal && i > dim) {
+      // Halos of the higher dimensions are already exchanged, and
+      // are forwarded as diagonal points.
+      subsize[i] = g->local_size()[i] + g->halo_bw_width()[i]
+          + g->halo_fw_width()[i];
+      offset[i] = pad - g->halo_bw_width()[i];
+    } else {
+      subsize[i] = g->local_size()[i];
+      offset[i] = pad;
+    }
+  }
+  return CreateSubarrayType(nd, g->elm_size(), g->local_real_size(),
+                            offset, subsize);
+}
+
+static void RecvInit(void *buf, int count, MPI_Datatype type, int peer,
+                     int tag, MPI_Comm comm, HaloExchangePlan *plan) {
+  MPI_Request req;
+  CHECK_MPI(PS_MPI_Recv_init(buf, count, type, peer, tag, comm, &req));
+  plan->requests.push_back(req);
+}
+
+static void SendInit(void *buf, int count, MPI_Datatype type, int peer,
+                     int tag, MPI_Comm comm, HaloExchangePlan *plan) {
+  MPI_Request req;
+  CHECK_MPI(PS_MPI_Send_init(buf, count, type, peer, tag, comm, &req));
+  plan->requests.push_back(req);
+  int type_size;
+  CHECK_MPI(MPI_Type_size(type, &type_size));
+  ++plan->num_sends;
+  plan->send_bytes += (size_t)count * type_size;
+}
+
+// Sets up the halo widths and buffers of dimension dim, and copies
+// out the halos to send if they are not sent directly from the
+// subgrid.
+void GridSpaceMPI::PrepareHaloExchange(
     GridMPI *grid, int dim, unsigned halo_fw_width, unsigned halo_bw_width,
-    bool diagonal, bool periodic,
-    std::vector<MPI_Request> &requests) const {
-  
-  if (grid->empty_) return;
-  
-  int fw_peer = fw_neighbors_[dim];
-  int bw_peer = bw_neighbors_[dim];
-  int tag = 0;
-  size_t fw_size = grid->CalcHaloSize(dim, halo_fw_width, diagonal)
-      * grid->elm_size_;
-  size_t bw_size = grid->CalcHaloSize(dim, halo_bw_width, diagonal)
-      * grid->elm_size_;
+    bool diagonal, bool periodic) const {
+  bool has_fw_peer = HasFwPeer(grid, dim, periodic);
+  bool has_bw_peer = HasBwPeer(grid, dim, periodic);
+  bool padded = grid->halo_padded();
 
   LOG_DEBUG() << "Periodic?: " << periodic << "\n";
 
-  /*
-    Send and receive ordering must match. First get the halo for the
-    forward access, and then the halo for the backward access.
-   */
-  
-  if (halo_fw_width > 0 &&
-      (periodic ||
-       grid->local_offset_[dim] + grid->local_size_[dim]
-       < grid->size_[dim])) {
-    LOG_DEBUG() << "[" << my_rank_ << "] "
-                << "Receiving halo of " << fw_size
-                << " bytes for fw access from " << fw_peer << "\n";
-    if (grid->halo_peer_fw_buf_size_[dim] < fw_size) {
+  if (padded &&
+      (halo_fw_width > grid->halo_fw_max_width()[dim] ||
+       halo_bw_width > grid->halo_bw_max_width()[dim])) {
+    LOG_ERROR() << "Halo width of dimension " << dim
+                << " exceeds the padding of grid " << grid->id()
+                << "; increase the physis-halo-padding option.\n";
+    PSAbort(1);
+  }
+  grid->halo_has_diagonal_ = diagonal;
+
+  if (halo_fw_width > 0 && has_fw_peer) {
+    size_t fw_size = grid->CalcHaloSize(dim, halo_fw_width, diagonal)
+        * grid->elm_size_;
+    if (!padded && grid->halo_peer_fw_buf_size_[dim] < fw_size) {
       LOG_DEBUG() << "Allocating buffer\n";
       FREE(grid->halo_peer_fw_[dim]);
       grid->halo_peer_fw_[dim] = (char*)malloc(fw_size);
@@ -585,63 +760,783 @@ void GridSpaceMPI::ExchangeBoundariesAsync(
     }
     grid->halo_fw_width_[dim] = halo_fw_width;
     grid->SetHaloSize(dim, true, halo_fw_width, diagonal);
-    MPI_Request req;
-    CHECK_MPI(MPI_Irecv(grid->halo_peer_fw_[dim], fw_size, MPI_BYTE,
-                        fw_peer, tag, comm_, &req));
-    requests.push_back(req);
   } else {
     grid->halo_fw_width_[dim] = 0;
     grid->halo_fw_size_[dim].Set(0);
   }
 
-  if (halo_bw_width > 0 &&
-      (periodic || grid->local_offset_[dim] > 0)) {
-    LOG_DEBUG() << "[" << my_rank_ << "] "
-                << "Receiving halo of " << bw_size
-                << " bytes for bw access from " << bw_peer << "\n";
-    if (grid->halo_peer_bw_buf_size_[dim] < bw_size) {
+  if (halo_bw_width > 0 && has_bw_peer) {
+    size_t bw_size = grid->CalcHaloSize(dim, halo_bw_width, diagonal)
+        * grid->elm_size_;
+    if (!padded && grid->halo_peer_bw_buf_size_[dim] < bw_size) {
       LOG_DEBUG() << "Allocating buffer\n";
       FREE(grid->halo_peer_bw_[dim]);
       grid->halo_peer_bw_[dim] = (char*)malloc(bw_size);
       grid->halo_peer_bw_buf_size_[dim] = bw_size;
     }
     grid->halo_bw_width_[dim] = halo_bw_width;
-    grid->SetHaloSize(dim, false, halo_bw_width, diagonal);    
-    MPI_Request req;
-    CHECK_MPI(MPI_Irecv(grid->halo_peer_bw_[dim], bw_size, MPI_BYTE,
-                        bw_peer, tag, comm_, &req));
-    requests.push_back(req);
+    grid->SetHaloSize(dim, false, halo_bw_width, diagonal);
   } else {
     grid->halo_bw_width_[dim] = 0;
     grid->halo_bw_size_[dim].Set(0);
   }
 
+  // Padded grids send halos directly from the local buffer
+  if (padded) return;
+
+  if (halo_fw_width > 0 && has_bw_peer) {
+    grid->CopyoutHalo(dim, halo_fw_width, true, diagonal);
+  }
+  if (halo_bw_width > 0 && has_fw_peer) {
+    grid->CopyoutHalo(dim, halo_bw_width, false, diagonal);
+  }
+  return;
+}
+
+// Creates inactive persistent requests for exchanging halos of
+// dimension dim. The halo buffers must be set up by
+// PrepareHaloExchange.
+void GridSpaceMPI::InitHaloExchange(
+    GridMPI *grid, int dim, unsigned halo_fw_width, unsigned halo_bw_width,
+    bool diagonal, bool periodic, HaloExchangePlan *plan) const {
+  int fw_peer = fw_neighbors_[dim];
+  int bw_peer = bw_neighbors_[dim];
+  bool has_fw_peer = HasFwPeer(grid, dim, periodic);
+  bool has_bw_peer = HasBwPeer(grid, dim, periodic);
+
+  /*
+    Send and receive ordering must match. First get the halo for the
+    forward access, and then the halo for the backward access.
+   */
+
+  if (grid->halo_padded()) {
+    if (grid->halo_fw_width_[dim] > 0) {
+      MPI_Datatype t = CreateHaloSlabType(grid, dim, grid->local_size_[dim],
+                                          halo_fw_width, diagonal);
+      RecvInit(grid->_data(), 1, t, fw_peer, HaloTag(dim, true), comm_,
+               plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+    if (grid->halo_bw_width_[dim] > 0) {
+      MPI_Datatype t = CreateHaloSlabType(grid, dim, -(PSIndex)halo_bw_width,
+                                          halo_bw_width, diagonal);
+      RecvInit(grid->_data(), 1, t, bw_peer, HaloTag(dim, false), comm_,
+               plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+    if (halo_fw_width > 0 && has_bw_peer) {
+      MPI_Datatype t = CreateHaloSlabType(grid, dim, 0, halo_fw_width,
+                                          diagonal);
+      SendInit(grid->_data(), 1, t, bw_peer, HaloTag(dim, true), comm_,
+               plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+    if (halo_bw_width > 0 && has_fw_peer) {
+      MPI_Datatype t = CreateHaloSlabType(
+          grid, dim, grid->local_size_[dim] - halo_bw_width, halo_bw_width,
+          diagonal);
+      SendInit(grid->_data(), 1, t, fw_peer, HaloTag(dim, false), comm_,
+               plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+    return;
+  }
+
+  size_t fw_size = grid->CalcHaloSize(dim, halo_fw_width, diagonal)
+      * grid->elm_size_;
+  size_t bw_size = grid->CalcHaloSize(dim, halo_bw_width, diagonal)
+      * grid->elm_size_;
+
+  if (grid->halo_fw_width_[dim] > 0) {
+    LOG_DEBUG() << "[" << my_rank_ << "] "
+                << "Receiving halo of " << fw_size
+                << " bytes for fw access from " << fw_peer << "\n";
+    RecvInit(grid->halo_peer_fw_[dim], fw_size, MPI_BYTE, fw_peer,
+             HaloTag(dim, true), comm_, plan);
+  }
+  if (grid->halo_bw_width_[dim] > 0) {
+    LOG_DEBUG() << "[" << my_rank_ << "] "
+                << "Receiving halo of " << bw_size
+                << " bytes for bw access from " << bw_peer << "\n";
+    RecvInit(grid->halo_peer_bw_[dim], bw_size, MPI_BYTE, bw_peer,
+             HaloTag(dim, false), comm_, plan);
+  }
   // Sends out the halo for forward access
-  if (halo_fw_width > 0 &&
-      (periodic || grid->local_offset_[dim] > 0)) {
+  if (halo_fw_width > 0 && has_bw_peer) {
     LOG_DEBUG() << "[" << my_rank_ << "] "
                 << "Sending halo of " << fw_size << " bytes"
                 << " for fw access to " << bw_peer << "\n";
-    grid->CopyoutHalo(dim, halo_fw_width, true, diagonal);
-    MPI_Request req;
-    CHECK_MPI(PS_MPI_Isend(grid->halo_self_fw_[dim], fw_size, MPI_BYTE,
-                        bw_peer, tag, comm_, &req));
+    SendInit(grid->halo_self_fw_[dim], fw_size, MPI_BYTE, bw_peer,
+             HaloTag(dim, true), comm_, plan);
   }
-
-   // Sends out the halo for backward access
-  if (halo_bw_width > 0 &&
-      (periodic || 
-       grid->local_offset_[dim] + grid->local_size_[dim]
-       < grid->size_[dim])) {
+  // Sends out the halo for backward access
+  if (halo_bw_width > 0 && has_fw_peer) {
     LOG_DEBUG() << "[" << my_rank_ << "] "
                 << "Sending halo of " << bw_size << " bytes"
                 << " for bw access to " << fw_peer << "\n";
-    grid->CopyoutHalo(dim, halo_bw_width, false, diagonal);
+    SendInit(grid->halo_self_bw_[dim], bw_size, MPI_BYTE, fw_peer,
+             HaloTag(dim, false), comm_, plan);
+  }
+  return;
+}
+
+// Tags of the simultaneous exchange follow the ones of the
+// per-dimension exchange. A tag identifies the halo region at the
+// receiver side by its direction.
+static int HaloRegionTag(const IntArray &dir, int num_dims) {
+  int t = 0;
+  for (int i = num_dims - 1; i >= 0; --i) {
+    t = t * 3 + dir[i] + 1;
+  }
+  return 1 + PS_MAX_DIM * 2 + t;
+}
+
+int GridSpaceMPI::GetNeighborRank(const IntArray &dir) const {
+  IntArray idx = my_idx_;
+  for (int i = 0; i < num_dims_; ++i) {
+    idx[i] = (idx[i] + dir[i] + proc_size_[i]) % proc_size_[i];
+  }
+  return GetProcessRank(idx);
+}
+
+void GridSpaceMPI::PrepareHaloExchangeSimultaneous(
+    GridMPI *grid, const UnsignedArray &halo_fw_width,
+    const UnsignedArray &halo_bw_width, bool diagonal, bool periodic) const {
+  int nd = grid->num_dims_;
+  // Set the halo widths of all dimensions first as the halo layout of
+  // a dimension depends on the widths of the higher dimensions.
+  grid->halo_has_diagonal_ = diagonal;
+  for (int i = 0; i < nd; ++i) {
+    if (grid->halo_padded() &&
+        (halo_fw_width[i] > grid->halo_fw_max_width()[i] ||
+         halo_bw_width[i] > grid->halo_bw_max_width()[i])) {
+      LOG_ERROR() << "Halo width of dimension " << i
+                  << " exceeds the padding of grid " << grid->id()
+                  << "; increase the physis-halo-padding option.\n";
+      PSAbort(1);
+    }
+    grid->halo_fw_width_[i] =
+        HasFwPeer(grid, i, periodic) ? halo_fw_width[i] : 0;
+    grid->halo_bw_width_[i] =
+        HasBwPeer(grid, i, periodic) ? halo_bw_width[i] : 0;
+  }
+  for (int i = 0; i < nd; ++i) {
+    grid->SetHaloSize(i, true, grid->halo_fw_width_[i], diagonal);
+    grid->SetHaloSize(i, false, grid->halo_bw_width_[i], diagonal);
+    if (grid->halo_padded()) continue;
+    size_t fw_size = grid->CalcHaloSize(i, grid->halo_fw_width_[i], diagonal)
+        * grid->elm_size_;
+    if (grid->halo_peer_fw_buf_size_[i] < fw_size) {
+      FREE(grid->halo_peer_fw_[i]);
+      grid->halo_peer_fw_[i] = (char*)malloc(fw_size);
+      grid->halo_peer_fw_buf_size_[i] = fw_size;
+    }
+    size_t bw_size = grid->CalcHaloSize(i, grid->halo_bw_width_[i], diagonal)
+        * grid->elm_size_;
+    if (grid->halo_peer_bw_buf_size_[i] < bw_size) {
+      FREE(grid->halo_peer_bw_[i]);
+      grid->halo_peer_bw_[i] = (char*)malloc(bw_size);
+      grid->halo_peer_bw_buf_size_[i] = bw_size;
+    }
+  }
+  return;
+}
+
+void GridSpaceMPI::InitHaloExchangeSimultaneous(
+    GridMPI *grid, const UnsignedArray &halo_fw_width,
+    const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+    HaloExchangePlan *plan) const {
+  int nd = grid->num_dims_;
+  IndexArray pad;
+  IndexArray data_size = grid->local_size_;
+  if (grid->halo_padded()) {
+    pad = grid->local_offset_ - grid->local_real_offset_;
+    data_size = grid->local_real_size_;
+  }
+
+  int num_dirs = 1;
+  for (int i = 0; i < nd; ++i) num_dirs *= 3;
+  for (int d = 0; d < num_dirs; ++d) {
+    IntArray dir;
+    int num_nonzero = 0;
+    int first_nonzero = -1;
+    for (int i = 0, t = d; i < nd; ++i, t /= 3) {
+      dir[i] = t % 3 - 1;
+      if (dir[i] == 0) continue;
+      ++num_nonzero;
+      if (first_nonzero < 0) first_nonzero = i;
+    }
+    if (num_nonzero == 0 || (!diagonal && num_nonzero > 1)) continue;
+    int peer = GetNeighborRank(dir);
+
+    // Receive the halo region in direction dir
+    bool recv = true;
+    IndexArray recv_offset, recv_size;
+    for (int i = 0; i < nd; ++i) {
+      if (dir[i] > 0) {
+        recv &= grid->halo_fw_width_[i] > 0;
+        recv_offset[i] = grid->local_size_[i];
+        recv_size[i] = grid->halo_fw_width_[i];
+      } else if (dir[i] < 0) {
+        recv &= grid->halo_bw_width_[i] > 0;
+        recv_offset[i] = -(PSIndex)grid->halo_bw_width_[i];
+        recv_size[i] = grid->halo_bw_width_[i];
+      } else {
+        recv_offset[i] = 0;
+        recv_size[i] = grid->local_size_[i];
+      }
+    }
+    if (recv) {
+      void *buf;
+      IndexArray buf_size;
+      if (grid->halo_padded()) {
+        buf = grid->_data();
+        buf_size = data_size;
+        recv_offset = recv_offset + pad;
+      } else {
+        // The region is stored in the halo buffer of its lowest
+        // non-zero dimension, which also contains the halos of the
+        // higher dimensions if diagonal.
+        int hd = first_nonzero;
+        bool fw = dir[hd] > 0;
+        buf = fw ? grid->halo_peer_fw_[hd] : grid->halo_peer_bw_[hd];
+        buf_size = fw ? grid->halo_fw_size_[hd] : grid->halo_bw_size_[hd];
+        recv_offset[hd] = 0;
+        for (int i = hd + 1; i < nd; ++i) {
+          if (diagonal) recv_offset[i] += grid->halo_bw_width_[i];
+        }
+      }
+      MPI_Datatype t = CreateSubarrayType(nd, grid->elm_size_, buf_size,
+                                          recv_offset, recv_size);
+      RecvInit(buf, 1, t, peer, HaloRegionTag(dir, nd), comm_, plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+
+    // Send the part of the subgrid that the neighbor in direction dir
+    // accesses as its halo region in the opposite direction
+    bool send = true;
+    IntArray peer_dir;
+    IndexArray send_offset, send_size;
+    for (int i = 0; i < nd; ++i) {
+      peer_dir[i] = -dir[i];
+      if (dir[i] > 0) {
+        send &= HasFwPeer(grid, i, periodic) && halo_bw_width[i] > 0;
+        send_offset[i] = grid->local_size_[i] - halo_bw_width[i];
+        send_size[i] = halo_bw_width[i];
+      } else if (dir[i] < 0) {
+        send &= HasBwPeer(grid, i, periodic) && halo_fw_width[i] > 0;
+        send_offset[i] = 0;
+        send_size[i] = halo_fw_width[i];
+      } else {
+        send_offset[i] = 0;
+        send_size[i] = grid->local_size_[i];
+      }
+    }
+    if (send) {
+      MPI_Datatype t = CreateSubarrayType(nd, grid->elm_size_, data_size,
+                                          send_offset + pad, send_size);
+      SendInit(grid->_data(), 1, t, peer, HaloRegionTag(peer_dir, nd),
+               comm_, plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+  }
+  return;
+}
+
+// Halos of padded grids are put directly into the padding of the
+// neighbors. A region of the local subgrid is located at the
+// neighbor in direction dir at the same distance from the opposite
+// boundary of its subgrid, which also holds with periodic
+// boundaries.
+void GridSpaceMPI::AddHaloPut(GridMPI *grid, int peer, const IntArray &dir,
+                              const IndexArray &offset,
+                              const IndexArray &size,
+                              HaloExchangePlan *plan) const {
+  int nd = grid->num_dims_;
+  const GridWindow *w = plan->window;
+  IndexArray peer_offset, peer_size;
+  GetSubgrid(grid, peer, peer_offset, peer_size);
+  IndexArray target_offset = offset;
+  for (int i = 0; i < nd; ++i) {
+    if (dir[i] > 0) {
+      target_offset[i] = peer_offset[i] -
+          (grid->local_offset_[i] + grid->local_size_[i] - offset[i]);
+    } else if (dir[i] < 0) {
+      target_offset[i] = peer_offset[i] + peer_size[i] +
+          (offset[i] - grid->local_offset_[i]);
+    }
+  }
+  plan->put_peers.push_back(peer);
+  plan->put_origin_types.push_back(
+      CreateSubarrayType(nd, grid->elm_size_, grid->local_real_size_,
+                         offset - grid->local_real_offset_, size));
+  plan->put_target_types.push_back(
+      CreateSubarrayType(nd, grid->elm_size_, w->real_sizes[peer],
+                         target_offset - w->real_offsets[peer], size));
+  ++plan->num_sends;
+  plan->send_bytes += size.accumulate(nd) * grid->elm_size_;
+}
+
+static MPI_Group CreatePeerGroup(MPI_Comm comm, std::vector<int> &peers) {
+  std::sort(peers.begin(), peers.end());
+  peers.erase(std::unique(peers.begin(), peers.end()), peers.end());
+  MPI_Group comm_group, group;
+  CHECK_MPI(MPI_Comm_group(comm, &comm_group));
+  CHECK_MPI(MPI_Group_incl(comm_group, peers.size(),
+                           peers.size() ? &peers[0] : NULL, &group));
+  CHECK_MPI(MPI_Group_free(&comm_group));
+  return group;
+}
+
+// Directions of the halo regions exchanged in dimension dim, or in
+// all dimensions if dim is negative.
+static void GetHaloDirections(int num_dims, int dim, bool diagonal,
+                              std::vector<IntArray> &dirs) {
+  int num_dirs = 1;
+  for (int i = 0; i < num_dims; ++i) num_dirs *= 3;
+  for (int d = 0; d < num_dirs; ++d) {
+    IntArray dir;
+    int num_nonzero = 0;
+    for (int i = 0, t = d; i < num_dims; ++i, t /= 3) {
+      dir[i] = t % 3 - 1;
+      if (dir[i] != 0) ++num_nonzero;
+    }
+    if (num_nonzero == 0) continue;
+    if (dim >= 0 ? (num_nonzero > 1 || dir[dim] == 0) :
+        (!diagonal && num_nonzero > 1)) {
+      continue;
+    }
+    dirs.push_back(dir);
+  }
+}
+
+void GridSpaceMPI::InitHaloExchangeRMA(
+    GridMPI *grid, int dim, const UnsignedArray &halo_fw_width,
+    const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+    HaloExchangePlan *plan) const {
+  int nd = grid->num_dims_;
+  const IndexArray &lo = grid->local_offset_;
+  const IndexArray &ls = grid->local_size_;
+  std::vector<int> origins, targets;
+  std::vector<IntArray> dirs;
+  GetHaloDirections(nd, dim, diagonal, dirs);
+  FOREACH (it, dirs.begin(), dirs.end()) {
+    const IntArray &dir = *it;
+    int peer = GetNeighborRank(dir);
+    // Receive the halo region in direction dir
+    bool recv = true;
+    for (int i = 0; i < nd; ++i) {
+      if (dir[i] > 0) recv &= grid->halo_fw_width_[i] > 0;
+      if (dir[i] < 0) recv &= grid->halo_bw_width_[i] > 0;
+    }
+    if (recv) origins.push_back(peer);
+    // Put the part of the subgrid accessed by the neighbor
+    bool send = true;
+    IndexArray offset = lo, size = ls;
+    for (int i = 0; i < nd; ++i) {
+      if (dir[i] > 0) {
+        send &= HasFwPeer(grid, i, periodic) && halo_bw_width[i] > 0;
+        offset[i] = lo[i] + ls[i] - halo_bw_width[i];
+        size[i] = halo_bw_width[i];
+      } else if (dir[i] < 0) {
+        send &= HasBwPeer(grid, i, periodic) && halo_fw_width[i] > 0;
+        size[i] = halo_fw_width[i];
+      } else if (dim >= 0 && diagonal && i > dim) {
+        // Halos of the higher dimensions are already exchanged, and
+        // are forwarded as diagonal points.
+        offset[i] = lo[i] - grid->halo_bw_width_[i];
+        size[i] = ls[i] + grid->halo_bw_width_[i] +
+            grid->halo_fw_width_[i];
+      }
+    }
+    if (send) {
+      AddHaloPut(grid, peer, dir, offset, size, plan);
+      targets.push_back(peer);
+    }
+  }
+  plan->origin_group = CreatePeerGroup(comm_, origins);
+  plan->target_group = CreatePeerGroup(comm_, targets);
+}
+
+static void SortUnique(std::vector<int> &v) {
+  std::sort(v.begin(), v.end());
+  v.erase(std::unique(v.begin(), v.end()), v.end());
+}
+
+// Halos are copied from the neighbors on the same node rather than
+// written by them, so that a region is copied only once, directly
+// from the subgrid of the neighbor into the padding.
+void GridSpaceMPI::InitHaloExchangeShared(
+    GridMPI *grid, int dim, const UnsignedArray &halo_fw_width,
+    const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+    HaloExchangePlan *plan) const {
+  int nd = grid->num_dims_;
+  const IndexArray &lo = grid->local_offset_;
+  const IndexArray &ls = grid->local_size_;
+  const IndexArray &real_lo = grid->local_real_offset_;
+  const SharedGridBuffer *sb = plan->shared;
+  std::vector<IntArray> dirs;
+  GetHaloDirections(nd, dim, diagonal, dirs);
+  FOREACH (it, dirs.begin(), dirs.end()) {
+    const IntArray &dir = *it;
+    int peer = GetNeighborRank(dir);
+    bool shared = IsSharedPeer(peer);
+    IndexArray peer_offset, peer_size;
+    GetSubgrid(grid, peer, peer_offset, peer_size);
+    // Receive the halo region in direction dir, which is located at
+    // the neighbor at the same distance from its opposite boundary
+    bool recv = true;
+    IndexArray recv_offset = lo, recv_size = ls;
+    IndexArray src_offset;
+    for (int i = 0; i < nd; ++i) {
+      if (dir[i] > 0) {
+        recv &= grid->halo_fw_width_[i] > 0;
+        recv_offset[i] = lo[i] + ls[i];
+        recv_size[i] = grid->halo_fw_width_[i];
+        src_offset[i] = peer_offset[i];
+      } else if (dir[i] < 0) {
+        recv &= grid->halo_bw_width_[i] > 0;
+        recv_offset[i] = lo[i] - grid->halo_bw_width_[i];
+        recv_size[i] = grid->halo_bw_width_[i];
+        src_offset[i] = peer_offset[i] + peer_size[i] -
+            grid->halo_bw_width_[i];
+      } else {
+        if (dim >= 0 && diagonal && i > dim) {
+          // Halos of the higher dimensions are already exchanged, and
+          // are forwarded as diagonal points.
+          recv_offset[i] = lo[i] - grid->halo_bw_width_[i];
+          recv_size[i] = ls[i] + grid->halo_bw_width_[i] +
+              grid->halo_fw_width_[i];
+        }
+        src_offset[i] = recv_offset[i];
+      }
+    }
+    if (recv && shared) {
+      SharedHaloCopy c;
+      c.peer = peer;
+      c.src_offset = src_offset - sb->real_offsets[peer];
+      c.dst_offset = recv_offset - real_lo;
+      c.size = recv_size;
+      plan->shared_copies.push_back(c);
+      if (peer != my_rank_) plan->shared_sources.push_back(peer);
+    } else if (recv) {
+      MPI_Datatype t = CreateSubarrayType(nd, grid->elm_size_,
+                                          grid->local_real_size_,
+                                          recv_offset - real_lo, recv_size);
+      RecvInit(grid->_data(), 1, t, peer, HaloRegionTag(dir, nd), comm_,
+               plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+    // Send the part of the subgrid accessed by the neighbor unless it
+    // copies the part by itself
+    bool send = true;
+    IntArray peer_dir;
+    IndexArray offset = lo, size = ls;
+    for (int i = 0; i < nd; ++i) {
+      peer_dir[i] = -dir[i];
+      if (dir[i] > 0) {
+        send &= HasFwPeer(grid, i, periodic) && halo_bw_width[i] > 0;
+        offset[i] = lo[i] + ls[i] - halo_bw_width[i];
+        size[i] = halo_bw_width[i];
+      } else if (dir[i] < 0) {
+        send &= HasBwPeer(grid, i, periodic) && halo_fw_width[i] > 0;
+        size[i] = halo_fw_width[i];
+      } else if (dim >= 0 && diagonal && i > dim) {
+        offset[i] = lo[i] - grid->halo_bw_width_[i];
+        size[i] = ls[i] + grid->halo_bw_width_[i] +
+            grid->halo_fw_width_[i];
+      }
+    }
+    if (send && shared) {
+      if (peer != my_rank_) plan->shared_readers.push_back(peer);
+    } else if (send) {
+      MPI_Datatype t = CreateSubarrayType(nd, grid->elm_size_,
+                                          grid->local_real_size_,
+                                          offset - real_lo, size);
+      SendInit(grid->_data(), 1, t, peer, HaloRegionTag(peer_dir, nd),
+               comm_, plan);
+      CHECK_MPI(MPI_Type_free(&t));
+    }
+  }
+  SortUnique(plan->shared_sources);
+  SortUnique(plan->shared_readers);
+}
+
+// Zero-byte messages notifying that a process is ready to be copied
+// from, and done with copying, follow the tags of the simultaneous
+// exchange.
+static int HaloSyncTag(bool done) {
+  int num_dirs = 1;
+  for (int i = 0; i < PS_MAX_DIM; ++i) num_dirs *= 3;
+  return 1 + PS_MAX_DIM * 2 + num_dirs + (done ? 1 : 0);
+}
+
+void GridSpaceMPI::CompleteHaloExchangeShared(HaloExchangePlan *plan) const {
+  SharedGridBuffer *sb = plan->shared;
+  {
+    performance::ProfileScope prof(performance::PROFILE_MPI_WAIT);
+    if (plan->shared_requests.size()) {
+      CHECK_MPI(MPI_Waitall(plan->shared_requests.size(),
+                            &plan->shared_requests[0],
+                            MPI_STATUSES_IGNORE));
+    }
+    plan->shared_requests.clear();
+  }
+  // The stores of the sources are visible after their notifications
+  CHECK_MPI(MPI_Win_sync(sb->win));
+  GridMPI *g = static_cast<GridMPI*>(FindGrid(plan->grid_id));
+  FOREACH (it, plan->shared_copies.begin(), plan->shared_copies.end()) {
+    const SharedHaloCopy &c = *it;
+    performance::ProfileScope prof(
+        performance::PROFILE_HALO_PACK,
+        c.size.accumulate(num_dims_) * g->elm_size_);
+    CopySubgridBetweenGrids(g->elm_size_, num_dims_,
+                            sb->base, g->local_real_size_, c.dst_offset,
+                            sb->peer_bases[c.peer], sb->real_sizes[c.peer],
+                            c.src_offset, c.size);
+  }
+  // The readers may not overwrite their subgrids until done
+  std::vector<MPI_Request> requests;
+  FOREACH (it, plan->shared_sources.begin(), plan->shared_sources.end()) {
+    MPI_Request req;
+    CHECK_MPI(PS_MPI_Isend(NULL, 0, MPI_BYTE, *it, HaloSyncTag(true),
+                           comm_, &req));
+    requests.push_back(req);
+  }
+  FOREACH (it, plan->shared_readers.begin(), plan->shared_readers.end()) {
     MPI_Request req;
-    CHECK_MPI(PS_MPI_Isend(grid->halo_self_bw_[dim], bw_size, MPI_BYTE,
-                        fw_peer, tag, comm_, &req));
+    CHECK_MPI(MPI_Irecv(NULL, 0, MPI_BYTE, *it, HaloSyncTag(true),
+                        comm_, &req));
+    requests.push_back(req);
+  }
+  if (requests.size()) {
+    performance::ProfileScope prof(performance::PROFILE_MPI_WAIT);
+    CHECK_MPI(MPI_Waitall(requests.size(), &requests[0],
+                          MPI_STATUSES_IGNORE));
+  }
+}
+
+void GridSpaceMPI::CompleteDirectHaloExchanges() const {
+  FOREACH (it, pending_direct_plans_.begin(), pending_direct_plans_.end()) {
+    if ((*it)->shared) {
+      CompleteHaloExchangeShared(*it);
+      continue;
+    }
+    performance::ProfileScope prof(performance::PROFILE_MPI_WAIT);
+    MPI_Win win = (*it)->window->win;
+    CHECK_MPI(MPI_Win_complete(win));
+    CHECK_MPI(MPI_Win_wait(win));
+  }
+  pending_direct_plans_.clear();
+}
+
+// Buffers that the requests for exchanging dimension dim are bound
+// to. All dimensions are included if dim is negative.
+static void GetHaloBuffers(GridMPI *g, int dim,
+                           std::vector<char*> &buffers) {
+  buffers.push_back(g->_data());
+  for (int i = 0; i < g->num_dims(); ++i) {
+    if (dim >= 0 && i != dim) continue;
+    buffers.push_back(g->_halo_peer_fw()[i]);
+    buffers.push_back(g->_halo_peer_bw()[i]);
+    buffers.push_back(g->_halo_self_fw()[i]);
+    buffers.push_back(g->_halo_self_bw()[i]);
+  }
+}
+
+static bool IsSameWidth(const UnsignedArray &x, const UnsignedArray &y) {
+  for (int i = 0; i < PS_MAX_DIM; ++i) {
+    if (x[i] != y[i]) return false;
+  }
+  return true;
+}
+
+static void FreeHaloExchangePlan(HaloExchangePlan *plan) {
+  FOREACH (it, plan->requests.begin(), plan->requests.end()) {
+    CHECK_MPI(MPI_Request_free(&(*it)));
+  }
+  if (plan->window) {
+    for (unsigned i = 0; i < plan->put_peers.size(); ++i) {
+      CHECK_MPI(MPI_Type_free(&plan->put_origin_types[i]));
+      CHECK_MPI(MPI_Type_free(&plan->put_target_types[i]));
+    }
+    CHECK_MPI(MPI_Group_free(&plan->origin_group));
+    CHECK_MPI(MPI_Group_free(&plan->target_group));
+  }
+  delete plan;
+}
+
+HaloExchangePlan *GridSpaceMPI::GetHaloExchangePlan(
+    GridMPI *grid, int dim, const UnsignedArray &halo_fw_width,
+    const UnsignedArray &halo_bw_width, bool diagonal, bool periodic) const {
+  std::vector<char*> buffers;
+  GetHaloBuffers(grid, dim, buffers);
+  // Double-buffered grids alternate between two plans, so up to two
+  // plans are kept for the same exchange.
+  std::vector<HaloExchangePlan*>::iterator oldest = halo_plans_.end();
+  int num_plans = 0;
+  FOREACH (it, halo_plans_.begin(), halo_plans_.end()) {
+    HaloExchangePlan *p = *it;
+    if (!(p->grid_id == grid->id() && p->dim == dim &&
+          p->diagonal == diagonal && p->periodic == periodic &&
+          IsSameWidth(p->halo_fw_width, halo_fw_width) &&
+          IsSameWidth(p->halo_bw_width, halo_bw_width))) continue;
+    if (p->buffers == buffers) return p;
+    if (num_plans++ == 0) oldest = it;
+  }
+  if (num_plans >= 2) {
+    // Buffers have been reallocated
+    FreeHaloExchangePlan(*oldest);
+    halo_plans_.erase(oldest);
+  }
+
+  LOG_DEBUG() << "Creating halo exchange plan for grid "
+              << grid->id() << "\n";
+  HaloExchangePlan *p = new HaloExchangePlan;
+  p->grid_id = grid->id();
+  p->dim = dim;
+  p->halo_fw_width = halo_fw_width;
+  p->halo_bw_width = halo_bw_width;
+  p->diagonal = diagonal;
+  p->periodic = periodic;
+  p->buffers = buffers;
+  p->num_sends = 0;
+  p->send_bytes = 0;
+  p->window = NULL;
+  p->shared = NULL;
+  if (halo_transport_ == HALO_TRANSPORT_RMA && grid->halo_padded()) {
+    p->window = FindGridWindow(grid);
+  } else if (halo_transport_ == HALO_TRANSPORT_SHM && grid->halo_padded()) {
+    p->shared = FindSharedGridBuffer(grid);
+  }
+  if (p->window) {
+    InitHaloExchangeRMA(grid, dim, halo_fw_width, halo_bw_width,
+                        diagonal, periodic, p);
+  } else if (p->shared) {
+    InitHaloExchangeShared(grid, dim, halo_fw_width, halo_bw_width,
+                           diagonal, periodic, p);
+  } else if (dim < 0) {
+    InitHaloExchangeSimultaneous(grid, halo_fw_width, halo_bw_width,
+                                 diagonal, periodic, p);
+  } else {
+    InitHaloExchange(grid, dim, halo_fw_width[dim], halo_bw_width[dim],
+                     diagonal, periodic, p);
+  }
+  halo_plans_.push_back(p);
+  return p;
+}
+
+void GridSpaceMPI::StartHaloExchangePlan(
+    HaloExchangePlan *plan, std::vector<MPI_Request> &requests) const {
+  if (plan->window) {
+    // Only one exposure epoch can be active on a window
+    FOREACH (it, pending_direct_plans_.begin(), pending_direct_plans_.end()) {
+      if ((*it)->window == plan->window) {
+        CompleteDirectHaloExchanges();
+        break;
+      }
+    }
+    MPI_Win win = plan->window->win;
+    CHECK_MPI(MPI_Win_post(plan->origin_group, 0, win));
+    CHECK_MPI(MPI_Win_start(plan->target_group, 0, win));
+    for (unsigned i = 0; i < plan->put_peers.size(); ++i) {
+      CHECK_MPI(MPI_Put(plan->window->base, 1, plan->put_origin_types[i],
+                        plan->put_peers[i], 0, 1,
+                        plan->put_target_types[i], win));
+    }
+    if (performance::profiler.enabled()) {
+      performance::profiler.CountMessages(plan->num_sends, plan->send_bytes);
+    }
+    pending_direct_plans_.push_back(plan);
+    return;
+  }
+  if (plan->shared) {
+    // Make the stores to the subgrid visible to the readers before
+    // notifying them
+    CHECK_MPI(MPI_Win_sync(plan->shared->win));
+    FOREACH (it, plan->shared_readers.begin(), plan->shared_readers.end()) {
+      MPI_Request req;
+      CHECK_MPI(PS_MPI_Isend(NULL, 0, MPI_BYTE, *it, HaloSyncTag(false),
+                             comm_, &req));
+      plan->shared_requests.push_back(req);
+    }
+    FOREACH (it, plan->shared_sources.begin(), plan->shared_sources.end()) {
+      MPI_Request req;
+      CHECK_MPI(MPI_Irecv(NULL, 0, MPI_BYTE, *it, HaloSyncTag(false),
+                          comm_, &req));
+      plan->shared_requests.push_back(req);
+    }
+    pending_direct_plans_.push_back(plan);
+  }
+  if (plan->requests.size() == 0) return;
+  CHECK_MPI(MPI_Startall(plan->requests.size(), &plan->requests[0]));
+  if (performance::profiler.enabled()) {
+    performance::profiler.CountMessages(plan->num_sends, plan->send_bytes);
+  }
+  requests.insert(requests.end(), plan->requests.begin(),
+                  plan->requests.end());
+}
+
+void GridSpaceMPI::FreeHaloExchangePlans(int grid_id) {
+  std::vector<HaloExchangePlan*> plans;
+  FOREACH (it, halo_plans_.begin(), halo_plans_.end()) {
+    if (grid_id < 0 || (*it)->grid_id == grid_id) {
+      FreeHaloExchangePlan(*it);
+    } else {
+      plans.push_back(*it);
+    }
+  }
+  halo_plans_.swap(plans);
+}
+
+void GridSpaceMPI::DeleteGrid(Grid *g) {
+  int id = g->id();
+  FreeHaloExchangePlans(id);
+  FreeGridWindows(id);
+  GridSpace::DeleteGrid(g);
+  // The buffers of the grid are freed with the windows
+  FreeSharedGridBuffers(id);
+}
+
+// Note: width is unsigned.
+void GridSpaceMPI::ExchangeBoundariesAsync(
+    GridMPI *grid, int dim, unsigned halo_fw_width, unsigned halo_bw_width,
+    bool diagonal, bool periodic,
+    std::vector<MPI_Request> &requests) const {
+
+  if (grid->empty_) return;
+
+  PrepareHaloExchange(grid, dim, halo_fw_width, halo_bw_width,
+                      diagonal, periodic);
+  UnsignedArray fw_width, bw_width;
+  fw_width[dim] = halo_fw_width;
+  bw_width[dim] = halo_bw_width;
+  // With diagonal points, the halos of dimension dim extend over the
+  // halos of the higher dimensions, so the plan also depends on their
+  // widths.
+  if (diagonal) {
+    for (int i = dim + 1; i < grid->num_dims_; ++i) {
+      fw_width[i] = grid->halo_fw_width_[i];
+      bw_width[i] = grid->halo_bw_width_[i];
+    }
   }
+  HaloExchangePlan *plan = GetHaloExchangePlan(grid, dim, fw_width, bw_width,
+                                               diagonal, periodic);
+  StartHaloExchangePlan(plan, requests);
+  return;
+}
 
+void GridSpaceMPI::ExchangeBoundariesSimultaneousAsync(
+    GridMPI *grid, const UnsignedArray &halo_fw_width,
+    const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+    std::vector<MPI_Request> &requests) const {
+  if (grid->empty_) return;
+
+  PrepareHaloExchangeSimultaneous(grid, halo_fw_width, halo_bw_width,
+                                  diagonal, periodic);
+  HaloExchangePlan *plan = GetHaloExchangePlan(
+      grid, -1, halo_fw_width, halo_bw_width, diagonal, periodic);
+  StartHaloExchangePlan(plan, requests);
   return;
 }
 
@@ -655,11 +1550,14 @@ void GridSpaceMPI::ExchangeBoundaries(GridMPI *grid,
   ExchangeBoundariesAsync(grid, dim, halo_fw_width,
                           halo_bw_width, diagonal,
                           periodic, requests);
-  FOREACH (it, requests.begin(), requests.end()) {
-    MPI_Request *req = &(*it);
-    CHECK_MPI(MPI_Wait(req, MPI_STATUS_IGNORE));
+  {
+    performance::ProfileScope prof(performance::PROFILE_MPI_WAIT);
+    FOREACH (it, requests.begin(), requests.end()) {
+      MPI_Request *req = &(*it);
+      CHECK_MPI(MPI_Wait(req, MPI_STATUS_IGNORE));
+    }
   }
-  
+  CompleteDirectHaloExchanges();
   return;
 }
 #if 0
@@ -696,6 +1594,18 @@ void GridSpaceMPI::ExchangeBoundaries(int grid_id,
   LOG_DEBUG() << "GridSpaceMPI::ExchangeBoundaries\n";
 
   GridMPI *g = static_cast<GridMPI*>(FindGrid(grid_id));
+  if (simultaneous_exchange_) {
+    std::vector<MPI_Request> requests;
+    ExchangeBoundariesSimultaneousAsync(g, halo_fw_width, halo_bw_width,
+                                        diagonal, periodic, requests);
+    if (requests.size()) {
+      performance::ProfileScope prof(performance::PROFILE_MPI_WAIT);
+      CHECK_MPI(MPI_Waitall(requests.size(), &requests[0],
+                            MPI_STATUSES_IGNORE));
+    }
+    CompleteDirectHaloExchanges();
+    return;
+  }
   for (int i = g->num_dims_ - 1; i >= 0; --i) {
     LOG_VERBOSE() << "Exchanging dimension " << i << " data\n";
     PSAssert(halo_fw_width[i] >=0);
@@ -706,6 +1616,411 @@ void GridSpaceMPI::ExchangeBoundaries(int grid_id,
   return;
 }
 
+void GridSpaceMPI::ExchangeBoundariesBegin(
+    GridMPI *g, const UnsignedArray &halo_fw_width,
+    const UnsignedArray &halo_bw_width, bool diagonal, bool periodic) {
+  PendingHaloExchange pe;
+  pe.grid = g;
+  pe.halo_fw_width = halo_fw_width;
+  pe.halo_bw_width = halo_bw_width;
+  pe.diagonal = diagonal;
+  pe.periodic = periodic;
+  if (simultaneous_exchange_) {
+    ExchangeBoundariesSimultaneousAsync(g, halo_fw_width, halo_bw_width,
+                                        diagonal, periodic,
+                                        pending_requests_);
+    pe.next_dim = -1;
+    pending_exchanges_.push_back(pe);
+    return;
+  }
+  int last_dim = diagonal ? g->num_dims_ - 1 : 0;
+  for (int i = g->num_dims_ - 1; i >= last_dim; --i) {
+    LOG_VERBOSE() << "Starting exchange of dimension " << i << " data\n";
+    ExchangeBoundariesAsync(g, i, halo_fw_width[i], halo_bw_width[i],
+                            diagonal, periodic, pending_requests_);
+  }
+  pe.next_dim = last_dim - 1;
+  pending_exchanges_.push_back(pe);
+  return;
+}
+
+void GridSpaceMPI::ExchangeBoundariesEnd() {
+  if (pending_requests_.size()) {
+    performance::ProfileScope prof(performance::PROFILE_MPI_WAIT);
+    CHECK_MPI(MPI_Waitall(pending_requests_.size(),
+                          &pending_requests_[0], MPI_STATUSES_IGNORE));
+  }
+  pending_requests_.clear();
+  CompleteDirectHaloExchanges();
+  // Exchange the remaining dimensions that depend on the completed
+  // ones
+  FOREACH (it, pending_exchanges_.begin(), pending_exchanges_.end()) {
+    PendingHaloExchange &pe = *it;
+    for (int i = pe.next_dim; i >= 0; --i) {
+      ExchangeBoundaries(pe.grid, i, pe.halo_fw_width[i],
+                         pe.halo_bw_width[i], pe.diagonal, pe.periodic);
+    }
+  }
+  pending_exchanges_.clear();
+  return;
+}
+
+void GridSpaceMPI::GetSubgrid(const GridMPI *g, int rank,
+                              IndexArray &local_offset,
+                              IndexArray &local_size) const {
+  const IntArray &proc_index = proc_indices_[rank];
+  for (int i = 0; i < g->num_dims_; ++i) {
+    PSIndex proc_offset = offsets_[i][proc_index[i]];
+    PSIndex proc_size = partitions_[i][proc_index[i]];
+    local_offset[i] = std::max(proc_offset - g->global_offset_[i],
+                               (PSIndex)0);
+    PSIndex first = std::max(proc_offset, g->global_offset_[i]);
+    PSIndex last = std::min(g->global_offset_[i] + g->size_[i],
+                            proc_offset + proc_size);
+    local_size[i] = std::max(last - first, (PSIndex)0);
+  }
+  return;
+}
+
+// Copies subgrids between the global array at the root and the local
+// buffers with a single collective call. MPI_Scatterv and
+// MPI_Gatherv cannot be used since the subgrids are described by
+// datatypes different for each process. When every process holds the
+// global array, each subgrid is copied from the process's own array,
+// and gathered into the arrays of all processes.
+void GridSpaceMPI::CopySubgrids(GridMPI *g, void *global_buf, int root,
+                                void *local_buf,
+                                const IndexArray &local_buf_size,
+                                const IndexArray &local_buf_offset,
+                                bool scatter) const {
+  int nd = g->num_dims_;
+  std::vector<int> displs(num_procs_, 0);
+  std::vector<int> global_counts(num_procs_, 0);
+  std::vector<int> local_counts(num_procs_, 0);
+  std::vector<MPI_Datatype> global_types(num_procs_, MPI_BYTE);
+  std::vector<MPI_Datatype> local_types(num_procs_, MPI_BYTE);
+  if (root < 0 || my_rank_ == root) {
+    for (int i = 0; i < num_procs_; ++i) {
+      if (root < 0 && scatter && i != my_rank_) continue;
+      IndexArray offset, size;
+      GetSubgrid(g, i, offset, size);
+      if (size.accumulate(nd) == 0) continue;
+      global_types[i] = CreateSubarrayType(nd, g->elm_size_, g->size_,
+                                           offset, size);
+      global_counts[i] = 1;
+    }
+  }
+  if (!g->empty_) {
+    for (int i = 0; i < num_procs_; ++i) {
+      if (root >= 0 ? i != root : (scatter && i != my_rank_)) continue;
+      local_types[i] = CreateSubarrayType(nd, g->elm_size_, local_buf_size,
+                                          local_buf_offset,
+                                          g->local_size_);
+      local_counts[i] = 1;
+    }
+  }
+  if (scatter) {
+    CHECK_MPI(MPI_Alltoallw(global_buf, &global_counts[0], &displs[0],
+                            &global_types[0], local_buf, &local_counts[0],
+                            &displs[0], &local_types[0], comm_));
+  } else {
+    CHECK_MPI(MPI_Alltoallw(local_buf, &local_counts[0], &displs[0],
+                            &local_types[0], global_buf, &global_counts[0],
+                            &displs[0], &global_types[0], comm_));
+  }
+  for (int i = 0; i < num_procs_; ++i) {
+    if (global_counts[i]) CHECK_MPI(MPI_Type_free(&global_types[i]));
+    if (local_counts[i]) CHECK_MPI(MPI_Type_free(&local_types[i]));
+  }
+  return;
+}
+
+void GridSpaceMPI::ScatterGrid(GridMPI *g, const void *buf, int root) {
+  performance::ProfileScope prof(performance::PROFILE_COPYIN,
+                                 g->local_size().accumulate(g->num_dims())
+                                 * g->elm_size());
+  CopySubgrids(g, const_cast<void*>(buf), root, g->_data(),
+               g->local_real_size_, g->local_offset_ - g->local_real_offset_,
+               true);
+  return;
+}
+
+void GridSpaceMPI::GatherGrid(GridMPI *g, void *buf, int root) {
+  performance::ProfileScope prof(performance::PROFILE_COPYOUT,
+                                 g->local_size().accumulate(g->num_dims())
+                                 * g->elm_size());
+  CopySubgrids(g, buf, root, g->_data(),
+               g->local_real_size_, g->local_offset_ - g->local_real_offset_,
+               false);
+  return;
+}
+
+// Reads or writes the subgrid at offset of a global array of size
+// stored at displacement disp in the file. The subgrid is accessed
+// with a single collective call even when count is zero.
+static void AccessFileView(MPI_File fh, MPI_Offset disp, int num_dims,
+                           int elm_size, const IndexArray &size,
+                           const IndexArray &offset,
+                           const IndexArray &subsize, void *buf,
+                           int count, MPI_Datatype mem_type, bool read) {
+  MPI_Datatype file_type = MPI_BYTE;
+  if (count) {
+    file_type = CreateSubarrayType(num_dims, elm_size, size, offset, subsize);
+  }
+  CHECK_MPI(MPI_File_set_view(fh, disp, MPI_BYTE, file_type,
+                              const_cast<char*>("native"), MPI_INFO_NULL));
+  if (read) {
+    CHECK_MPI(MPI_File_read_all(fh, buf, count, mem_type,
+                                MPI_STATUS_IGNORE));
+  } else {
+    CHECK_MPI(MPI_File_write_all(fh, buf, count, mem_type,
+                                 MPI_STATUS_IGNORE));
+  }
+  if (count) CHECK_MPI(MPI_Type_free(&file_type));
+}
+
+static MPI_File OpenFile(MPI_Comm comm, const std::string &path, bool read) {
+  MPI_File fh;
+  int amode = read ? MPI_MODE_RDONLY : (MPI_MODE_WRONLY | MPI_MODE_CREATE);
+  if (MPI_File_open(comm, const_cast<char*>(path.c_str()), amode,
+                    MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+    LOG_ERROR() << "Failed to open " << path << "\n";
+    PSAbort(1);
+  }
+  if (!read) {
+    // Truncate any existing file
+    CHECK_MPI(MPI_File_set_size(fh, 0));
+  }
+  return fh;
+}
+
+void GridSpaceMPI::AccessFile(GridMPI *g, const std::string &path,
+                              void *local_buf,
+                              const IndexArray &local_buf_size,
+                              const IndexArray &local_buf_offset,
+                              bool read) const {
+  int nd = g->num_dims_;
+  MPI_File fh = OpenFile(comm_, path, read);
+  // Processes without subgrids still need to join the collective
+  // calls with empty accesses.
+  IndexArray offset, size;
+  MPI_Datatype mem_type = MPI_BYTE;
+  int count = 0;
+  if (!g->empty_) {
+    GetSubgrid(g, my_rank_, offset, size);
+    mem_type = CreateSubarrayType(nd, g->elm_size_, local_buf_size,
+                                  local_buf_offset, g->local_size_);
+    count = 1;
+  }
+  AccessFileView(fh, 0, nd, g->elm_size_, g->size_, offset, size,
+                 local_buf, count, mem_type, read);
+  CHECK_MPI(MPI_File_close(&fh));
+  if (count) CHECK_MPI(MPI_Type_free(&mem_type));
+  return;
+}
+
+void GridSpaceMPI::LoadFile(GridMPI *g, const std::string &path) {
+  AccessFile(g, path, g->_data(), g->local_real_size_,
+             g->local_offset_ - g->local_real_offset_, true);
+  return;
+}
+
+void GridSpaceMPI::SaveFile(GridMPI *g, const std::string &path) {
+  AccessFile(g, path, g->_data(), g->local_real_size_,
+             g->local_offset_ - g->local_real_offset_, false);
+  return;
+}
+
+//
+// Checkpointing
+//
+
+static const char checkpoint_magic[8] = "PSCKPT1";
+
+struct CheckpointHeader {
+  char magic[8];
+  int id;
+  int type;
+  int elm_size;
+  int num_dims;
+  PSIndex size[PS_MAX_DIM];
+  PSIndex global_offset[PS_MAX_DIM];
+  // Decomposition at the time of checkpointing
+  int proc_num_dims;
+  int proc_size[PS_MAX_DIM];
+};
+
+struct CheckpointSnapshot {
+  std::string path;
+  CheckpointHeader header;
+  // Subgrid in the grid
+  IndexArray offset;
+  IndexArray size;
+  char *buf;
+  size_t buf_size;
+};
+
+static std::string GetCheckpointPath(int id) {
+  char *ckpt_dir = getenv("PHYSIS_CHECKPOINT_DIR");
+  return (ckpt_dir ? string(ckpt_dir) : ".") + "/physis_ckpt_"
+      + toString(id);
+}
+
+void GridSpaceMPI::set_async_checkpoint(bool a) {
+  if (a) {
+    int provided;
+    CHECK_MPI(MPI_Query_thread(&provided));
+    if (provided < MPI_THREAD_MULTIPLE) {
+      LOG_WARNING() << "MPI_THREAD_MULTIPLE not supported; "
+                    << "checkpoints are written synchronously\n";
+      a = false;
+    }
+  }
+  async_checkpoint_ = a;
+}
+
+void GridSpaceMPI::CopyoutLocalGrid(GridMPI *g, void *buf) {
+  CopyoutSubgrid(g->elm_size_, g->num_dims_, g->_data(),
+                 g->local_real_size_, buf,
+                 g->local_offset_ - g->local_real_offset_, g->local_size_);
+}
+
+void GridSpaceMPI::CopyinLocalGrid(GridMPI *g, const void *buf) {
+  CopyinSubgrid(g->elm_size_, g->num_dims_, g->_data(),
+                g->local_real_size_, buf,
+                g->local_offset_ - g->local_real_offset_, g->local_size_);
+}
+
+void GridSpaceMPI::Save() {
+  // Only one checkpoint can be written at a time
+  WaitCheckpoint();
+  FOREACH (it, grids_.begin(), grids_.end()) {
+    GridMPI *g = static_cast<GridMPI*>(it->second);
+    CheckpointSnapshot *s = new CheckpointSnapshot;
+    s->path = GetCheckpointPath(g->id());
+    CheckpointHeader &h = s->header;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, checkpoint_magic, sizeof(h.magic));
+    h.id = g->id();
+    h.type = g->type();
+    h.elm_size = g->elm_size_;
+    h.num_dims = g->num_dims_;
+    h.proc_num_dims = proc_num_dims_;
+    for (int i = 0; i < g->num_dims_; ++i) {
+      h.size[i] = g->size_[i];
+      h.global_offset[i] = g->global_offset_[i];
+    }
+    for (int i = 0; i < proc_num_dims_; ++i) {
+      h.proc_size[i] = proc_size_[i];
+    }
+    s->buf_size = 0;
+    s->buf = NULL;
+    if (!g->empty_) {
+      GetSubgrid(g, my_rank_, s->offset, s->size);
+      s->buf_size = g->local_size_.accumulate(g->num_dims_) * g->elm_size_;
+      s->buf = (char*)malloc(s->buf_size);
+      CopyoutLocalGrid(g, s->buf);
+    }
+    checkpoint_snapshots_.push_back(s);
+  }
+  if (async_checkpoint_) {
+    // The main thread keeps using comm_ while the checkpoint is
+    // written.
+    if (checkpoint_comm_ == MPI_COMM_NULL) {
+      CHECK_MPI(MPI_Comm_dup(comm_, &checkpoint_comm_));
+    }
+    if (pthread_create(&checkpoint_thread_, NULL,
+                       CheckpointThreadMain, this)) {
+      LOG_ERROR() << "Failed to create a checkpoint thread\n";
+      PSAbort(1);
+    }
+    checkpoint_running_ = true;
+  } else {
+    WriteCheckpoint(comm_);
+  }
+}
+
+void *GridSpaceMPI::CheckpointThreadMain(void *gs) {
+  GridSpaceMPI *p = static_cast<GridSpaceMPI*>(gs);
+  p->WriteCheckpoint(p->checkpoint_comm_);
+  return NULL;
+}
+
+void GridSpaceMPI::WriteCheckpoint(MPI_Comm comm) {
+  FOREACH (it, checkpoint_snapshots_.begin(), checkpoint_snapshots_.end()) {
+    CheckpointSnapshot *s = *it;
+    const CheckpointHeader &h = s->header;
+    LOG_DEBUG() << "Saving grid " << h.id << " to " << s->path << "\n";
+    MPI_File fh = OpenFile(comm, s->path, false);
+    if (my_rank_ == 0) {
+      CHECK_MPI(MPI_File_write_at(fh, 0, (void*)&h, sizeof(h), MPI_BYTE,
+                                  MPI_STATUS_IGNORE));
+    }
+    IndexArray size;
+    for (int i = 0; i < h.num_dims; ++i) size[i] = h.size[i];
+    AccessFileView(fh, sizeof(h), h.num_dims, h.elm_size, size,
+                   s->offset, s->size, s->buf, s->buf_size, MPI_BYTE,
+                   false);
+    CHECK_MPI(MPI_File_close(&fh));
+    free(s->buf);
+    delete s;
+  }
+  checkpoint_snapshots_.clear();
+}
+
+void GridSpaceMPI::WaitCheckpoint() {
+  if (!checkpoint_running_) return;
+  if (pthread_join(checkpoint_thread_, NULL)) {
+    LOG_ERROR() << "Failed to join the checkpoint thread\n";
+    PSAbort(1);
+  }
+  checkpoint_running_ = false;
+}
+
+void GridSpaceMPI::Restore() {
+  WaitCheckpoint();
+  FOREACH (it, grids_.begin(), grids_.end()) {
+    GridMPI *g = static_cast<GridMPI*>(it->second);
+    string path = GetCheckpointPath(g->id());
+    LOG_DEBUG() << "Restoring grid " << g->id() << " from " << path << "\n";
+    MPI_File fh = OpenFile(comm_, path, true);
+    CheckpointHeader h;
+    CHECK_MPI(MPI_File_read_at_all(fh, 0, &h, sizeof(h), MPI_BYTE,
+                                   MPI_STATUS_IGNORE));
+    bool valid = memcmp(h.magic, checkpoint_magic, sizeof(h.magic)) == 0
+        && h.id == g->id() && h.type == g->type()
+        && h.elm_size == g->elm_size_ && h.num_dims == g->num_dims_;
+    for (int i = 0; valid && i < g->num_dims_; ++i) {
+      valid = h.size[i] == g->size_[i]
+          && h.global_offset[i] == g->global_offset_[i];
+    }
+    if (!valid) {
+      LOG_ERROR() << "Checkpoint " << path << " does not match grid "
+                  << g->id() << "\n";
+      PSAbort(1);
+    }
+    IntArray proc_size;
+    for (int i = 0; i < h.proc_num_dims; ++i) proc_size[i] = h.proc_size[i];
+    LOG_INFO() << "Grid " << g->id() << " was saved with process size "
+               << proc_size << "\n";
+    IndexArray offset, size;
+    size_t buf_size = 0;
+    char *buf = NULL;
+    if (!g->empty_) {
+      GetSubgrid(g, my_rank_, offset, size);
+      buf_size = g->local_size_.accumulate(g->num_dims_) * g->elm_size_;
+      buf = (char*)malloc(buf_size);
+    }
+    AccessFileView(fh, sizeof(h), g->num_dims_, g->elm_size_, g->size_,
+                   offset, size, buf, buf_size, MPI_BYTE, true);
+    CHECK_MPI(MPI_File_close(&fh));
+    if (buf) {
+      CopyinLocalGrid(g, buf);
+      free(buf);
+    }
+  }
+}
+
 void SendGridRequest(int my_rank, int peer_rank,
                      MPI_Comm comm,
                      GRID_REQUEST_KIND kind) {
@@ -800,8 +2115,8 @@ void GridSpaceMPI::HandleFetchRequest(GridRequest &req, GridMPI *g) {
                      req.my_rank, 0, comm_, MPI_STATUS_IGNORE));
   size_t bytes = finfo.peer_size.accumulate(nd) * g->elm_size();
   buf = ensure_buffer_capacity(buf, cur_buf_size, bytes);
-  CopyoutSubgrid(g->elm_size(), nd, g->_data(), g->local_size(),
-                 buf, finfo.peer_offset - g->local_offset(),
+  CopyoutSubgrid(g->elm_size(), nd, g->_data(), g->local_real_size(),
+                 buf, finfo.peer_offset - g->local_real_offset(),
                  finfo.peer_size);
   SendGridRequest(my_rank_, req.my_rank, comm_, FETCH_REPLY);
   MPI_Request mr;
@@ -822,8 +2137,8 @@ void GridSpaceMPI::HandleFetchReply(GridRequest &req, GridMPI *g,
                      comm_, MPI_STATUS_IGNORE));
   LOG_DEBUG() << "Fetch reply received\n";
   CopyinSubgrid(sg->elm_size(), num_dims_, sg->_data(),
-                sg->local_size(), buf,
-                finfo.peer_offset - sg->local_offset(), finfo.peer_size);
+                sg->local_real_size(), buf,
+                finfo.peer_offset - sg->local_real_offset(), finfo.peer_size);
   return;;
 }
 
@@ -839,13 +2154,22 @@ void *GridMPI::GetAddress(const IndexArray &indices_param) {
                    * rmg->elm_size());
   }
   
+  // Halos are contiguous with the local subgrid
+  if (halo_padded()) {
+    indices -= local_real_offset();
+    return (void*)(_data() +
+                   GridCalcOffset3D(indices, local_real_size())
+                   * elm_size());
+  }
+  
   indices -= local_offset();
   bool diag = halo_has_diagonal();
   // Check the location corresponds to halo regions
   for (int i = 0; i < num_dims(); ++i) {
     if (indices[i] < 0 || indices[i] >= local_size()[i]) {
-      for (int j = i+1; j < PS_MAX_DIM; ++j) {
-        if (diag) indices[i] += halo_bw_width()[i];
+      // Halo buffers include the halos of the higher dimensions
+      for (int j = i+1; j < num_dims(); ++j) {
+        if (diag) indices[j] += halo_bw_width()[j];
       }
       PSIndex offset;
       char *buf;
@@ -867,55 +2191,266 @@ void *GridMPI::GetAddress(const IndexArray &indices_param) {
                  * elm_size());
 }
 
-// Returns new subgrid when necessary.
-GridMPI *GridSpaceMPI::LoadSubgrid(GridMPI *g, const IndexArray &grid_offset,
-                                   const IndexArray &grid_size,
-                                   bool reuse) {
-  LOG_DEBUG() << __FUNCTION__ 
-                  << ": grid offset: " << grid_offset << ", grid size: "
-                  << grid_size << "\n";
+// Up to this number of fetch plans are kept
+static const unsigned max_subgrid_fetch_plans = 16;
 
-  // This is not required, but just for ensuring all processes be here.
-  //CHECK_MPI(MPI_Barrier(comm_));
+GridWindow *GridSpaceMPI::FindGridWindow(GridMPI *g) const {
+  FOREACH (it, grid_windows_.begin(), grid_windows_.end()) {
+    if ((*it)->grid_id == g->id() && (*it)->base == g->_data()) return *it;
+  }
+  return NULL;
+}
 
-  PSAssert(grid_offset >= 0);
-  PSAssert(grid_size >= 0);
-  
-  std::vector<FetchInfo> fetch_requests;
-  CollectPerProcSubgridInfo(g, grid_offset, grid_size, fetch_requests);
-  std::map<int, FetchInfo> fetch_map;
+GridWindow *GridSpaceMPI::GetGridWindow(GridMPI *g) {
+  GridWindow *w = FindGridWindow(g);
+  if (w) return w;
+  // Double-buffered grids alternate between two windows
+  std::vector<GridWindow*>::iterator oldest = grid_windows_.end();
+  int num_windows = 0;
+  FOREACH (it, grid_windows_.begin(), grid_windows_.end()) {
+    if ((*it)->grid_id != g->id()) continue;
+    if (num_windows++ == 0) oldest = it;
+  }
+  // Windows are evicted in the same order at all processes
+  if (num_windows >= 2) {
+    CHECK_MPI(MPI_Win_free(&(*oldest)->win));
+    delete *oldest;
+    grid_windows_.erase(oldest);
+  }
+  return CreateGridWindow(g, g->_data());
+}
 
-  GridMPI *sg = NULL;
+GridWindow *GridSpaceMPI::CreateGridWindow(GridMPI *g, char *base) {
+  LOG_DEBUG() << "Creating window for grid " << g->id() << "\n";
+  GridWindow *w = new GridWindow;
+  w->grid_id = g->id();
+  w->base = base;
+  MPI_Aint bytes = g->empty_ ? 0 :
+      g->local_real_size_.accumulate(num_dims_) * g->elm_size_;
+  CHECK_MPI(MPI_Win_create(w->base, bytes, 1, MPI_INFO_NULL, comm_,
+                           &w->win));
+  IndexArray layout[2] = {g->local_real_offset_, g->local_real_size_};
+  std::vector<IndexArray> layouts(num_procs_ * 2);
+  CHECK_MPI(MPI_Allgather(layout, sizeof(layout), MPI_BYTE,
+                          &layouts[0], sizeof(layout), MPI_BYTE, comm_));
+  for (int i = 0; i < num_procs_; ++i) {
+    w->real_offsets.push_back(layouts[i*2]);
+    w->real_sizes.push_back(layouts[i*2+1]);
+  }
+  grid_windows_.push_back(w);
+  return w;
+}
 
-  if (fetch_requests.size()) {
-    if (fetch_requests.size() == 1 &&
-        GetProcessRank(fetch_requests[0].peer_index) == my_rank_) {
-      // This request can just be satisfied by returning the current
-      // grid object itself since the requested region falls inside
-      // this grid. Return NULL then.
-      LOG_DEBUG() << "No actual loading since requested region included in the local grid\n";
-      sg = NULL;
-      fetch_requests.clear();
+static void FreeSubgridFetchPlan(SubgridFetchPlan *plan) {
+  for (unsigned i = 0; i < plan->peers.size(); ++i) {
+    CHECK_MPI(MPI_Type_free(&plan->origin_types[i]));
+    CHECK_MPI(MPI_Type_free(&plan->target_types[i]));
+  }
+  delete plan;
+}
+
+SubgridFetchPlan *GridSpaceMPI::GetSubgridFetchPlan(
+    GridMPI *g, const GridWindow *w, const IndexArray &grid_offset,
+    const IndexArray &grid_size,
+    const std::vector<FetchInfo> &fetch_requests) {
+  FOREACH (it, fetch_plans_.begin(), fetch_plans_.end()) {
+    SubgridFetchPlan *p = *it;
+    if (p->grid_id == g->id() && p->offset == grid_offset &&
+        p->size == grid_size) {
+      // Move to the back as the most recently used
+      fetch_plans_.erase(it);
+      fetch_plans_.push_back(p);
+      return p;
+    }
+  }
+  if (fetch_plans_.size() >= max_subgrid_fetch_plans) {
+    FreeSubgridFetchPlan(fetch_plans_.front());
+    fetch_plans_.erase(fetch_plans_.begin());
+  }
+  LOG_DEBUG() << "Creating fetch plan for grid " << g->id() << "\n";
+  SubgridFetchPlan *p = new SubgridFetchPlan;
+  p->grid_id = g->id();
+  p->offset = grid_offset;
+  p->size = grid_size;
+  p->bytes = 0;
+  FOREACH (it, fetch_requests.begin(), fetch_requests.end()) {
+    const FetchInfo &finfo = *it;
+    if (finfo.peer_size.accumulate(num_dims_) == 0) continue;
+    int peer = GetProcessRank(finfo.peer_index);
+    p->peers.push_back(peer);
+    p->origin_types.push_back(
+        CreateSubarrayType(num_dims_, g->elm_size_, grid_size,
+                           finfo.peer_offset - grid_offset,
+                           finfo.peer_size));
+    p->target_types.push_back(
+        CreateSubarrayType(num_dims_, g->elm_size_, w->real_sizes[peer],
+                           finfo.peer_offset - w->real_offsets[peer],
+                           finfo.peer_size));
+    p->bytes += finfo.peer_size.accumulate(num_dims_) * g->elm_size_;
+  }
+  fetch_plans_.push_back(p);
+  return p;
+}
+
+void GridSpaceMPI::FreeGridWindows(int grid_id) {
+  std::vector<GridWindow*> windows;
+  FOREACH (it, grid_windows_.begin(), grid_windows_.end()) {
+    if (grid_id < 0 || (*it)->grid_id == grid_id) {
+      CHECK_MPI(MPI_Win_free(&(*it)->win));
+      delete *it;
     } else {
-      if (reuse && g->remote_grid() &&
-          g->remote_grid()->local_offset() == grid_offset &&
-          g->remote_grid()->local_size() == grid_size) {
-        // reuse previously loaded remote grid
-        fetch_requests.clear();
-        g->remote_grid_active() = true;
-      } else {
-        g->EnsureRemoteGrid(grid_offset, grid_size);
-        sg = g->remote_grid();
-        g->remote_grid_active() = true;
-      }
+      windows.push_back(*it);
     }
-  } else {
-    LOG_DEBUG() << "No fetch needed for this process\n";
   }
+  grid_windows_.swap(windows);
+  std::vector<SubgridFetchPlan*> plans;
+  FOREACH (it, fetch_plans_.begin(), fetch_plans_.end()) {
+    if (grid_id < 0 || (*it)->grid_id == grid_id) {
+      FreeSubgridFetchPlan(*it);
+    } else {
+      plans.push_back(*it);
+    }
+  }
+  fetch_plans_.swap(plans);
+}
+
+void GridSpaceMPI::set_shared_comm(MPI_Comm comm) {
+  if (shared_comm_ != MPI_COMM_NULL) {
+    CHECK_MPI(MPI_Comm_free(&shared_comm_));
+  }
+  shared_comm_ = comm;
+  MPI_Group comm_group, shared_group;
+  CHECK_MPI(MPI_Comm_group(comm_, &comm_group));
+  CHECK_MPI(MPI_Comm_group(shared_comm_, &shared_group));
+  std::vector<int> ranks(num_procs_);
+  for (int i = 0; i < num_procs_; ++i) ranks[i] = i;
+  shared_ranks_.resize(num_procs_);
+  CHECK_MPI(MPI_Group_translate_ranks(comm_group, num_procs_, &ranks[0],
+                                      shared_group, &shared_ranks_[0]));
+  CHECK_MPI(MPI_Group_free(&comm_group));
+  CHECK_MPI(MPI_Group_free(&shared_group));
+}
+
+void GridSpaceMPI::InitSharedComm() {
+  if (shared_comm_ != MPI_COMM_NULL) return;
+  MPI_Comm comm;
+  CHECK_MPI(MPI_Comm_split_type(comm_, MPI_COMM_TYPE_SHARED, my_rank_,
+                                MPI_INFO_NULL, &comm));
+  set_shared_comm(comm);
+  int size;
+  CHECK_MPI(MPI_Comm_size(shared_comm_, &size));
+  LOG_INFO() << "Processes sharing memory: " << size << "\n";
+}
+
+// Shared buffers are freed with their windows rather than by the grids
+static void KeepSharedMemory(void *p) {}
+
+void GridSpaceMPI::CreateSharedGridBuffer(GridMPI *g, int buf_idx) {
+  LOG_DEBUG() << "Creating shared buffer for grid " << g->id() << "\n";
+  SharedGridBuffer *sb = new SharedGridBuffer;
+  sb->grid_id = g->id();
+  MPI_Aint bytes = g->empty_ ? 0 :
+      g->local_real_size_.accumulate(num_dims_) * g->elm_size_;
+  // Each buffer is placed on the NUMA node of its process rather
+  // than contiguously after the preceding process
+  MPI_Info info;
+  CHECK_MPI(MPI_Info_create(&info));
+  CHECK_MPI(MPI_Info_set(info, (char*)"alloc_shared_noncontig",
+                         (char*)"true"));
+  CHECK_MPI(MPI_Win_allocate_shared(bytes, 1, info, shared_comm_,
+                                    &sb->base, &sb->win));
+  CHECK_MPI(MPI_Info_free(&info));
+  // Loads and stores are synchronized with MPI_Win_sync within a
+  // passive target epoch open until the window is freed
+  CHECK_MPI(MPI_Win_lock_all(MPI_MODE_NOCHECK, sb->win));
+  if (!g->empty_) {
+    FirstTouch(sb->base, bytes);
+    Buffer *b = g->data_buffer_[buf_idx];
+    b->deleter_(b->Get());
+    b->Get() = sb->base;
+    b->deleter_ = KeepSharedMemory;
+    g->FixupBufferPointers();
+  }
+  int shared_size;
+  CHECK_MPI(MPI_Comm_size(shared_comm_, &shared_size));
+  IndexArray layout[2] = {g->local_real_offset_, g->local_real_size_};
+  std::vector<IndexArray> layouts(shared_size * 2);
+  CHECK_MPI(MPI_Allgather(layout, sizeof(layout), MPI_BYTE,
+                          &layouts[0], sizeof(layout), MPI_BYTE,
+                          shared_comm_));
+  sb->peer_bases.resize(num_procs_, NULL);
+  sb->real_offsets.resize(num_procs_);
+  sb->real_sizes.resize(num_procs_);
+  for (int i = 0; i < num_procs_; ++i) {
+    int r = shared_ranks_[i];
+    if (r == MPI_UNDEFINED) continue;
+    MPI_Aint size;
+    int disp_unit;
+    void *base;
+    CHECK_MPI(MPI_Win_shared_query(sb->win, r, &size, &disp_unit, &base));
+    sb->peer_bases[i] = (char*)base;
+    sb->real_offsets[i] = layouts[r*2];
+    sb->real_sizes[i] = layouts[r*2+1];
+  }
+  shared_buffers_.push_back(sb);
+}
+
+SharedGridBuffer *GridSpaceMPI::FindSharedGridBuffer(GridMPI *g) const {
+  FOREACH (it, shared_buffers_.begin(), shared_buffers_.end()) {
+    if ((*it)->grid_id == g->id() && (*it)->base == g->_data()) return *it;
+  }
+  return NULL;
+}
+
+void GridSpaceMPI::FreeSharedGridBuffers(int grid_id) {
+  std::vector<SharedGridBuffer*> buffers;
+  FOREACH (it, shared_buffers_.begin(), shared_buffers_.end()) {
+    if (grid_id < 0 || (*it)->grid_id == grid_id) {
+      CHECK_MPI(MPI_Win_unlock_all((*it)->win));
+      CHECK_MPI(MPI_Win_free(&(*it)->win));
+      delete *it;
+    } else {
+      buffers.push_back(*it);
+    }
+  }
+  shared_buffers_.swap(buffers);
+}
+
+// Each process reads the parts it needs directly from the buffers of
+// their owners between two fences, so no process needs to know which
+// others access it.
+void GridSpaceMPI::FetchSubgrid(GridMPI *g, GridMPI *sg,
+                                const IndexArray &grid_offset,
+                                const IndexArray &grid_size,
+                                const std::vector<FetchInfo> &fetch_requests) {
+  GridWindow *w = GetGridWindow(g);
+  SubgridFetchPlan *plan = NULL;
+  if (fetch_requests.size()) {
+    PSAssert(sg);
+    plan = GetSubgridFetchPlan(g, w, grid_offset, grid_size,
+                               fetch_requests);
+  }
+  CHECK_MPI(MPI_Win_fence(MPI_MODE_NOPRECEDE | MPI_MODE_NOPUT, w->win));
+  if (plan) {
+    for (unsigned i = 0; i < plan->peers.size(); ++i) {
+      CHECK_MPI(MPI_Get(sg->_data(), 1, plan->origin_types[i],
+                        plan->peers[i], 0, 1, plan->target_types[i],
+                        w->win));
+    }
+    performance::profiler.CountMessages(plan->peers.size(), plan->bytes);
+  }
+  CHECK_MPI(MPI_Win_fence(MPI_MODE_NOSUCCEED | MPI_MODE_NOSTORE |
+                          MPI_MODE_NOPUT, w->win));
+}
 
+void GridSpaceMPI::FetchSubgridByRequests(
+    GridMPI *g, GridMPI *sg, const std::vector<FetchInfo> &fetch_requests) {
+  std::map<int, FetchInfo> fetch_map;
+  // Sent asynchronously, so kept until all replies are received
+  std::vector<FetchInfo> requests(fetch_requests);
   // Sending out requests for copying subgrids
   int remaining_requests = 0;  
-  FOREACH (it, fetch_requests.begin(), fetch_requests.end()) {
+  FOREACH (it, requests.begin(), requests.end()) {
     // Note: this can be the dummy info
     FetchInfo &finfo = *it;
     StringJoin sj;
@@ -964,9 +2499,65 @@ GridMPI *GridSpaceMPI::LoadSubgrid(GridMPI *g, const IndexArray &grid_offset,
         PSAbort(1);
     }
   }
+}
+
+// Returns new subgrid when necessary.
+GridMPI *GridSpaceMPI::LoadSubgrid(GridMPI *g, const IndexArray &grid_offset,
+                                   const IndexArray &grid_size,
+                                   bool reuse) {
+  LOG_DEBUG() << __FUNCTION__ 
+                  << ": grid offset: " << grid_offset << ", grid size: "
+                  << grid_size << "\n";
+
+  // This is not required, but just for ensuring all processes be here.
+  //CHECK_MPI(MPI_Barrier(comm_));
+
+  performance::ProfileScope prof(performance::PROFILE_LOAD_SUBGRID,
+                                 grid_size.accumulate(g->num_dims())
+                                 * g->elm_size());
 
-  //MPI_Barrier(MPI_COMM_WORLD);
+  PSAssert(grid_offset >= 0);
+  PSAssert(grid_size >= 0);
   
+  std::vector<FetchInfo> fetch_requests;
+  CollectPerProcSubgridInfo(g, grid_offset, grid_size, fetch_requests);
+
+  GridMPI *sg = NULL;
+
+  if (fetch_requests.size()) {
+    if (fetch_requests.size() == 1 &&
+        GetProcessRank(fetch_requests[0].peer_index) == my_rank_) {
+      // This request can just be satisfied by returning the current
+      // grid object itself since the requested region falls inside
+      // this grid. Return NULL then.
+      LOG_DEBUG() << "No actual loading since requested region included in the local grid\n";
+      sg = NULL;
+      fetch_requests.clear();
+    } else {
+      if (reuse && g->remote_grid() &&
+          g->remote_grid()->local_offset() == grid_offset &&
+          g->remote_grid()->local_size() == grid_size) {
+        // reuse previously loaded remote grid
+        fetch_requests.clear();
+        g->remote_grid_active() = true;
+      } else {
+        g->EnsureRemoteGrid(grid_offset, grid_size);
+        sg = g->remote_grid();
+        g->remote_grid_active() = true;
+      }
+    }
+  } else {
+    LOG_DEBUG() << "No fetch needed for this process\n";
+  }
+
+  // Windows are not needed when all data is local, and some MPI
+  // implementations fail to create them with a single process.
+  if (num_procs_ == 1) {
+    FetchSubgridByRequests(g, sg, fetch_requests);
+  } else {
+    FetchSubgrid(g, sg, grid_offset, grid_size, fetch_requests);
+  }
+
   return sg;
 }
 
@@ -980,6 +2571,16 @@ int GridSpaceMPI::GetProcessRank(const IntArray &proc_index) const {
   return rank;
 }
 
+static void GetHaloWidths(const IndexArray &offset_min,
+                          const IndexArray &offset_max,
+                          UnsignedArray &halo_fw_width,
+                          UnsignedArray &halo_bw_width) {
+  for (int i = 0; i < PS_MAX_DIM; ++i) {
+    halo_bw_width[i] = (offset_min[i] <= 0) ? (unsigned)(abs(offset_min[i])) : 0;
+    halo_fw_width[i] = (offset_max[i] >= 0) ? (unsigned)(offset_max[i]) : 0;
+  }
+}
+
 GridMPI *GridSpaceMPI::LoadNeighbor(GridMPI *g,
                                     const IndexArray &offset_min,
                                     const IndexArray &offset_max,
@@ -1024,10 +2625,7 @@ GridMPI *GridSpaceMPI::LoadNeighbor(GridMPI *g,
     // adavantageous if only a very small sub set of processes join
     // the communication.
     UnsignedArray halo_fw_width, halo_bw_width;
-    for (int i = 0; i < PS_MAX_DIM; ++i) {
-      halo_bw_width[i] = (offset_min[i] <= 0) ? (unsigned)(abs(offset_min[i])) : 0;
-      halo_fw_width[i] = (offset_max[i] >= 0) ? (unsigned)(offset_max[i]) : 0;
-    }
+    GetHaloWidths(offset_min, offset_max, halo_fw_width, halo_bw_width);
     ExchangeBoundaries(g->id(), halo_fw_width,
                        halo_bw_width, diagonal, periodic, reuse);
     return NULL;
@@ -1043,6 +2641,24 @@ GridMPI *GridSpaceMPI::LoadNeighbor(GridMPI *g,
   }
 }
 
+void GridSpaceMPI::LoadNeighborBegin(GridMPI *g,
+                                     const IndexArray &offset_min,
+                                     const IndexArray &offset_max,
+                                     bool diagonal,
+                                     bool reuse,
+                                     bool periodic) {
+  UnsignedArray halo_fw_width, halo_bw_width;
+  GetHaloWidths(offset_min, offset_max, halo_fw_width, halo_bw_width);
+  ExchangeBoundariesBegin(g, halo_fw_width, halo_bw_width, diagonal,
+                          periodic);
+  return;
+}
+
+void GridSpaceMPI::LoadNeighborEnd() {
+  ExchangeBoundariesEnd();
+  return;
+}
+
 int GridSpaceMPI::FindOwnerProcess(GridMPI *g, const IndexArray &index) {
   std::vector<FetchInfo> fetch_requests;
   IndexArray one;
@@ -1092,6 +2708,7 @@ void LoadSubgrid(GridMPI *gm, GridSpaceMPI *gs,
 
 int GridSpaceMPI::ReduceGrid(void *out, PSReduceOp op,
                              GridMPI *g) {
+  performance::ProfileScope prof(performance::PROFILE_REDUCE);
   void *p = malloc(g->elm_size());
   if (g->Reduce(op, p) == 0) {
     switch (g->type()) {
@@ -1099,7 +2716,7 @@ int GridSpaceMPI::ReduceGrid(void *out, PSReduceOp op,
         *(float*)p = GetReductionDefaultValue<float>(op);
         break;
       case PS_DOUBLE:
-        *(double*)p = GetReductionDefaultValue<float>(op);
+        *(double*)p = GetReductionDefaultValue<double>(op);
         break;
       default:
         PSAbort(1);
@@ -36,7 +36,9 @@ class GridMPI: public Grid {
                          const IndexArray &global_offset,
                          const IndexArray &local_offset,
                          const IndexArray &local_size,
-                         int attr);
+                         int attr,
+                         const UnsignedArray &halo_fw_max_width=UnsignedArray(),
+                         const UnsignedArray &halo_bw_max_width=UnsignedArray());
   virtual ~GridMPI();
 
   char *GetHaloBuf(int dim, unsigned width, bool fw, bool diagonal);
@@ -48,6 +50,12 @@ class GridMPI: public Grid {
   virtual std::ostream &Print(std::ostream &os) const;
   const IndexArray& local_size() const { return local_size_; }
   const IndexArray& local_offset() const { return local_offset_; }
+  //! Size of the local buffer including the padded halo layers.
+  const IndexArray& local_real_size() const { return local_real_size_; }
+  //! Global offset of the first element of the local buffer.
+  const IndexArray& local_real_offset() const { return local_real_offset_; }
+  //! True if halos are stored in the padding of the local buffer.
+  bool halo_padded() const { return halo_padded_; }
   bool halo_has_diagonal() const { return halo_has_diagonal_; }
   const UnsignedArray& halo_fw_width() const { return halo_fw_width_; }
   const UnsignedArray& halo_bw_width() const { return halo_bw_width_; }
@@ -88,11 +96,23 @@ class GridMPI: public Grid {
   
   virtual int Reduce(PSReduceOp op, void *out);
 
+  //! Copy a continuous buffer of the local size into the subgrid.
+  void CopyinLocal(const void *buf);
+  //! Copy the subgrid into a continuous buffer of the local size.
+  void CopyoutLocal(void *buf);
+
  protected:
   bool empty_;
   IndexArray global_offset_;
   IndexArray local_offset_;
   IndexArray local_size_;
+  // The local buffer is allocated with the max halo widths on each
+  // side when halo_padded_ is true. Halos are then received directly
+  // into the padding, and the separate peer halo buffers are not
+  // used.
+  bool halo_padded_;
+  IndexArray local_real_offset_;
+  IndexArray local_real_size_;
   bool halo_has_diagonal_;
   UnsignedArray halo_fw_width_;
   UnsignedArray halo_bw_width_;
@@ -137,11 +157,131 @@ struct GridRequest {
   GridRequest(int rank, GRID_REQUEST_KIND k): my_rank(rank), kind(k) {}
 };
 
+//! Transport of halo exchanges.
+enum HaloTransport {
+  //! Nonblocking sends and receives
+  HALO_TRANSPORT_P2P,
+  //! MPI_Put into the halos of the neighbors, synchronized with
+  //! post/start/complete/wait
+  HALO_TRANSPORT_RMA,
+  //! Copies from the buffers of the neighbors on the same node, and
+  //! nonblocking sends and receives with the others
+  HALO_TRANSPORT_SHM
+};
+
+//! Halo exchange started but not yet completed.
+struct PendingHaloExchange {
+  GridMPI *grid;
+  UnsignedArray halo_fw_width;
+  UnsignedArray halo_bw_width;
+  bool diagonal;
+  bool periodic;
+  //! The dimension to exchange next after the posted requests
+  //! complete. Negative when all dimensions are posted.
+  int next_dim;
+};
+
+//! RMA window exposing a grid buffer to all processes.
+struct GridWindow {
+  int grid_id;
+  //! The exposed buffer, which alternates between the two buffers of
+  //! double-buffered grids.
+  char *base;
+  MPI_Win win;
+  //! Offset and size of the exposed buffer at each process
+  std::vector<IndexArray> real_offsets;
+  std::vector<IndexArray> real_sizes;
+};
+
+//! Grid buffer allocated in memory shared by the processes of a node.
+struct SharedGridBuffer {
+  int grid_id;
+  char *base;
+  MPI_Win win;
+  //! The buffer of each process, or NULL if not on the same node
+  std::vector<char*> peer_bases;
+  //! Offset and size of the buffer at each process on the same node
+  std::vector<IndexArray> real_offsets;
+  std::vector<IndexArray> real_sizes;
+};
+
+//! Copy of a halo region from the buffer of a process on the same
+//! node.
+struct SharedHaloCopy {
+  int peer;
+  //! Offset of the region in the buffer of the peer
+  IndexArray src_offset;
+  //! Offset of the region in the local buffer
+  IndexArray dst_offset;
+  IndexArray size;
+};
+
+//! Persistent requests of a recurring halo exchange.
+/*!
+  A plan is created for each combination of a grid, halo widths, and
+  boundary conditions, and is reused as long as the buffers that the
+  requests are bound to are not reallocated.
+ */
+struct HaloExchangePlan {
+  int grid_id;
+  //! The exchanged dimension. Negative when all dimensions are
+  //! exchanged simultaneously.
+  int dim;
+  UnsignedArray halo_fw_width;
+  UnsignedArray halo_bw_width;
+  bool diagonal;
+  bool periodic;
+  std::vector<char*> buffers;
+  std::vector<MPI_Request> requests;
+  //! Number of messages sent per exchange
+  int num_sends;
+  //! Bytes sent per exchange
+  size_t send_bytes;
+  //! Window of the grid buffer if halos are put with RMA
+  GridWindow *window;
+  //! Processes putting halos into this process
+  MPI_Group origin_group;
+  //! Processes this process puts halos into
+  MPI_Group target_group;
+  std::vector<int> put_peers;
+  std::vector<MPI_Datatype> put_origin_types;
+  std::vector<MPI_Datatype> put_target_types;
+  //! Shared buffer of the grid if halos are copied from the
+  //! neighbors on the same node
+  SharedGridBuffer *shared;
+  //! Processes on the same node whose halos this process copies
+  std::vector<int> shared_sources;
+  //! Processes on the same node copying halos from this process
+  std::vector<int> shared_readers;
+  std::vector<SharedHaloCopy> shared_copies;
+  //! Notifications that the sources are ready to be copied
+  std::vector<MPI_Request> shared_requests;
+};
+
+//! Remote accesses to load a region of a grid.
+/*!
+  A plan is created for each combination of a grid and region, and
+  holds the subarray datatypes of the part owned by each process.
+ */
+struct SubgridFetchPlan {
+  int grid_id;
+  IndexArray offset;
+  IndexArray size;
+  std::vector<int> peers;
+  //! Part of each peer in the loaded subgrid
+  std::vector<MPI_Datatype> origin_types;
+  //! Part of each peer in the window of the peer
+  std::vector<MPI_Datatype> target_types;
+  size_t bytes;
+};
+
 void SendGridRequest(int my_rank, int peer_rank, MPI_Comm comm,
                      GRID_REQUEST_KIND kind);
 GridRequest RecvGridRequest(MPI_Comm comm);
 
 
+struct CheckpointSnapshot;
+
 class GridSpaceMPI: public GridSpace {
  public:
   GridSpaceMPI(int num_dims, const IndexArray &global_size,
@@ -158,6 +298,8 @@ class GridSpaceMPI: public GridSpace {
                               const IndexArray &size, bool double_buffering,
                               const IndexArray &global_offset,
                               int attr);
+  using GridSpace::DeleteGrid;
+  virtual void DeleteGrid(Grid *g);
 
   // These two functions perform the same thing except for requiring
   // the different type first parameters. The former may be omitted.
@@ -191,6 +333,23 @@ class GridSpaceMPI: public GridSpace {
                                   bool periodic,
                                   bool reuse=false) const;
 
+  //! Start exchanging halos without waiting for their arrival.
+  /*!
+    Halos of all dimensions are exchanged concurrently if diagonal
+    points are not needed or the simultaneous exchange is
+    enabled. Otherwise, only the last dimension is
+    started here, and the remaining ones are exchanged at
+    ExchangeBoundariesEnd since they depend on the halos of the
+    higher dimensions. 
+   */
+  virtual void ExchangeBoundariesBegin(GridMPI *g,
+                                       const UnsignedArray &halo_fw_width,
+                                       const UnsignedArray &halo_bw_width,
+                                       bool diagonal,
+                                       bool periodic);
+  //! Complete all halo exchanges started by ExchangeBoundariesBegin.
+  virtual void ExchangeBoundariesEnd();
+
 
   virtual GridMPI *LoadSubgrid(GridMPI *grid, const IndexArray &grid_offset,
                                const IndexArray &grid_size, bool reuse=false);
@@ -202,6 +361,20 @@ class GridSpaceMPI: public GridSpace {
                                 bool reuse,
                                 bool periodic);
 
+  //! Asynchronous version of LoadNeighbor.
+  /*!
+    The halo regions of the grid must not be accessed until
+    LoadNeighborEnd is called.
+   */
+  virtual void LoadNeighborBegin(GridMPI *g,
+                                 const IndexArray &offset_min,
+                                 const IndexArray &offset_max,
+                                 bool diagonal,
+                                 bool reuse,
+                                 bool periodic);
+  //! Complete all neighbor loads started by LoadNeighborBegin.
+  virtual void LoadNeighborEnd();
+
   virtual int FindOwnerProcess(GridMPI *g, const IndexArray &index);
   
   virtual std::ostream &Print(std::ostream &os) const;
@@ -219,6 +392,55 @@ class GridSpaceMPI: public GridSpace {
   const std::vector<IntArray> &proc_indices() const { return proc_indices_; }
   MPI_Comm comm() const { return comm_; };
   int GetProcessRank(const IntArray &proc_index) const;
+  //! Halo width padded on each side of grids created afterwards.
+  unsigned halo_padding() const { return halo_padding_; }
+  void set_halo_padding(unsigned width) { halo_padding_ = width; }
+  //! True if halos of all dimensions are exchanged at once.
+  bool simultaneous_exchange() const { return simultaneous_exchange_; }
+  void set_simultaneous_exchange(bool s) { simultaneous_exchange_ = s; }
+  HaloTransport halo_transport() const { return halo_transport_; }
+  //! Set the transport of halo exchanges.
+  /*!
+    RMA and SHM are used only for grids padded with halos, and must
+    be set before creating grids since the windows are created with
+    them.
+   */
+  void set_halo_transport(HaloTransport t) { halo_transport_ = t; }
+  //! Set the processes sharing grid buffers with the SHM transport.
+  /*!
+    The communicator must be a subset of the processes that can
+    share memory with this process. By default, the processes of
+    the same node are found with MPI_Comm_split_type when the first
+    grid is created. The grid space takes ownership of the
+    communicator.
+   */
+  void set_shared_comm(MPI_Comm comm);
+  //! True if process rank shares grid buffers with this process.
+  bool IsSharedPeer(int rank) const {
+    return shared_ranks_.size() && shared_ranks_[rank] != MPI_UNDEFINED;
+  }
+  //! Distribute a global array at the root process to all subgrids.
+  /*!
+    This is a collective call. The buffer is only accessed at the
+    root process. If root is negative, each process copies its
+    subgrid from its own buffer.
+   */
+  virtual void ScatterGrid(GridMPI *g, const void *buf, int root);
+  //! Collect all subgrids into a global array at the root process.
+  /*!
+    If root is negative, the global array is collected at all
+    processes.
+   */
+  virtual void GatherGrid(GridMPI *g, void *buf, int root);
+  //! Read a grid from a file with collective MPI-IO.
+  /*!
+    The file holds the whole grid as a raw array in the same layout
+    as the buffers of PSGridCopyin. Each process reads its own
+    subgrid directly from the file.
+   */
+  virtual void LoadFile(GridMPI *g, const std::string &path);
+  //! Write a grid to a file with collective MPI-IO.
+  virtual void SaveFile(GridMPI *g, const std::string &path);
   //! Reduce a grid with binary operator op.
   /*
    * \param out The destination scalar buffer.
@@ -228,8 +450,31 @@ class GridSpaceMPI: public GridSpace {
    */
   virtual int ReduceGrid(void *out, PSReduceOp op, GridMPI *g);
 
-  //virtual void Save() const;
-  //virtual void Restore();
+  //! Save all grids to checkpoint files.
+  /*!
+    Each grid is saved in its own file under PHYSIS_CHECKPOINT_DIR
+    with a header describing the grid and the process
+    decomposition. The grid itself is stored as a global array so
+    that it can be restored with a different decomposition. The
+    files are written with collective MPI-IO, in a background thread
+    if asynchronous checkpointing is enabled.
+   */
+  virtual void Save();
+  //! Restore all grids from checkpoint files.
+  /*!
+    Grids are identified by their ids, so they must be created in
+    the same order as when they were saved.
+   */
+  virtual void Restore();
+  //! Wait for the completion of the checkpoint being written, if any.
+  void WaitCheckpoint();
+  bool async_checkpoint() const { return async_checkpoint_; }
+  //! Write checkpoints in a background thread.
+  /*!
+    Requires MPI_THREAD_MULTIPLE; checkpoints are written
+    synchronously if it is not supported.
+   */
+  void set_async_checkpoint(bool a);
 
  protected:
   int num_dims_;
@@ -249,10 +494,192 @@ class GridSpaceMPI: public GridSpace {
   //! Indices for all processes; proc_indices_[my_rank] == my_idx_
   std::vector<IntArray> proc_indices_;
   MPI_Comm comm_;
+  unsigned halo_padding_;
+  bool simultaneous_exchange_;
+  HaloTransport halo_transport_;
+  //! Processes sharing grid buffers with the SHM transport
+  MPI_Comm shared_comm_;
+  //! Rank in shared_comm_ of each process, or MPI_UNDEFINED
+  std::vector<int> shared_ranks_;
+  //! Buffers of grids in shared memory; up to two for each grid.
+  std::vector<SharedGridBuffer*> shared_buffers_;
+  //! RMA and SHM halo exchanges started but not yet completed.
+  mutable std::vector<HaloExchangePlan*> pending_direct_plans_;
+  std::vector<PendingHaloExchange> pending_exchanges_;
+  std::vector<MPI_Request> pending_requests_;
+  //! Persistent halo exchanges; plans are immutable once created.
+  mutable std::vector<HaloExchangePlan*> halo_plans_;
+  bool async_checkpoint_;
+  //! Communicator used by the checkpoint thread.
+  MPI_Comm checkpoint_comm_;
+  pthread_t checkpoint_thread_;
+  bool checkpoint_running_;
+  //! Subgrids to write at the next checkpoint.
+  std::vector<CheckpointSnapshot*> checkpoint_snapshots_;
+  void WriteCheckpoint(MPI_Comm comm);
+  static void *CheckpointThreadMain(void *gs);
+  //! Copy the subgrid into a contiguous host buffer.
+  virtual void CopyoutLocalGrid(GridMPI *g, void *buf);
+  //! Copy a contiguous host buffer into the subgrid.
+  virtual void CopyinLocalGrid(GridMPI *g, const void *buf);
+  virtual void PrepareHaloExchange(
+      GridMPI *grid, int dim, unsigned halo_fw_width,
+      unsigned halo_bw_width, bool diagonal, bool periodic) const;
+  virtual void InitHaloExchange(
+      GridMPI *grid, int dim, unsigned halo_fw_width,
+      unsigned halo_bw_width, bool diagonal, bool periodic,
+      HaloExchangePlan *plan) const;
+  virtual void PrepareHaloExchangeSimultaneous(
+      GridMPI *grid, const UnsignedArray &halo_fw_width,
+      const UnsignedArray &halo_bw_width, bool diagonal,
+      bool periodic) const;
+  virtual void InitHaloExchangeSimultaneous(
+      GridMPI *grid, const UnsignedArray &halo_fw_width,
+      const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+      HaloExchangePlan *plan) const;
+  //! Find or create the plan of a halo exchange.
+  /*!
+    The halos must be prepared for the exchange beforehand so that
+    the plan is bound to the current halo buffers.
+   */
+  HaloExchangePlan *GetHaloExchangePlan(
+      GridMPI *grid, int dim, const UnsignedArray &halo_fw_width,
+      const UnsignedArray &halo_bw_width, bool diagonal,
+      bool periodic) const;
+  //! Create the puts of an RMA halo exchange.
+  /*!
+    Exchanges dimension dim, or all dimensions if dim is negative,
+    as the requests created by InitHaloExchange and
+    InitHaloExchangeSimultaneous.
+   */
+  void InitHaloExchangeRMA(
+      GridMPI *grid, int dim, const UnsignedArray &halo_fw_width,
+      const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+      HaloExchangePlan *plan) const;
+  //! Add a put of a region to the neighbor in direction dir.
+  /*!
+    \param offset The offset of the region in the local subgrid.
+   */
+  void AddHaloPut(GridMPI *grid, int peer, const IntArray &dir,
+                  const IndexArray &offset, const IndexArray &size,
+                  HaloExchangePlan *plan) const;
+  //! Create the copies and requests of an SHM halo exchange.
+  /*!
+    Halos are copied from the buffers of the neighbors on the same
+    node, and sent and received as messages with the others.
+   */
+  void InitHaloExchangeShared(
+      GridMPI *grid, int dim, const UnsignedArray &halo_fw_width,
+      const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+      HaloExchangePlan *plan) const;
+  void StartHaloExchangePlan(HaloExchangePlan *plan,
+                             std::vector<MPI_Request> &requests) const;
+  //! Copy the halos of an SHM exchange from the neighbors.
+  void CompleteHaloExchangeShared(HaloExchangePlan *plan) const;
+  //! Complete all RMA and SHM halo exchanges started so far.
+  /*!
+    SHM halos are copied here once the neighbors are ready, and
+    returns when the neighbors are done with copying from this
+    process.
+   */
+  void CompleteDirectHaloExchanges() const;
+  //! Free the plans of a grid, or all plans if grid_id is negative.
+  void FreeHaloExchangePlans(int grid_id);
+  //! Offset and size of the subgrid of g at process rank.
+  void GetSubgrid(const GridMPI *g, int rank, IndexArray &local_offset,
+                  IndexArray &local_size) const;
+  //! Copy subgrids between a global array and local buffers.
+  /*!
+    \param global_buf The global array, used only at the root.
+    \param root The process holding the global array. If negative, all
+    processes hold it.
+    \param local_buf The local buffer of local_buf_size, where the
+    subgrid is located at local_buf_offset.
+    \param scatter Copies from the global array if true, and to the
+    global array otherwise.
+   */
+  void CopySubgrids(GridMPI *g, void *global_buf, int root,
+                    void *local_buf, const IndexArray &local_buf_size,
+                    const IndexArray &local_buf_offset, bool scatter) const;
+  //! Read or write the subgrid in a local buffer from or to a file.
+  /*!
+    The subgrid is accessed in the file through a subarray file
+    view, so that all processes access the file with a single
+    collective call.
+   */
+  void AccessFile(GridMPI *g, const std::string &path, void *local_buf,
+                  const IndexArray &local_buf_size,
+                  const IndexArray &local_buf_offset, bool read) const;
+  //! Exchange halos of all dimensions with all neighbors at once.
+  /*!
+    Each halo region, including edges and corners when diagonal is
+    true, is received directly from the process owning it rather
+    than forwarded through the halos of other dimensions.
+   */
+  virtual void ExchangeBoundariesSimultaneousAsync(
+      GridMPI *grid, const UnsignedArray &halo_fw_width,
+      const UnsignedArray &halo_bw_width, bool diagonal, bool periodic,
+      std::vector<MPI_Request> &requests) const;
+  //! Rank of the neighbor process in direction dir with wrap-around.
+  int GetNeighborRank(const IntArray &dir) const;
   virtual void CollectPerProcSubgridInfo(const GridMPI *g,
                                          const IndexArray &grid_offset,
                                          const IndexArray &grid_size,
                                          std::vector<FetchInfo> &finfo_holder) const;
+  //! Copy the parts of a region owned by other processes into sg.
+  /*!
+    This is a collective call; processes that need no remote data
+    pass an empty list of fetch requests. The parts are read with
+    MPI_Get from windows over the grid buffers.
+   */
+  virtual void FetchSubgrid(GridMPI *g, GridMPI *sg,
+                            const IndexArray &grid_offset,
+                            const IndexArray &grid_size,
+                            const std::vector<FetchInfo> &fetch_requests);
+  //! Copy the parts of a region with request and reply messages.
+  /*!
+    Used when the grid buffers cannot be exposed as RMA windows.
+    Every process sends a DONE message to all others after
+    receiving its replies.
+   */
+  void FetchSubgridByRequests(GridMPI *g, GridMPI *sg,
+                              const std::vector<FetchInfo> &fetch_requests);
+  //! Windows over grid buffers; up to two for each grid.
+  std::vector<GridWindow*> grid_windows_;
+  //! Recently used fetch plans.
+  std::vector<SubgridFetchPlan*> fetch_plans_;
+  GridWindow *CreateGridWindow(GridMPI *g, char *base);
+  //! Find the window over the current buffer of a grid.
+  GridWindow *FindGridWindow(GridMPI *g) const;
+  //! Find or create the window over the current buffer of a grid.
+  /*!
+    This is a collective call when the window is created.
+   */
+  GridWindow *GetGridWindow(GridMPI *g);
+  SubgridFetchPlan *GetSubgridFetchPlan(GridMPI *g, const GridWindow *w,
+                                        const IndexArray &grid_offset,
+                                        const IndexArray &grid_size,
+                                        const std::vector<FetchInfo> &
+                                        fetch_requests);
+  //! Free the windows and fetch plans of a grid, or all if grid_id
+  //! is negative.
+  void FreeGridWindows(int grid_id);
+  //! Split the processes sharing memory unless set already.
+  /*!
+    This is a collective call.
+   */
+  void InitSharedComm();
+  //! Replace a grid buffer with one in shared memory.
+  /*!
+    This is a collective call over the shared communicator. The
+    previous contents of the buffer are discarded.
+   */
+  void CreateSharedGridBuffer(GridMPI *g, int buf_idx);
+  //! Find the shared buffer of the current buffer of a grid.
+  SharedGridBuffer *FindSharedGridBuffer(GridMPI *g) const;
+  //! Free the shared buffers of a grid, or all if grid_id is
+  //! negative.
+  void FreeSharedGridBuffers(int grid_id);
   virtual bool SendFetchRequest(FetchInfo &finfo) const;
   virtual void HandleFetchRequest(GridRequest &req, GridMPI *g);
   virtual void HandleFetchReply(GridRequest &req, GridMPI *g,
@@ -439,6 +439,58 @@ GridMPICUDA3D *GridSpaceMPICUDA::CreateGrid(
   return g;
 }
 
+// Subgrids are staged in host memory since device memory cannot be
+// directly used with MPI.
+void GridSpaceMPICUDA::ScatterGrid(GridMPI *g, const void *buf, int root) {
+  BufferHost sbuf(g->num_dims(), g->elm_size());
+  sbuf.EnsureCapacity(g->local_size());
+  CopySubgrids(g, const_cast<void*>(buf), root, sbuf.Get(),
+               g->local_size(), IndexArray(), true);
+  if (g->empty()) return;
+  static_cast<BufferCUDADev*>(g->buffer())->Copyin(
+      sbuf, IndexArray(), g->local_size());
+}
+
+void GridSpaceMPICUDA::GatherGrid(GridMPI *g, void *buf, int root) {
+  BufferHost sbuf(g->num_dims(), g->elm_size());
+  sbuf.EnsureCapacity(g->local_size());
+  if (!g->empty()) {
+    static_cast<BufferCUDADev*>(g->buffer())->Copyout(
+        sbuf, IndexArray(), g->local_size());
+  }
+  CopySubgrids(g, buf, root, sbuf.Get(), g->local_size(), IndexArray(),
+               false);
+}
+
+void GridSpaceMPICUDA::LoadFile(GridMPI *g, const std::string &path) {
+  BufferHost sbuf(g->num_dims(), g->elm_size());
+  sbuf.EnsureCapacity(g->local_size());
+  AccessFile(g, path, sbuf.Get(), g->local_size(), IndexArray(), true);
+  if (g->empty()) return;
+  static_cast<BufferCUDADev*>(g->buffer())->Copyin(
+      sbuf, IndexArray(), g->local_size());
+}
+
+void GridSpaceMPICUDA::SaveFile(GridMPI *g, const std::string &path) {
+  BufferHost sbuf(g->num_dims(), g->elm_size());
+  sbuf.EnsureCapacity(g->local_size());
+  if (!g->empty()) {
+    static_cast<BufferCUDADev*>(g->buffer())->Copyout(
+        sbuf, IndexArray(), g->local_size());
+  }
+  AccessFile(g, path, sbuf.Get(), g->local_size(), IndexArray(), false);
+}
+
+void GridSpaceMPICUDA::CopyoutLocalGrid(GridMPI *g, void *buf) {
+  static_cast<BufferCUDADev*>(g->buffer())->Copyout(
+      buf, IndexArray(), g->local_size());
+}
+
+void GridSpaceMPICUDA::CopyinLocalGrid(GridMPI *g, const void *buf) {
+  static_cast<BufferCUDADev*>(g->buffer())->Copyin(
+      buf, IndexArray(), g->local_size());
+}
+
 // Just copy out halo from GPU memory
 void GridSpaceMPICUDA::ExchangeBoundariesStage1(
     GridMPI *g, int dim, unsigned halo_fw_width,
@@ -705,6 +757,15 @@ void GridSpaceMPICUDA::ExchangeBoundaries(
   return;
 }
 
+// Grid buffers are in device memory, which cannot be exposed as
+// windows
+void GridSpaceMPICUDA::FetchSubgrid(
+    GridMPI *g, GridMPI *sg, const IndexArray &grid_offset,
+    const IndexArray &grid_size,
+    const std::vector<FetchInfo> &fetch_requests) {
+  FetchSubgridByRequests(g, sg, fetch_requests);
+}
+
 void GridSpaceMPICUDA::HandleFetchRequest(GridRequest &req, GridMPI *g) {
   LOG_DEBUG() << "HandleFetchRequest\n";
   GridMPICUDA3D *gm = static_cast<GridMPICUDA3D*>(g);
@@ -885,7 +946,7 @@ int GridSpaceMPICUDA::ReduceGrid(void *out, PSReduceOp op,
         *(float*)p = GetReductionDefaultValue<float>(op);
         break;
       case PS_DOUBLE:
-        *(double*)p = GetReductionDefaultValue<float>(op);
+        *(double*)p = GetReductionDefaultValue<double>(op);
         break;
       default:
         PSAbort(1);
@@ -87,6 +87,10 @@ class GridSpaceMPICUDA: public GridSpaceMPI {
                                     bool double_buffering,
                                     const IndexArray &global_offset,
                                     int attr);
+  virtual void ScatterGrid(GridMPI *g, const void *buf, int root);
+  virtual void GatherGrid(GridMPI *g, void *buf, int root);
+  virtual void LoadFile(GridMPI *g, const std::string &path);
+  virtual void SaveFile(GridMPI *g, const std::string &path);
   virtual bool SendBoundaries(GridMPICUDA3D *grid, int dim, unsigned width,
                               bool forward, bool diagonal, bool periodic,
                               ssize_t halo_size,
@@ -139,6 +143,10 @@ class GridSpaceMPICUDA: public GridSpaceMPI {
                                       cudaStream_t cuda_stream);
   
 
+  virtual void FetchSubgrid(GridMPI *g, GridMPI *sg,
+                            const IndexArray &grid_offset,
+                            const IndexArray &grid_size,
+                            const std::vector<FetchInfo> &fetch_requests);
   virtual void HandleFetchRequest(GridRequest &req, GridMPI *g);
   virtual void HandleFetchReply(GridRequest &req, GridMPI *g,
                                 std::map<int, FetchInfo> &fetch_map,  GridMPI *sg);
@@ -156,6 +164,8 @@ class GridSpaceMPICUDA: public GridSpaceMPI {
  protected:
   BufferHost *buf;
   std::map<int, performance::DataCopyProfile*> load_neighbor_prof_;
+  virtual void CopyoutLocalGrid(GridMPI *g, void *buf);
+  virtual void CopyinLocalGrid(GridMPI *g, const void *buf);
 };
   
 } // namespace runtime
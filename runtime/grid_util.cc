@@ -15,16 +15,109 @@ using physis::IndexArray;
 namespace physis {
 namespace runtime {
 
-static size_t get1DOffset(const IndexArray &md_offset,
-                          const IndexArray &size,
-                          int num_dims) {
-  size_t offset_1d = 0;
-  size_t ref_offset = 1;
+//! Regions at least this large are copied with multiple threads.
+static const size_t parallel_copy_threshold = 256 << 10;
+
+//! Copy a contiguous row.
+/*!
+  Rows of halos are often only a few elements long. Copies of the
+  common small sizes are done with constant sizes, which the compiler
+  turns into a few (vector) moves instead of calls to memcpy.
+ */
+static inline void CopyRow(void *dst, const void *src, size_t size) {
+  switch (size) {
+    case 4: memcpy(dst, src, 4); break;
+    case 8: memcpy(dst, src, 8); break;
+    case 16: memcpy(dst, src, 16); break;
+    case 32: memcpy(dst, src, 32); break;
+    default: memcpy(dst, src, size); break;
+  }
+}
+
+template <bool copyout>
+static inline void CopyRowDir(char *grid, char *buf, size_t size) {
+  if (copyout) {
+    CopyRow(buf, grid, size);
+  } else {
+    CopyRow(grid, buf, size);
+  }
+}
+
+//! Copy a sub grid between a grid and a continuous buffer.
+/*!
+  Walks the sub grid with the strides of the grid without any
+  allocation. Leading dimensions that span the whole grid are merged
+  into a single contiguous row.
+
+  \param copyout True if copying from the grid to the buffer.
+ */
+template <bool copyout>
+static void CopySubgrid(size_t elm_size, int num_dims,
+                        char *grid, const IndexArray &grid_size,
+                        char *buf,
+                        const IndexArray &subgrid_offset,
+                        const IndexArray &subgrid_size) {
+  size_t stride[PS_MAX_DIM];
+  size_t s = elm_size;
   for (int i = 0; i < num_dims; ++i) {
-    offset_1d += (md_offset[i] * ref_offset);
-    ref_offset *= size[i];
+    if (subgrid_size[i] <= 0) return;
+    stride[i] = s;
+    grid += subgrid_offset[i] * (PSIndex)s;
+    s *= grid_size[i];
+  }
+
+  // Merge the contiguous leading dimensions into one row
+  int d = 0;
+  size_t row_size = subgrid_size[0] * elm_size;
+  while (d + 1 < num_dims && subgrid_size[d] == grid_size[d]) {
+    ++d;
+    row_size *= subgrid_size[d];
+  }
+  // Dimensions d+1 and above are walked with their strides
+  int num_outer_dims = num_dims - d - 1;
+  size_t total_size = subgrid_size.accumulate(num_dims) * elm_size;
+  bool parallel = total_size >= parallel_copy_threshold;
+
+  if (num_outer_dims == 0) {
+    CopyRowDir<copyout>(grid, buf, row_size);
+  } else if (num_outer_dims == 1) {
+    PSIndex n = subgrid_size[d+1];
+    size_t st = stride[d+1];
+#pragma omp parallel for if (parallel)
+    for (PSIndex j = 0; j < n; ++j) {
+      CopyRowDir<copyout>(grid + j * st, buf + j * row_size, row_size);
+    }
+  } else if (num_outer_dims == 2) {
+    PSIndex n1 = subgrid_size[d+1];
+    PSIndex n2 = subgrid_size[d+2];
+    size_t st1 = stride[d+1];
+    size_t st2 = stride[d+2];
+#pragma omp parallel for if (parallel)
+    for (PSIndex k = 0; k < n2; ++k) {
+      char *g = grid + k * st2;
+      char *b = buf + k * n1 * row_size;
+      for (PSIndex j = 0; j < n1; ++j) {
+        CopyRowDir<copyout>(g, b, row_size);
+        g += st1;
+        b += row_size;
+      }
+    }
+  } else {
+    // Generic case; iterate over the outer dimensions like an odometer
+    PSIndex idx[PS_MAX_DIM] = {0};
+    while (true) {
+      CopyRowDir<copyout>(grid, buf, row_size);
+      buf += row_size;
+      int i = d + 1;
+      for (; i < num_dims; ++i) {
+        grid += stride[i];
+        if (++idx[i] < subgrid_size[i]) break;
+        grid -= stride[i] * subgrid_size[i];
+        idx[i] = 0;
+      }
+      if (i == num_dims) break;
+    }
   }
-  return offset_1d;
 }
 
 void CopyoutSubgrid(size_t elm_size, int num_dims,
@@ -32,49 +125,12 @@ void CopyoutSubgrid(size_t elm_size, int num_dims,
                     void *subgrid,
                     const IndexArray &subgrid_offset,
                     const IndexArray &subgrid_size) {
-  intptr_t subgrid_original = (intptr_t)subgrid; // just for sanity checking
-  std::list<IndexArray> *offsets = new std::list<IndexArray>;
-  std::list<IndexArray> *offsets_new = new std::list<IndexArray>;
-  
   LOG_DEBUG() << __FUNCTION__ << ": "
               << "subgrid offset: " << subgrid_offset
               << "subgrid size: " << subgrid_size
               << "\n";
-
-  // Collect 1-D continuous regions
-  offsets->push_back(subgrid_offset);
-  for (int i = num_dims - 1; i >= 1; --i) {
-    FOREACH (oit, offsets->begin(), offsets->end()) {
-      const IndexArray &cur_offset = *oit;
-      for (PSIndex j = 0; j < subgrid_size[i]; ++j) {
-        IndexArray new_offset = cur_offset;
-        new_offset[i] += j;
-        offsets_new->push_back(new_offset);
-      }
-    }
-    std::swap(offsets, offsets_new);
-    offsets_new->clear();
-  }
-
-  // Copy the collected 1-D continuous regions
-  size_t line_size = subgrid_size[0] * elm_size;
-  FOREACH (oit, offsets->begin(), offsets->end()) {
-    const IndexArray &offset = *oit;
-    const void *src =
-        (const void *)((intptr_t)grid +
-                       get1DOffset(offset, grid_size, num_dims) * elm_size);
-    memcpy(subgrid, src, line_size);
-    subgrid = (void*)((intptr_t)subgrid + line_size);
-  }
-
-  delete offsets;
-  delete offsets_new;
-
-  void *p = (void *)(subgrid_original +
-                     subgrid_size.accumulate(num_dims) * elm_size);
-  assert(subgrid == p);
-
-  return;
+  CopySubgrid<true>(elm_size, num_dims, (char*)grid, grid_size,
+                    (char*)subgrid, subgrid_offset, subgrid_size);
 }
 
 void CopyinSubgrid(size_t elm_size, int num_dims,
@@ -82,41 +138,58 @@ void CopyinSubgrid(size_t elm_size, int num_dims,
                    const void *subgrid,
                    const IndexArray &subgrid_offset,
                    const IndexArray &subgrid_size) {
-  intptr_t subgrid_original = (intptr_t)subgrid; // just for sanity checking
-  std::list<IndexArray> *offsets = new std::list<IndexArray>;
-  std::list<IndexArray> *offsets_new = new std::list<IndexArray>;
-  offsets->push_back(subgrid_offset);
-  for (int i = num_dims - 1; i >= 1; --i) {
-    FOREACH (oit, offsets->begin(), offsets->end()) {
-      const IndexArray &cur_offset = *oit;
-      for (PSIndex j = 0; j < subgrid_size[i]; ++j) {
-        IndexArray new_offset = cur_offset;
-        new_offset[i] += j;
-        offsets_new->push_back(new_offset);
+  CopySubgrid<false>(elm_size, num_dims, (char*)grid, grid_size,
+                     (char*)subgrid, subgrid_offset, subgrid_size);
+}
+
+void CopySubgridBetweenGrids(size_t elm_size, int num_dims,
+                             void *dst, const IndexArray &dst_size,
+                             const IndexArray &dst_offset,
+                             const void *src, const IndexArray &src_size,
+                             const IndexArray &src_offset,
+                             const IndexArray &subgrid_size) {
+  size_t dst_stride[PS_MAX_DIM], src_stride[PS_MAX_DIM];
+  char *d = (char*)dst;
+  const char *s = (const char*)src;
+  size_t ds = elm_size, ss = elm_size;
+  for (int i = 0; i < num_dims; ++i) {
+    if (subgrid_size[i] <= 0) return;
+    dst_stride[i] = ds;
+    src_stride[i] = ss;
+    d += dst_offset[i] * (PSIndex)ds;
+    s += src_offset[i] * (PSIndex)ss;
+    ds *= dst_size[i];
+    ss *= src_size[i];
+  }
+  size_t row_size = subgrid_size[0] * elm_size;
+  if (num_dims == 1) {
+    CopyRow(d, s, row_size);
+    return;
+  }
+  // The last dimension is split across threads, and the dimensions
+  // in between are walked like an odometer
+  int last = num_dims - 1;
+  PSIndex num_rows = 1;
+  for (int i = 1; i < last; ++i) num_rows *= subgrid_size[i];
+  bool parallel = subgrid_size.accumulate(num_dims) * elm_size
+      >= parallel_copy_threshold;
+#pragma omp parallel for if (parallel)
+  for (PSIndex k = 0; k < subgrid_size[last]; ++k) {
+    char *dk = d + k * dst_stride[last];
+    const char *sk = s + k * src_stride[last];
+    PSIndex idx[PS_MAX_DIM] = {0};
+    for (PSIndex r = 0; r < num_rows; ++r) {
+      CopyRow(dk, sk, row_size);
+      for (int i = 1; i < last; ++i) {
+        dk += dst_stride[i];
+        sk += src_stride[i];
+        if (++idx[i] < subgrid_size[i]) break;
+        dk -= dst_stride[i] * subgrid_size[i];
+        sk -= src_stride[i] * subgrid_size[i];
+        idx[i] = 0;
       }
     }
-    std::swap(offsets, offsets_new);
-    offsets_new->clear();    
-  }
-
-  size_t line_size = subgrid_size[0] * elm_size;
-  FOREACH (oit, offsets->begin(), offsets->end()) {
-    const IndexArray &offset = *oit;
-    void *src = (void *)((intptr_t)grid +
-                         get1DOffset(offset, grid_size, num_dims) * elm_size);
-    memcpy(src, subgrid, line_size);
-    subgrid = (const void*)((intptr_t)subgrid + line_size);
   }
-
-  delete offsets;
-  delete offsets_new;
-
-  // Sanity check
-  void *p = (void *)(subgrid_original +
-                     subgrid_size.accumulate(num_dims) * elm_size);
-  assert(subgrid == p);
-
-  return;
 }
 
 } // namespace runtime
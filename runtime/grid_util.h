@@ -49,6 +49,26 @@ void CopyinSubgrid(size_t elm_size, int num_dims,
                    const IndexArray &subgrid_size);
 
 
+//! Copy a sub grid of a grid into another grid.
+/*
+  \param elm_size The size of each element.
+  \param num_dims The number of dimensions of the grids.
+  \param dst The destination grid.
+  \param dst_size The size of each dimension of the destination grid.
+  \param dst_offset The offset of the sub grid in the destination.
+  \param src The source grid.
+  \param src_size The size of each dimension of the source grid.
+  \param src_offset The offset of the sub grid in the source.
+  \param subgrid_size The size of the sub grid to copy.
+ */
+void CopySubgridBetweenGrids(size_t elm_size, int num_dims,
+                             void *dst, const IndexArray &dst_size,
+                             const IndexArray &dst_offset,
+                             const void *src, const IndexArray &src_size,
+                             const IndexArray &src_offset,
+                             const IndexArray &subgrid_size);
+
+
 inline PSIndex GridCalcOffset3D(PSIndex x, PSIndex y, PSIndex z, 
                                 const IndexArray &size) {
   return x + y * size[0] + z * size[0] * size[1];
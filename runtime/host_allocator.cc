@@ -0,0 +1,138 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "runtime/host_allocator.h"
+
+#include <algorithm>
+#include <string>
+#include <sys/mman.h>
+
+using std::string;
+
+namespace physis {
+namespace runtime {
+
+HostAllocPolicy host_alloc_policy;
+
+static const size_t huge_page_size = 2 << 20;
+//! Unit of the parallel first touch
+static const size_t first_touch_chunk = 64 << 10;
+
+//! Stored right before the memory returned by HostAlloc.
+struct HostAllocHeader {
+  void *base;
+  size_t length;
+  bool mapped;
+};
+
+static size_t RoundUp(size_t x, size_t unit) {
+  return (x + unit - 1) / unit * unit;
+}
+
+void ParseHostAllocOptions(int *argc, char ***argv) {
+  vector<string> opts;
+  if (ParseOption(argc, argv, "physis-alloc-alignment", 1, opts)) {
+    int alignment = physis::toInteger(opts[1]);
+    if (alignment < (int)sizeof(void*) ||
+        (alignment & (alignment - 1)) != 0) {
+      LOG_ERROR() << "Invalid alignment: " << opts[1] << "\n";
+      PSAbort(1);
+    }
+    host_alloc_policy.alignment = alignment;
+    LOG_INFO() << "Host memory alignment: " << alignment << "\n";
+  }
+  opts.clear();
+  if (ParseOption(argc, argv, "physis-huge-pages", 1, opts)) {
+    if (opts[1] == "thp") {
+      host_alloc_policy.huge_page = HUGE_PAGE_TRANSPARENT;
+    } else if (opts[1] == "hugetlb") {
+      host_alloc_policy.huge_page = HUGE_PAGE_HUGETLB;
+    } else {
+      LOG_ERROR() << "Unknown huge page mode: " << opts[1] << "\n";
+      PSAbort(1);
+    }
+    LOG_INFO() << "Using huge pages: " << opts[1] << "\n";
+  }
+}
+
+void FirstTouch(void *buf, size_t size) {
+  char *p = (char*)buf;
+  PSIndex num_chunks = (size + first_touch_chunk - 1) / first_touch_chunk;
+#pragma omp parallel for schedule(static)
+  for (PSIndex i = 0; i < num_chunks; ++i) {
+    size_t offset = i * first_touch_chunk;
+    memset(p + offset, 0, std::min(first_touch_chunk, size - offset));
+  }
+}
+
+void *HostAlloc(size_t size) {
+  if (size == 0) return NULL;
+  const HostAllocPolicy &policy = host_alloc_policy;
+  size_t header_size = RoundUp(sizeof(HostAllocHeader), policy.alignment);
+  HostAllocHeader header;
+  header.base = NULL;
+  header.length = size + header_size;
+  header.mapped = false;
+
+  if (policy.huge_page == HUGE_PAGE_HUGETLB) {
+#ifdef MAP_HUGETLB
+    size_t length = RoundUp(header.length, huge_page_size);
+    void *p = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      header.base = p;
+      header.length = length;
+      header.mapped = true;
+    } else {
+      static bool warned = false;
+      if (!warned) {
+        LOG_WARNING() << "Huge page allocation of " << length
+                      << " bytes failed; using normal pages\n";
+        warned = true;
+      }
+    }
+#else
+    LOG_WARNING() << "MAP_HUGETLB not supported\n";
+#endif
+  }
+
+  if (!header.base) {
+    // Aligning to the huge page size allows the whole region to be
+    // backed by transparent huge pages
+    size_t alignment = policy.huge_page == HUGE_PAGE_TRANSPARENT ?
+        std::max(policy.alignment, huge_page_size) : policy.alignment;
+    if (posix_memalign(&header.base, alignment, header.length)) {
+      return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (policy.huge_page == HUGE_PAGE_TRANSPARENT) {
+      madvise(header.base, header.length, MADV_HUGEPAGE);
+    }
+#endif
+  }
+
+  char *p = (char*)header.base + header_size;
+  memcpy(p - sizeof(HostAllocHeader), &header, sizeof(HostAllocHeader));
+  FirstTouch(p, size);
+  return p;
+}
+
+void HostFree(void *p) {
+  if (!p) return;
+  HostAllocHeader header;
+  memcpy(&header, (char*)p - sizeof(HostAllocHeader),
+         sizeof(HostAllocHeader));
+  if (header.mapped) {
+    munmap(header.base, header.length);
+  } else {
+    free(header.base);
+  }
+}
+
+} // namespace runtime
+} // namespace physis
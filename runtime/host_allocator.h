@@ -0,0 +1,67 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#ifndef PHYSIS_RUNTIME_HOST_ALLOCATOR_H_
+#define PHYSIS_RUNTIME_HOST_ALLOCATOR_H_
+
+#include "runtime/runtime_common.h"
+
+namespace physis {
+namespace runtime {
+
+enum HugePageMode {
+  HUGE_PAGE_NONE,
+  //! Advise the kernel to back the memory with transparent huge pages
+  HUGE_PAGE_TRANSPARENT,
+  //! Map explicitly reserved huge pages with MAP_HUGETLB
+  HUGE_PAGE_HUGETLB
+};
+
+//! Policy of host memory allocation for grids.
+struct HostAllocPolicy {
+  //! Alignment of returned memory in bytes; must be a power of two.
+  size_t alignment;
+  HugePageMode huge_page;
+  HostAllocPolicy(): alignment(64), huge_page(HUGE_PAGE_NONE) {}
+};
+
+extern HostAllocPolicy host_alloc_policy;
+
+//! Parse the allocation options and set host_alloc_policy.
+/*!
+  Options:
+  --physis-alloc-alignment <bytes>
+  --physis-huge-pages <thp|hugetlb>
+ */
+void ParseHostAllocOptions(int *argc, char ***argv);
+
+//! Allocate zero-filled memory according to host_alloc_policy.
+/*!
+  The memory is zero-filled by multiple threads with the static
+  OpenMP schedule so that each page is first touched by the thread,
+  and thus on the NUMA node, that processes it in the stencil loops.
+
+  \param size Size in bytes
+  \return NULL if size is zero.
+ */
+void *HostAlloc(size_t size);
+
+//! Zero-fill memory with the same partitioning as HostAlloc.
+/*!
+  Used for memory allocated by other means, e.g., MPI shared memory
+  windows.
+ */
+void FirstTouch(void *p, size_t size);
+
+//! Free memory allocated with HostAlloc.
+void HostFree(void *p);
+
+} // namespace runtime
+} // namespace physis
+
+#endif /* PHYSIS_RUNTIME_HOST_ALLOCATOR_H_ */
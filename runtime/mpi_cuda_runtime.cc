@@ -81,14 +81,15 @@ void InitCUDA(int my_rank, int num_local_processes) {
   cudaThreadExit. 
 */
 void Checkpoint() {
-  gs->Save();
+  // Device buffers are released by saving each grid individually
+  gs->GridSpace::Save();
   CUDA_SAFE_CALL(cudaThreadExit());
 }
 
 //! Preliminary restart support
 void Restart() {
   InitCUDA(pinfo->rank(), num_local_processes);
-  gs->Restore();
+  gs->GridSpace::Restore();
 }
 
 template <class T>
@@ -129,6 +130,13 @@ extern "C" {
     IndexArray grid_size;
     
     physis::runtime::PSInitCommon(argc, argv);
+
+    // Write checkpoints in a background thread
+    bool async_checkpoint = false;
+    vector<string> opts;
+    if (ParseOption(argc, argv, "physis-async-checkpoint", 0, opts)) {
+      async_checkpoint = true;
+    }
             
     va_start(vl, grid_num_dims);
     for (int i = 0; i < grid_num_dims; ++i) {
@@ -138,8 +146,13 @@ extern "C" {
     __PSStencilRunClientFunction *stencil_funcs
         = va_arg(vl, __PSStencilRunClientFunction*);
     va_end(vl);
-    
-    MPI_Init(argc, argv);
+
+    if (async_checkpoint) {
+      int provided;
+      MPI_Init_thread(argc, argv, MPI_THREAD_MULTIPLE, &provided);
+    } else {
+      MPI_Init(argc, argv);
+    }
     MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
@@ -165,6 +178,7 @@ extern "C" {
 
     gs = new GridSpaceMPICUDA(grid_num_dims, grid_size,
                               proc_num_dims, proc_size, rank);
+    gs->set_async_checkpoint(async_checkpoint);
 
     LOG_INFO() << "Grid space: " << *gs << "\n";
 
@@ -356,6 +370,26 @@ extern "C" {
     return;
   }
 
+  // same as mpi_runtime.cc
+  void PSGridLoadFile(void *g, const char *path) {
+    master->GridLoadFile((GridMPI*)g, path);
+  }
+
+  // same as mpi_runtime.cc
+  void PSGridSaveFile(void *g, const char *path) {
+    master->GridSaveFile((GridMPI*)g, path);
+  }
+
+  // same as mpi_runtime.cc
+  void PSCheckpoint() {
+    master->Checkpoint();
+  }
+
+  // same as mpi_runtime.cc
+  void PSRestart() {
+    master->Restart();
+  }
+
   // same as mpi_runtime.cc
   void __PSStencilRun(int id, int iter, int num_stencils, ...) {
     //master->StencilRun(id, stencil_obj_size, stencil_obj, iter);
@@ -18,6 +18,7 @@
 #include "physis/physis_util.h"
 #include "runtime/grid_mpi_debug_util.h"
 #include "runtime/mpi_util.h"
+#include "runtime/threading.h"
 
 using std::map;
 using std::string;
@@ -34,6 +35,9 @@ GridSpaceMPI *gs;
 
 __PSStencilRunClientFunction *__PS_stencils;
 
+// Halo padding required by the translated code
+static unsigned min_halo_padding = 0;
+
 } // namespace runtime
 } // namespace physis
 
@@ -79,6 +83,13 @@ static T *__PSGridGetAddr(GridMPI *gm, IndexArray indices) {
     return ((T*)(rmg->_data())) +
         __PSGridCalcOffset3D(indices, rmg->local_size());
   }
+
+  // Halos are contiguous with the local subgrid
+  if (gm->halo_padded()) {
+    indices -= gm->local_real_offset();
+    return ((T*)(gm->_data())) +
+        __PSGridCalcOffset3D(indices, gm->local_real_size());
+  }
   
   indices -= gm->local_offset();
   bool diag = gm->halo_has_diagonal();
@@ -111,8 +122,8 @@ T *__PSGridEmitAddr3D(__PSGridMPI *g, PSIndex x, PSIndex y,
                       PSIndex z) {
   GridMPI *gm = (GridMPI*)g;
   PSIndex off = __PSGridCalcOffset3D(x, y, z,
-                                     gm->local_offset(),
-                                     gm->local_size());
+                                     gm->local_real_offset(),
+                                     gm->local_real_size());
   return ((T*)(gm->_data_emit())) + off;
 }    
 
@@ -121,8 +132,8 @@ T *__PSGridGetAddrNoHalo3D(__PSGridMPI *g, PSIndex x, PSIndex y,
                            PSIndex z) {
   GridMPI *gm = (GridMPI*)g;
   PSIndex off = __PSGridCalcOffset3D(x, y, z,
-                                     gm->local_offset(),
-                                     gm->local_size());
+                                     gm->local_real_offset(),
+                                     gm->local_real_size());
   return ((T*)(gm->_data_emit())) + off;
 }    
 
@@ -158,6 +169,51 @@ extern "C" {
     IndexArray grid_size;
 
     physis::runtime::PSInitCommon(argc, argv);
+
+    // Halo padding of grids
+    unsigned halo_padding = 0;
+    std::vector<string> opts;
+    if (ParseOption(argc, argv, "physis-halo-padding", 1, opts)) {
+      int w = physis::toInteger(opts[1]);
+      if (w < 0) {
+        LOG_ERROR() << "Invalid halo padding: " << opts[1] << "\n";
+        PSAbort(1);
+      }
+      halo_padding = w;
+    }
+    halo_padding = std::max(halo_padding, min_halo_padding);
+    // Exchange halos with all neighbors at once
+    bool simultaneous_exchange = false;
+    opts.clear();
+    if (ParseOption(argc, argv, "physis-simultaneous-halo-exchange", 0,
+                    opts)) {
+      simultaneous_exchange = true;
+    }
+    // Write checkpoints in a background thread
+    bool async_checkpoint = false;
+    opts.clear();
+    if (ParseOption(argc, argv, "physis-async-checkpoint", 0, opts)) {
+      async_checkpoint = true;
+    }
+    // Transport of halo exchanges
+    HaloTransport halo_transport = HALO_TRANSPORT_P2P;
+    opts.clear();
+    if (ParseOption(argc, argv, "physis-halo-transport", 1, opts)) {
+      if (opts[1] == "rma") {
+        halo_transport = HALO_TRANSPORT_RMA;
+      } else if (opts[1] == "shm") {
+        halo_transport = HALO_TRANSPORT_SHM;
+      } else if (opts[1] != "p2p") {
+        LOG_ERROR() << "Unknown halo transport: " << opts[1] << "\n";
+        PSAbort(1);
+      }
+    }
+    // All processes execute the program
+    bool spmd = false;
+    opts.clear();
+    if (ParseOption(argc, argv, "physis-spmd", 0, opts)) {
+      spmd = true;
+    }
             
     va_start(vl, grid_num_dims);
     for (int i = 0; i < grid_num_dims; ++i) {
@@ -167,13 +223,27 @@ extern "C" {
     __PSStencilRunClientFunction *stencil_funcs
         = va_arg(vl, __PSStencilRunClientFunction*);
     va_end(vl);
-    
-    MPI_Init(argc, argv);
+
+    if (async_checkpoint) {
+      int provided;
+      MPI_Init_thread(argc, argv, MPI_THREAD_MULTIPLE, &provided);
+    } else if (GetNumThreads() > 1) {
+      // Hybrid execution; only the main thread calls MPI, while
+      // stencils and halo packing use all threads
+      int provided;
+      MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+      if (provided < MPI_THREAD_FUNNELED) {
+        LOG_WARNING() << "MPI_THREAD_FUNNELED not supported\n";
+      }
+    } else {
+      MPI_Init(argc, argv);
+    }
     MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
     pinfo = new ProcInfo(rank, num_procs);
     LOG_INFO() << *pinfo << "\n";
+    LOG_INFO() << "Threads per process: " << GetNumThreads() << "\n";
 
     IntArray proc_size;
     proc_size.Set(1);
@@ -191,6 +261,28 @@ extern "C" {
     gs = new GridSpaceMPI(grid_num_dims, grid_size,
                           proc_num_dims, proc_size, rank);
 
+    gs->set_halo_padding(halo_padding);
+    // Deep halos are only exchanged with the immediate neighbors
+    if (min_halo_padding > 0) {
+      for (int i = 0; i < grid_num_dims; ++i) {
+        if (proc_size[i] < 2) continue;
+        for (int j = 0; j < proc_size[i]; ++j) {
+          if (gs->partitions()[i][j] < (PSIndex)min_halo_padding) {
+            LOG_ERROR() << "Subgrids of dimension " << i
+                        << " are thinner than the halo width "
+                        << min_halo_padding << "; use fewer processes.\n";
+            PSAbort(1);
+          }
+        }
+      }
+    }
+    gs->set_simultaneous_exchange(simultaneous_exchange);
+    if (halo_transport != HALO_TRANSPORT_P2P && halo_padding == 0) {
+      LOG_WARNING() << "RMA and SHM halo transports require halo padding; "
+                    << "using point-to-point messages\n";
+    }
+    gs->set_halo_transport(halo_transport);
+    gs->set_async_checkpoint(async_checkpoint);
     LOG_INFO() << "Grid space: " << *gs << "\n";
 
     // Set the stencil client functions
@@ -199,7 +291,11 @@ extern "C" {
                                               * num_stencil_run_calls);
     memcpy(__PS_stencils, stencil_funcs,
            sizeof(__PSStencilRunClientFunction) * num_stencil_run_calls);
-    if (rank != 0) {
+    if (spmd) {
+      LOG_DEBUG() << "SPMD execution\n";
+      master = new SPMDMaster(*pinfo, gs, MPI_COMM_WORLD);
+      client = NULL;
+    } else if (rank != 0) {
       LOG_DEBUG() << "I'm a client.\n";
       client = new Client(*pinfo, gs, MPI_COMM_WORLD);
       client->Listen();
@@ -212,6 +308,10 @@ extern "C" {
     
   }
 
+  void __PSSetMinHaloPadding(int width) {
+    min_halo_padding = std::max(min_halo_padding, (unsigned)width);
+  }
+
   void PSFinalize() {
     master->Finalize();
   }
@@ -367,6 +467,22 @@ extern "C" {
     return;
   }
 
+  void PSGridLoadFile(void *g, const char *path) {
+    master->GridLoadFile((GridMPI*)g, path);
+  }
+
+  void PSGridSaveFile(void *g, const char *path) {
+    master->GridSaveFile((GridMPI*)g, path);
+  }
+
+  void PSCheckpoint() {
+    master->Checkpoint();
+  }
+
+  void PSRestart() {
+    master->Restart();
+  }
+
   void __PSStencilRun(int id, int iter, int num_stencils, ...) {
     //master->StencilRun(id, stencil_obj_size, stencil_obj, iter);
     void **stencils = new void*[num_stencils];
@@ -466,18 +582,108 @@ extern "C" {
     return __PSGridEmitAddr3D<double>(g, x, y, z);
   }
   
+  __PSGridMPIDesc __PSGridGetDesc(__PSGridMPI *g) {
+    GridMPI *gm = (GridMPI*)g;
+    // Reads are redirected to the remote grid when it is activated
+    GridMPI *rg = gm->remote_grid_active() ? gm->remote_grid() : gm;
+    __PSGridMPIDesc d;
+    d.p = rg->_data();
+    d.p_emit = gm->_data_emit();
+    for (int i = 0; i < PS_MAX_DIM; ++i) {
+      d.offset[i] = rg->local_real_offset()[i];
+      d.size[i] = rg->local_real_size()[i];
+      d.local_offset[i] = gm->local_real_offset()[i];
+      d.local_size[i] = gm->local_real_size()[i];
+    }
+    return d;
+  }
+  
   void __PSLoadNeighbor(__PSGridMPI *g,
                         const PSVectorInt offset_min,
                         const PSVectorInt offset_max,
                         int diagonal, int reuse, int overlap,
                         int periodic) {
-    if (overlap) LOG_WARNING() << "Overlap possible, but not implemented\n";
     GridMPI *gm = (GridMPI*)g;
     gs->LoadNeighbor(gm, IndexArray(offset_min), IndexArray(offset_max),
                      (bool)diagonal, reuse, periodic);
     return;
   }
 
+  void __PSLoadNeighborBegin(__PSGridMPI *g,
+                             const PSVectorInt offset_min,
+                             const PSVectorInt offset_max,
+                             int diagonal, int reuse, int overlap,
+                             int periodic) {
+    PSAssert(overlap);
+    GridMPI *gm = (GridMPI*)g;
+    gs->LoadNeighborBegin(gm, IndexArray(offset_min),
+                          IndexArray(offset_max),
+                          (bool)diagonal, reuse, periodic);
+    return;
+  }
+
+  void __PSLoadNeighborEnd() {
+    gs->LoadNeighborEnd();
+    return;
+  }
+
+  __PSDomain __PSDomainShrink(__PSDomain *dom, int width) {
+    __PSDomain shrinked_dom = *dom;
+    for (int i = 0; i < PS_MAX_DIM; ++i) {
+      shrinked_dom.local_min[i] += width;
+      shrinked_dom.local_max[i] -= width;
+      // Nothing left when the domain is thinner than the shell
+      if (shrinked_dom.local_max[i] < shrinked_dom.local_min[i]) {
+        shrinked_dom.local_max[i] = shrinked_dom.local_min[i];
+      }
+    }
+    return shrinked_dom;
+  }
+
+  __PSDomain __PSDomainExtend(__PSDomain *dom, int width) {
+    __PSDomain extended_dom = *dom;
+    IndexArray local_min = gs->my_offset();
+    IndexArray local_max = gs->my_offset() + gs->my_size();
+    for (int i = 0; i < gs->num_dims(); ++i) {
+      local_min[i] -= width;
+      local_max[i] += width;
+    }
+    local_min.SetNoLessThan(IndexArray(dom->min));
+    local_max.SetNoMoreThan(IndexArray(dom->max));
+    // No corresponding local region
+    if (local_min >= local_max) {
+      local_min.Set(0);
+      local_max.Set(0);
+    }
+    local_min.Set(extended_dom.local_min);
+    local_max.Set(extended_dom.local_max);
+    return extended_dom;
+  }
+
+  __PSDomain __PSDomainGetShell(__PSDomain *dom, int dim, int right,
+                                int width) {
+    __PSDomain shell = *dom;
+    PSIndex min = dom->local_min[dim];
+    PSIndex max = dom->local_max[dim];
+    if (right) {
+      // Exclude the backward slab when the domain is thinner than
+      // the shell 
+      shell.local_min[dim] = std::max(max - width, min + width);
+      shell.local_max[dim] = std::max(max, shell.local_min[dim]);
+    } else {
+      shell.local_max[dim] = std::min(min + width, max);
+    }
+    // The higher dimensions are limited to the interior
+    for (int i = dim + 1; i < PS_MAX_DIM; ++i) {
+      shell.local_min[i] += width;
+      shell.local_max[i] -= width;
+      if (shell.local_max[i] < shell.local_min[i]) {
+        shell.local_max[i] = shell.local_min[i];
+      }
+    }
+    return shell;
+  }
+
   void __PSLoadSubgrid(__PSGridMPI *g, const __PSGridRange *gr,
                        int reuse) {
     // NOTE: This should be very rare. Not sure it should actually be
@@ -535,6 +741,16 @@ extern "C" {
                             __PSGridMPI *g) {
     master->GridReduce(buf, op, (GridMPI*)g);    
   }
+
+  void __PSReduceAllFloat(float *v, enum PSReduceOp op) {
+    PS_MPI_Allreduce(MPI_IN_PLACE, v, 1, MPI_FLOAT, GetMPIOp(op),
+                     MPI_COMM_WORLD);
+  }
+
+  void __PSReduceAllDouble(double *v, enum PSReduceOp op) {
+    PS_MPI_Allreduce(MPI_IN_PLACE, v, 1, MPI_DOUBLE, GetMPIOp(op),
+                     MPI_COMM_WORLD);
+  }
   
 
 #ifdef __cplusplus
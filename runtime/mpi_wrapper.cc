@@ -9,14 +9,23 @@
 #include "runtime/mpi_wrapper.h"
 #include "physis/physis_util.h"
 #include "runtime/mpi_util.h"
+#include "runtime/profiler.h"
 
 namespace physis {
 namespace runtime {
 
+static void CountMessage(int count, MPI_Datatype datatype) {
+  if (!performance::profiler.enabled()) return;
+  int type_size;
+  CHECK_MPI(MPI_Type_size(datatype, &type_size));
+  performance::profiler.CountMessages(1, (size_t)count * type_size);
+}
+
 int PS_MPI_Send( void *buf, int count, MPI_Datatype datatype, int dest, 
                  int tag, MPI_Comm comm ) {
   LOG_VERBOSE() << "MPI_Send " << count << " entries to " << dest << "\n";
   CHECK_MPI(MPI_Send(buf, count, datatype, dest, tag, comm));
+  CountMessage(count, datatype);
   return MPI_SUCCESS;
 }
 
@@ -24,6 +33,7 @@ int PS_MPI_Isend(void *buf, int count, MPI_Datatype datatype, int dest, int tag,
                  MPI_Comm comm, MPI_Request *request) {
   LOG_VERBOSE() << "MPI_Isend " << count << " entries to " << dest << "\n";
   CHECK_MPI(MPI_Isend(buf, count, datatype, dest, tag, comm, request));
+  CountMessage(count, datatype);
   return MPI_SUCCESS;
 }
 
@@ -41,6 +51,19 @@ int PS_MPI_Irecv( void *buf, int count, MPI_Datatype datatype, int source,
   return MPI_SUCCESS;
 }
 
+int PS_MPI_Send_init(void *buf, int count, MPI_Datatype datatype, int dest,
+                     int tag, MPI_Comm comm, MPI_Request *request) {
+  LOG_VERBOSE() << "MPI_Send_init " << count << " entries to " << dest << "\n";
+  CHECK_MPI(MPI_Send_init(buf, count, datatype, dest, tag, comm, request));
+  return MPI_SUCCESS;
+}
+
+int PS_MPI_Recv_init(void *buf, int count, MPI_Datatype datatype, int source,
+                     int tag, MPI_Comm comm, MPI_Request *request) {
+  LOG_VERBOSE() << "MPI_Recv_init " << count << " entries from " << source << "\n";
+  CHECK_MPI(MPI_Recv_init(buf, count, datatype, source, tag, comm, request));
+  return MPI_SUCCESS;
+}
 
 int PS_MPI_Bcast( void *buffer, int count, MPI_Datatype datatype, int root, 
                   MPI_Comm comm ) {
@@ -57,6 +80,14 @@ int PS_MPI_Reduce(void *sendbuf, void *recvbuf, int count,
   return MPI_SUCCESS;
 }
 
+int PS_MPI_Allreduce(void *sendbuf, void *recvbuf, int count,
+                     MPI_Datatype datatype, MPI_Op op,
+                     MPI_Comm comm) {
+  CHECK_MPI(MPI_Allreduce(sendbuf, recvbuf, count, datatype,
+                          op, comm));
+  return MPI_SUCCESS;
+}
+
 } // namespace runtime
 } // namespace physis
 
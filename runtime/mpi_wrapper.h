@@ -31,12 +31,24 @@ extern int PS_MPI_Irecv( void *buf, int count, MPI_Datatype datatype,
                          int source, 
                          int tag, MPI_Comm comm, MPI_Request *request );
 
+extern int PS_MPI_Send_init(void *buf, int count, MPI_Datatype datatype,
+                            int dest, int tag, MPI_Comm comm,
+                            MPI_Request *request);
+
+extern int PS_MPI_Recv_init(void *buf, int count, MPI_Datatype datatype,
+                            int source, int tag, MPI_Comm comm,
+                            MPI_Request *request);
+
 extern int PS_MPI_Bcast(void *buffer, int count, MPI_Datatype datatype,
                         int root, MPI_Comm comm);
 
 extern int PS_MPI_Reduce(void *sendbuf, void *recvbuf, int count,
                          MPI_Datatype datatype, MPI_Op op,
                          int root, MPI_Comm comm);
+
+extern int PS_MPI_Allreduce(void *sendbuf, void *recvbuf, int count,
+                            MPI_Datatype datatype, MPI_Op op,
+                            MPI_Comm comm);
                          
 
 } // namespace runtime
@@ -0,0 +1,280 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "runtime/profiler.h"
+#include "runtime/roofline.h"
+#include "physis/runtime.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sys/time.h>
+
+using std::string;
+
+int __ps_profile;
+
+namespace physis {
+namespace runtime {
+namespace performance {
+
+Profiler profiler;
+
+//! Events recorded beyond this are only accumulated into the totals.
+static const size_t max_num_events = 1 << 20;
+
+static double GetTime() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+Profiler::Profiler():
+    enabled_(false), origin_(0.0), events_truncated_(false),
+    current_stencil_(-1), stencil_start_(0.0), depth_(0),
+    num_messages_(0.0), message_bytes_(0.0) {
+  for (int i = 0; i < NUM_PROFILE_PHASES; ++i) {
+    phase_time_[i] = phase_count_[i] = phase_bytes_[i] = 0.0;
+  }
+}
+
+void Profiler::Enable(const string &prefix) {
+  enabled_ = true;
+  prefix_ = prefix;
+  origin_ = GetTime();
+  __ps_profile = 1;
+}
+
+double Profiler::Now() const {
+  return GetTime() - origin_;
+}
+
+const char *Profiler::GetPhaseName(ProfilePhase phase) {
+  static const char *names[NUM_PROFILE_PHASES] = {
+    "stencil", "halo_pack", "mpi_wait", "load_subgrid", "reduce",
+    "copyin", "copyout"};
+  return names[phase];
+}
+
+void Profiler::BeginStencil(const char *name) {
+  string s(name);
+  std::map<string, int>::iterator it = stencil_ids_.find(s);
+  if (it == stencil_ids_.end()) {
+    it = stencil_ids_.insert(
+        std::make_pair(s, (int)stencil_names_.size())).first;
+    stencil_names_.push_back(s);
+    stencils_.push_back(StencilProfile());
+  }
+  current_stencil_ = it->second;
+  stencil_start_ = Now();
+}
+
+void Profiler::EndStencil() {
+  if (current_stencil_ < 0) return;
+  // The stencil itself is the enclosing stencil of the event
+  Record(PROFILE_STENCIL, stencil_start_, 0);
+  current_stencil_ = -1;
+}
+
+void Profiler::AddStencilModel(double flops, double bytes) {
+  if (current_stencil_ < 0) return;
+  stencils_[current_stencil_].flops += flops;
+  stencils_[current_stencil_].bytes += bytes;
+}
+
+void Profiler::Record(ProfilePhase phase, double start, size_t bytes) {
+  double duration = Now() - start;
+  phase_time_[phase] += duration;
+  phase_count_[phase] += 1;
+  phase_bytes_[phase] += bytes;
+  if (phase != PROFILE_STENCIL) --depth_;
+  if (current_stencil_ >= 0) {
+    StencilProfile &sp = stencils_[current_stencil_];
+    if (phase == PROFILE_STENCIL) {
+      ++sp.count;
+      sp.time += duration;
+    } else if (depth_ == 0) {
+      // Phases nested in other phases are already included
+      sp.nested_time += duration;
+    }
+  }
+  if (events_.size() == max_num_events) {
+    events_truncated_ = true;
+    return;
+  }
+  Event e = {phase, current_stencil_, start, duration, bytes};
+  events_.push_back(e);
+}
+
+void Profiler::CountMessages(int num, size_t bytes) {
+  num_messages_ += num;
+  message_bytes_ += bytes;
+}
+
+static void WriteJSONString(std::ostream &os, const string &s) {
+  os << '"';
+  FOREACH (it, s.begin(), s.end()) {
+    if (*it == '"' || *it == '\\') os << '\\';
+    os << *it;
+  }
+  os << '"';
+}
+
+void Profiler::WriteTrace(int rank) const {
+  string path = prefix_ + "." + toString(rank) + ".json";
+  std::ofstream os(path.c_str());
+  if (!os) {
+    LOG_ERROR() << "Failed to open " << path << "\n";
+    return;
+  }
+  if (events_truncated_) {
+    LOG_WARNING() << "Trace truncated to the first " << max_num_events
+                  << " events\n";
+  }
+  os << std::fixed << std::setprecision(3);
+  os << "{\"traceEvents\":[\n";
+  os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank
+     << ",\"args\":{\"name\":\"rank " << rank << "\"}}";
+  FOREACH (it, events_.begin(), events_.end()) {
+    const Event &e = *it;
+    os << ",\n{\"name\":";
+    if (e.phase == PROFILE_STENCIL) {
+      WriteJSONString(os, stencil_names_[e.stencil]);
+    } else {
+      WriteJSONString(os, GetPhaseName(e.phase));
+    }
+    os << ",\"cat\":\"" << GetPhaseName(e.phase) << "\""
+       << ",\"ph\":\"X\",\"pid\":" << rank << ",\"tid\":0"
+       << ",\"ts\":" << e.start << ",\"dur\":" << e.duration
+       << ",\"args\":{";
+    if (e.stencil >= 0) {
+      os << "\"stencil\":";
+      WriteJSONString(os, stencil_names_[e.stencil]);
+      os << ",";
+    }
+    os << "\"bytes\":" << e.bytes << "}}";
+  }
+  os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  LOG_INFO() << "Profile written to " << path << "\n";
+}
+
+// Phases that move grid data
+static bool IsDataPhase(ProfilePhase phase) {
+  return phase == PROFILE_HALO_PACK || phase == PROFILE_LOAD_SUBGRID ||
+      phase == PROFILE_COPYIN || phase == PROFILE_COPYOUT;
+}
+
+void Profiler::GetTotalNames(std::vector<string> &names) {
+  names.push_back("kernel (ms)");
+  for (int i = PROFILE_STENCIL + 1; i < NUM_PROFILE_PHASES; ++i) {
+    names.push_back(string(GetPhaseName((ProfilePhase)i)) + " (ms)");
+  }
+  for (int i = PROFILE_STENCIL + 1; i < NUM_PROFILE_PHASES; ++i) {
+    if (!IsDataPhase((ProfilePhase)i)) continue;
+    names.push_back(string(GetPhaseName((ProfilePhase)i)) + " (bytes)");
+  }
+  names.push_back("stencil runs");
+  names.push_back("messages sent");
+  names.push_back("bytes sent");
+}
+
+void Profiler::GetTotals(std::vector<double> &totals) const {
+  double kernel_time = 0.0;
+  double num_runs = 0.0;
+  FOREACH (it, stencils_.begin(), stencils_.end()) {
+    kernel_time += it->time - it->nested_time;
+    num_runs += it->count;
+  }
+  totals.push_back(kernel_time * 1e-3);
+  for (int i = PROFILE_STENCIL + 1; i < NUM_PROFILE_PHASES; ++i) {
+    totals.push_back(phase_time_[i] * 1e-3);
+  }
+  for (int i = PROFILE_STENCIL + 1; i < NUM_PROFILE_PHASES; ++i) {
+    if (!IsDataPhase((ProfilePhase)i)) continue;
+    totals.push_back(phase_bytes_[i]);
+  }
+  totals.push_back(num_runs);
+  totals.push_back(num_messages_);
+  totals.push_back(message_bytes_);
+}
+
+std::ostream &Profiler::PrintStencils(std::ostream &os) const {
+  os << "Physis profile:\n";
+  os << std::setw(32) << std::left << "stencil" << std::right
+     << std::setw(8) << "runs" << std::setw(14) << "total (ms)"
+     << std::setw(14) << "kernel (ms)" << std::setw(12) << "GFLOP/s"
+     << std::setw(12) << "GB/s";
+  if (roofline.IsSet()) os << std::setw(12) << "roofline";
+  os << "\n";
+  ENUMERATE (i, it, stencils_.begin(), stencils_.end()) {
+    double kernel_time = it->time - it->nested_time;
+    os << std::setw(32) << std::left << stencil_names_[i] << std::right
+       << std::setw(8) << it->count
+       << std::setw(14) << it->time * 1e-3
+       << std::setw(14) << kernel_time * 1e-3;
+    // Rates are based on the kernel time
+    double gflops = 0.0, gbs = 0.0;
+    if (kernel_time > 0.0) {
+      gflops = it->flops / kernel_time * 1e-3;
+      gbs = it->bytes / kernel_time * 1e-3;
+    }
+    os << std::setw(12) << gflops << std::setw(12) << gbs;
+    if (roofline.IsSet()) {
+      os << std::setw(11) << roofline.GetFraction(gflops, gbs) * 100.0
+         << "%";
+    }
+    os << "\n";
+  }
+  return os;
+}
+
+std::ostream &Profiler::PrintSummary(std::ostream &os) const {
+  PrintStencils(os);
+  std::vector<double> totals;
+  GetTotals(totals);
+  return PrintTotals(os, 1, totals, totals, totals);
+}
+
+std::ostream &Profiler::PrintTotals(std::ostream &os, int num_procs,
+                                    const std::vector<double> &min,
+                                    const std::vector<double> &avg,
+                                    const std::vector<double> &max) {
+  std::vector<string> names;
+  GetTotalNames(names);
+  os << std::setw(32) << std::left << "total" << std::right;
+  if (num_procs > 1) {
+    os << std::setw(16) << "min" << std::setw(16) << "avg"
+       << std::setw(16) << "max" << std::setw(10) << "max/avg";
+  }
+  os << "\n";
+  ENUMERATE (i, it, names.begin(), names.end()) {
+    os << std::setw(32) << std::left << *it << std::right;
+    if (num_procs > 1) {
+      os << std::setw(16) << min[i] << std::setw(16) << avg[i]
+         << std::setw(16) << max[i] << std::setw(10)
+         << (avg[i] > 0.0 ? max[i] / avg[i] : 1.0);
+    } else {
+      os << std::setw(16) << avg[i];
+    }
+    os << "\n";
+  }
+  return os;
+}
+
+} // namespace performance
+} // namespace runtime
+} // namespace physis
+
+extern "C" {
+  void __PSProfileStencilBegin(const char *msg) {
+    physis::runtime::performance::profiler.BeginStencil(msg);
+  }
+
+  void __PSProfileStencilEnd(void) {
+    physis::runtime::performance::profiler.EndStencil();
+  }
+}
@@ -0,0 +1,143 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#ifndef PHYSIS_RUNTIME_PROFILER_H_
+#define PHYSIS_RUNTIME_PROFILER_H_
+
+#include "runtime/runtime_common.h"
+
+#include <string>
+#include <map>
+
+namespace physis {
+namespace runtime {
+namespace performance {
+
+enum ProfilePhase {
+  //! Whole stencil run including the nested phases below
+  PROFILE_STENCIL,
+  //! Packing halos into send buffers (GridMPI::CopyoutHalo)
+  PROFILE_HALO_PACK,
+  //! Waiting for completion of halo exchanges
+  PROFILE_MPI_WAIT,
+  //! Fetching remote subgrids (LoadSubgrid and LoadNeighbor)
+  PROFILE_LOAD_SUBGRID,
+  PROFILE_REDUCE,
+  PROFILE_COPYIN,
+  PROFILE_COPYOUT,
+  NUM_PROFILE_PHASES
+};
+
+//! Records the time spent in each runtime phase.
+/*!
+  Enabled with the --physis-profile <prefix> option. Each phase
+  occurrence is recorded as an event tagged with the stencil run
+  being executed, and is accumulated into per-phase totals. The
+  events of each process are written as a Chrome trace file
+  (<prefix>.<rank>.json), which can be loaded into chrome://tracing
+  or Perfetto. The kernel time is the time of stencil runs not spent
+  in any nested phase.
+
+  Events are recorded only by the thread calling the runtime API.
+ */
+class Profiler {
+ public:
+  Profiler();
+  bool enabled() const { return enabled_; }
+  //! Enable profiling, writing traces to files starting with prefix.
+  void Enable(const std::string &prefix);
+  //! Micro seconds since the profiler was enabled.
+  double Now() const;
+  //! Start a phase and return its start time.
+  double Begin() { ++depth_; return Now(); }
+  void BeginStencil(const char *name);
+  void EndStencil();
+  //! Add the modeled flops and bytes of the current stencil run.
+  void AddStencilModel(double flops, double bytes);
+  //! Record a phase that started at start by Begin and ends now.
+  void Record(ProfilePhase phase, double start, size_t bytes);
+  //! Count sent messages.
+  void CountMessages(int num, size_t bytes);
+  //! Write the events as Chrome trace JSON.
+  void WriteTrace(int rank) const;
+  //! Accumulated totals in the order of GetTotalNames.
+  void GetTotals(std::vector<double> &totals) const;
+  static void GetTotalNames(std::vector<std::string> &names);
+  //! Print the per-stencil breakdown of this process.
+  std::ostream &PrintStencils(std::ostream &os) const;
+  //! Print the per-stencil breakdown and the totals.
+  std::ostream &PrintSummary(std::ostream &os) const;
+  //! Print the totals reduced across num_procs processes.
+  static std::ostream &PrintTotals(std::ostream &os, int num_procs,
+                                   const std::vector<double> &min,
+                                   const std::vector<double> &avg,
+                                   const std::vector<double> &max);
+  static const char *GetPhaseName(ProfilePhase phase);
+
+ protected:
+  struct Event {
+    ProfilePhase phase;
+    //! Index of the enclosing stencil run; negative if none.
+    int stencil;
+    double start;
+    double duration;
+    size_t bytes;
+  };
+  struct StencilProfile {
+    int count;
+    double time;
+    //! Time of the nested phases
+    double nested_time;
+    //! Flops and bytes given by the performance model
+    double flops;
+    double bytes;
+    StencilProfile(): count(0), time(0.0), nested_time(0.0),
+                      flops(0.0), bytes(0.0) {}
+  };
+  bool enabled_;
+  std::string prefix_;
+  double origin_;
+  std::vector<Event> events_;
+  bool events_truncated_;
+  std::vector<std::string> stencil_names_;
+  std::map<std::string, int> stencil_ids_;
+  std::vector<StencilProfile> stencils_;
+  int current_stencil_;
+  double stencil_start_;
+  //! Number of phases in progress
+  int depth_;
+  double phase_time_[NUM_PROFILE_PHASES];
+  double phase_count_[NUM_PROFILE_PHASES];
+  double phase_bytes_[NUM_PROFILE_PHASES];
+  double num_messages_;
+  double message_bytes_;
+};
+
+extern Profiler profiler;
+
+//! Records the enclosing block as a phase if profiling is enabled.
+class ProfileScope {
+ public:
+  explicit ProfileScope(ProfilePhase phase, size_t bytes=0):
+      phase_(phase), bytes_(bytes), start_(0.0) {
+    if (profiler.enabled()) start_ = profiler.Begin();
+  }
+  ~ProfileScope() {
+    if (profiler.enabled()) profiler.Record(phase_, start_, bytes_);
+  }
+ private:
+  ProfilePhase phase_;
+  size_t bytes_;
+  double start_;
+};
+
+} // namespace performance
+} // namespace runtime
+} // namespace physis
+
+#endif /* PHYSIS_RUNTIME_PROFILER_H_ */
@@ -9,48 +9,195 @@
 #ifndef PHYSIS_RUNTIME_REDUCE_H_
 #define PHYSIS_RUNTIME_REDUCE_H_
 
-#include <functional>
-#include <boost/function.hpp>
+#include "runtime/runtime_common.h"
+
 #include <float.h>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace physis {
 namespace runtime {
 
+//! Number of independent accumulators of reduction loops.
+/*!
+  Partial results are kept in multiple accumulators so that
+  consecutive elements can be reduced with SIMD instructions.
+ */
+const int kReductionLanes = 16;
+//! Grids smaller than this are reduced by a single thread.
+const size_t kParallelReductionMinSize = 1 << 16;
+//! Maximum number of threads used for a reduction.
+const int kMaxReductionThreads = 256;
+
 template <class T>
-struct MaxOp: public std::binary_function<T, T, T> {
-  T operator()(T x, T y) {
+struct MaxOp {
+  static T Apply(T x, T y) {
     return (x > y) ? x : y;
   }
 };
   
 template <class T>
-struct MinOp: public std::binary_function<T, T, T> {
-  T operator()(T x, T y) {
+struct MinOp {
+  static T Apply(T x, T y) {
     return (x < y) ? x : y;
   }
 };
 
 template <class T>
-boost::function<T (T, T)> GetReducer(PSReduceOp op) {
-  boost::function<T (T, T)> func;  
+struct SumOp {
+  static T Apply(T x, T y) {
+    return x + y;
+  }
+};
+
+template <class T>
+struct ProdOp {
+  static T Apply(T x, T y) {
+    return x * y;
+  }
+};
+
+//! Reduce a non-empty contiguous array with the calling thread.
+template <class T, class Op>
+T ReduceArraySerial(const T *d, size_t n) {
+  if (n < (size_t)kReductionLanes * 2) {
+    T v = d[0];
+    for (size_t i = 1; i < n; ++i) {
+      v = Op::Apply(v, d[i]);
+    }
+    return v;
+  }
+  T acc[kReductionLanes];
+  for (int j = 0; j < kReductionLanes; ++j) {
+    acc[j] = d[j];
+  }
+  size_t i = kReductionLanes;
+  for (; i + kReductionLanes <= n; i += kReductionLanes) {
+    for (int j = 0; j < kReductionLanes; ++j) {
+      acc[j] = Op::Apply(acc[j], d[i+j]);
+    }
+  }
+  for (; i < n; ++i) {
+    acc[0] = Op::Apply(acc[0], d[i]);
+  }
+  T v = acc[0];
+  for (int j = 1; j < kReductionLanes; ++j) {
+    v = Op::Apply(v, acc[j]);
+  }
+  return v;
+}
+
+// Returns the number of chunks to reduce in parallel. The partial
+// results are combined in the order of the chunks, so the result does
+// not depend on the number of threads actually running.
+inline int GetNumReductionChunks(size_t n) {
+#ifdef _OPENMP
+  if (n >= kParallelReductionMinSize) {
+    return std::min(omp_get_max_threads(), kMaxReductionThreads);
+  }
+#endif
+  return 1;
+}
+
+//! Reduce a non-empty contiguous array.
+template <class T, class Op>
+T ReduceArray(const T *d, size_t n) {
+  int nc = GetNumReductionChunks(n);
+  if (nc == 1) return ReduceArraySerial<T, Op>(d, n);
+  T partial[kMaxReductionThreads];
+#pragma omp parallel for schedule(static)
+  for (int c = 0; c < nc; ++c) {
+    size_t begin = n * c / nc;
+    size_t end = n * (c + 1) / nc;
+    partial[c] = ReduceArraySerial<T, Op>(d + begin, end - begin);
+  }
+  T v = partial[0];
+  for (int c = 1; c < nc; ++c) {
+    v = Op::Apply(v, partial[c]);
+  }
+  return v;
+}
+
+//! Reduce a non-empty subarray of up to three dimensions.
+/*!
+  \param d The array containing the subarray.
+  \param array_size The size of the array.
+  \param offset The offset of the subarray.
+  \param size The size of the subarray.
+ */
+template <class T, class Op>
+T ReduceSubarray(int num_dims, const T *d, const IndexArray &array_size,
+                 const IndexArray &offset, const IndexArray &size) {
+  PSIndex ny = num_dims > 1 ? size[1] : 1;
+  PSIndex nz = num_dims > 2 ? size[2] : 1;
+  PSIndex num_lines = ny * nz;
+  int nc = std::min((PSIndex)GetNumReductionChunks(num_lines * size[0]),
+                    num_lines);
+  T partial[kMaxReductionThreads];
+#pragma omp parallel for schedule(static) if (nc > 1)
+  for (int c = 0; c < nc; ++c) {
+    PSIndex begin = num_lines * c / nc;
+    PSIndex end = num_lines * (c + 1) / nc;
+    T v = T();
+    for (PSIndex l = begin; l < end; ++l) {
+      PSIndex j = offset[1] + l % ny;
+      PSIndex k = offset[2] + l / ny;
+      const T *line = d + offset[0] + j * array_size[0]
+          + k * array_size[0] * (num_dims > 1 ? array_size[1] : 1);
+      T lv = ReduceArraySerial<T, Op>(line, size[0]);
+      v = (l == begin) ? lv : Op::Apply(v, lv);
+    }
+    partial[c] = v;
+  }
+  T v = partial[0];
+  for (int c = 1; c < nc; ++c) {
+    v = Op::Apply(v, partial[c]);
+  }
+  return v;
+}
+
+//! Reduce a non-empty contiguous array with operator op.
+template <class T>
+T ReduceArray(PSReduceOp op, const T *d, size_t n) {
   switch (op) {
     case PS_MAX:
-      func = MaxOp<T>();
-      break;
+      return ReduceArray<T, MaxOp<T> >(d, n);
     case PS_MIN:
-      func = MinOp<T>();
-      break;
+      return ReduceArray<T, MinOp<T> >(d, n);
     case PS_SUM:
-      func = std::plus<T>();
-      break;
+      return ReduceArray<T, SumOp<T> >(d, n);
     case PS_PROD:
-      func = std::multiplies<T>();
-      break;
+      return ReduceArray<T, ProdOp<T> >(d, n);
+    default:
+      PSAbort(1);
+  }
+  return T();
+}
+
+//! Reduce a non-empty subarray with operator op.
+template <class T>
+T ReduceSubarray(PSReduceOp op, int num_dims, const T *d,
+                 const IndexArray &array_size, const IndexArray &offset,
+                 const IndexArray &size) {
+  switch (op) {
+    case PS_MAX:
+      return ReduceSubarray<T, MaxOp<T> >(num_dims, d, array_size,
+                                          offset, size);
+    case PS_MIN:
+      return ReduceSubarray<T, MinOp<T> >(num_dims, d, array_size,
+                                          offset, size);
+    case PS_SUM:
+      return ReduceSubarray<T, SumOp<T> >(num_dims, d, array_size,
+                                          offset, size);
+    case PS_PROD:
+      return ReduceSubarray<T, ProdOp<T> >(num_dims, d, array_size,
+                                           offset, size);
     default:
       PSAbort(1);
-      break;
   }
-  return func;
+  return T();
 }
 
 template <class T>
@@ -64,7 +211,7 @@ float GetReductionDefaultValue<float>(PSReduceOp op) {
   float v;
   switch (op) {
     case PS_MAX:
-      v = FLT_MIN;
+      v = -FLT_MAX;
       break;
     case PS_MIN:
       v = FLT_MAX;
@@ -87,7 +234,7 @@ double GetReductionDefaultValue<double>(PSReduceOp op) {
   double v;
   switch (op) {
     case PS_MAX:
-      v = DBL_MIN;
+      v = -DBL_MAX;
       break;
     case PS_MIN:
       v = DBL_MAX;
@@ -9,10 +9,10 @@
 #include "runtime/runtime_common.h"
 #include "physis/physis_ref.h"
 #include "runtime/reduce.h"
+#include "runtime/host_allocator.h"
+#include "runtime/profiler.h"
 
 #include <stdarg.h>
-#include <functional>
-#include <boost/function.hpp>
 
 namespace physis {
 namespace runtime {
@@ -20,13 +20,8 @@ namespace runtime {
 template <class T>
 void PSReduceGridTemplate(void *buf, PSReduceOp op,
                           __PSGrid *g) {
-  boost::function<T (T, T)> func = GetReducer<T>(op);
-  T *d = (T *)g->p0;
-  T v = d[0];
-  for (int64_t i = 1; i < g->num_elms; ++i) {
-    v = func(v, d[i]);
-  }
-  *((T*)buf) = v;
+  performance::ProfileScope prof(performance::PROFILE_REDUCE);
+  *((T*)buf) = ReduceArray<T>(op, (T *)g->p0, g->num_elms);
   return;
 }
 }
@@ -39,7 +34,14 @@ extern "C" {
   void PSInit(int *argc, char ***argv, int grid_num_dims, ...) {
     physis::runtime::PSInitCommon(argc, argv);
   }
-  void PSFinalize() {}
+  void PSFinalize() {
+    physis::runtime::performance::Profiler &prof =
+        physis::runtime::performance::profiler;
+    if (prof.enabled()) {
+      prof.WriteTrace(0);
+      prof.PrintSummary(std::cerr);
+    }
+  }
 
   // Id is not used on shared memory 
   int __PSGridGetID(__PSGrid *g) {
@@ -58,7 +60,7 @@ extern "C" {
       g->num_elms *= dim[i];
     }
 
-    g->p0 = calloc(g->num_elms, g->elm_size);
+    g->p0 = physis::runtime::HostAlloc(g->num_elms * g->elm_size);
     if (!g->p0) {
       return INVALID_GRID;
     }
@@ -68,7 +70,7 @@ extern "C" {
     // necessary. Otherwise, both p0 and p1 can point to the same
     // address, i.e., both reads and writes go to the same buffer. 
     if (double_buffering) {
-      g->p1 = calloc(g->num_elms, g->elm_size);
+      g->p1 = physis::runtime::HostAlloc(g->num_elms * g->elm_size);
       if (!g->p1) {
         return INVALID_GRID;
       }
@@ -82,24 +84,70 @@ extern "C" {
   void PSGridFree(void *p) {
     __PSGrid *g = (__PSGrid *)p;        
     if (g->p0) {
-      free(g->p0);
+      physis::runtime::HostFree(g->p0);
     }
     if (g->p0 != g->p1 && g->p1) {
-      free(g->p1);
+      physis::runtime::HostFree(g->p1);
     }
     g->p0 = g->p1 = NULL;
   }
 
   void PSGridCopyin(void *p, const void *src_array) {
     __PSGrid *g = (__PSGrid *)p;
+    physis::runtime::performance::ProfileScope prof(
+        physis::runtime::performance::PROFILE_COPYIN,
+        g->elm_size * g->num_elms);
     memcpy(g->p0, src_array, g->elm_size * g->num_elms);
   }
 
   void PSGridCopyout(void *p, void *dst_array) {
     __PSGrid *g = (__PSGrid *)p;
+    physis::runtime::performance::ProfileScope prof(
+        physis::runtime::performance::PROFILE_COPYOUT,
+        g->elm_size * g->num_elms);
     memcpy(dst_array, g->p0, g->elm_size * g->num_elms);
   }
 
+  void PSGridLoadFile(void *p, const char *path) {
+    __PSGrid *g = (__PSGrid *)p;
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+      LOG_ERROR() << "Failed to open " << path << "\n";
+      PSAbort(1);
+    }
+    if (fread(g->p0, g->elm_size, g->num_elms, fp) !=
+        (size_t)g->num_elms) {
+      LOG_ERROR() << "Failed to read " << path << "\n";
+      PSAbort(1);
+    }
+    fclose(fp);
+  }
+
+  void PSGridSaveFile(void *p, const char *path) {
+    __PSGrid *g = (__PSGrid *)p;
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+      LOG_ERROR() << "Failed to open " << path << "\n";
+      PSAbort(1);
+    }
+    if (fwrite(g->p0, g->elm_size, g->num_elms, fp) !=
+        (size_t)g->num_elms) {
+      LOG_ERROR() << "Failed to write " << path << "\n";
+      PSAbort(1);
+    }
+    fclose(fp);
+  }
+  void PSCheckpoint() {
+    LOG_ERROR() << "Checkpointing not supported\n";
+    PSAbort(1);
+  }
+
+  void PSRestart() {
+    LOG_ERROR() << "Checkpointing not supported\n";
+    PSAbort(1);
+  }
+
+
   void __PSGridSwap(__PSGrid *g) {
     void *t = g->p1;
     g->p1 = g->p0;
@@ -0,0 +1,104 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "runtime/roofline.h"
+#include "runtime/profiler.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+using std::string;
+
+namespace physis {
+namespace runtime {
+namespace performance {
+
+Roofline roofline;
+
+// Flops and bytes of the stencil run being traced
+static double run_flops = 0.0;
+static double run_bytes = 0.0;
+
+double Roofline::GetFraction(double gflops, double gbs) const {
+  if (!IsSet()) return 0.0;
+  if (gflops == 0.0) return gbs / peak_bandwidth;
+  double intensity = gflops / gbs;
+  return gflops / std::min(peak_gflops, peak_bandwidth * intensity);
+}
+
+static double ParsePeak(const string &name, const string &value) {
+  double x = atof(value.c_str());
+  if (x <= 0.0) {
+    LOG_ERROR() << "Invalid " << name << ": " << value << "\n";
+    PSAbort(1);
+  }
+  return x;
+}
+
+void ParseRooflineOptions(int *argc, char ***argv) {
+  vector<string> opts;
+  if (ParseOption(argc, argv, "physis-peak-gflops", 1, opts)) {
+    roofline.peak_gflops = ParsePeak(opts[0], opts[1]);
+  }
+  opts.clear();
+  if (ParseOption(argc, argv, "physis-peak-bandwidth", 1, opts)) {
+    roofline.peak_bandwidth = ParsePeak(opts[0], opts[1]);
+  }
+  if (roofline.peak_gflops > 0.0 || roofline.peak_bandwidth > 0.0) {
+    if (!roofline.IsSet()) {
+      LOG_WARNING() << "Roofline requires both physis-peak-gflops and "
+                    << "physis-peak-bandwidth; ignored\n";
+    }
+    LOG_INFO() << "Roofline: " << roofline.peak_gflops << " GFLOP/s, "
+               << roofline.peak_bandwidth << " GB/s\n";
+  }
+}
+
+} // namespace performance
+} // namespace runtime
+} // namespace physis
+
+using physis::runtime::performance::run_flops;
+using physis::runtime::performance::run_bytes;
+
+extern "C" {
+  void __PSTraceStencilModel(__PSDomain *dom, int num_dims, int iter,
+                             double flops, double bytes) {
+    if (!__ps_trace && !__ps_profile) return;
+    double num_points = iter;
+    for (int i = 0; i < num_dims; ++i) {
+      num_points *= std::max(dom->local_max[i] - dom->local_min[i],
+                             (PSIndex)0);
+    }
+    if (__ps_trace) {
+      run_flops += flops * num_points;
+      run_bytes += bytes * num_points;
+    }
+    if (__ps_profile) {
+      physis::runtime::performance::profiler.AddStencilModel(
+          flops * num_points, bytes * num_points);
+    }
+  }
+
+  void __PSTraceStencilPerformance(float time) {
+    if (run_flops == 0.0 && run_bytes == 0.0) return;
+    double sec = time * 1e-3;
+    double gflops = run_flops / sec * 1e-9;
+    double gbs = run_bytes / sec * 1e-9;
+    fprintf(__ps_trace, "Physis: Stencil performance (%f GFLOP/s, %f GB/s",
+            gflops, gbs);
+    const physis::runtime::performance::Roofline &r =
+        physis::runtime::performance::roofline;
+    if (r.IsSet()) {
+      fprintf(__ps_trace, ", %.1f%% of roofline",
+              r.GetFraction(gflops, gbs) * 100.0);
+    }
+    fprintf(__ps_trace, ")\n");
+    run_flops = run_bytes = 0.0;
+  }
+}
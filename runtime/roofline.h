@@ -0,0 +1,57 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#ifndef PHYSIS_RUNTIME_ROOFLINE_H_
+#define PHYSIS_RUNTIME_ROOFLINE_H_
+
+#include "runtime/runtime_common.h"
+
+namespace physis {
+namespace runtime {
+namespace performance {
+
+//! Peak performance of the machine a process runs on.
+/*!
+  Zero if unknown.
+ */
+struct Roofline {
+  //! Peak floating-point performance in GFLOP/s
+  double peak_gflops;
+  //! Peak memory bandwidth in GB/s
+  double peak_bandwidth;
+  Roofline(): peak_gflops(0.0), peak_bandwidth(0.0) {}
+  bool IsSet() const { return peak_gflops > 0.0 && peak_bandwidth > 0.0; }
+  //! Fraction of the attainable performance.
+  /*!
+    The attainable performance is bounded by either the peak
+    performance or the bandwidth times the arithmetic
+    intensity. Stencils without floating-point operations are
+    compared with the peak bandwidth.
+
+    \param gflops Achieved GFLOP/s.
+    \param gbs Achieved GB/s.
+    \return Fraction of the roofline; zero if unknown.
+   */
+  double GetFraction(double gflops, double gbs) const;
+};
+
+extern Roofline roofline;
+
+//! Parse the roofline options.
+/*!
+  Options:
+  --physis-peak-gflops <GFLOP/s>
+  --physis-peak-bandwidth <GB/s>
+ */
+void ParseRooflineOptions(int *argc, char ***argv);
+
+} // namespace performance
+} // namespace runtime
+} // namespace physis
+
+#endif /* PHYSIS_RUNTIME_ROOFLINE_H_ */
@@ -11,6 +11,7 @@
 #include "runtime/mpi_util.h"
 #include "runtime/mpi_runtime.h"
 #include "runtime/mpi_wrapper.h"
+#include "runtime/profiler.h"
 
 namespace physis {
 namespace runtime {
@@ -78,6 +79,16 @@ void Client::Listen() {
         GridCopyout(req.opt);
         LOG_INFO() << "Client: copyout done\n";        
         break;
+      case FUNC_LOAD_FILE:
+        LOG_INFO() << "Client: load file requested\n";
+        GridLoadFile(req.opt);
+        LOG_INFO() << "Client: load file done\n";
+        break;
+      case FUNC_SAVE_FILE:
+        LOG_INFO() << "Client: save file requested\n";
+        GridSaveFile(req.opt);
+        LOG_INFO() << "Client: save file done\n";
+        break;
       case FUNC_GET:
         LOG_INFO() << "Client: get requested\n";
         GridGet(req.opt);
@@ -100,6 +111,16 @@ void Client::Listen() {
         GridReduce(req.opt);
         LOG_DEBUG() << "Client: grid reduce done\n";
         break;
+      case FUNC_CHECKPOINT:
+        LOG_INFO() << "Client: checkpoint requested\n";
+        Checkpoint();
+        LOG_INFO() << "Client: checkpoint done\n";
+        break;
+      case FUNC_RESTART:
+        LOG_INFO() << "Client: restart requested\n";
+        Restart();
+        LOG_INFO() << "Client: restart done\n";
+        break;
       case FUNC_INVALID:
         LOG_INFO() << "Client: invaid request\n";
         PSAbort(1);
@@ -126,15 +147,43 @@ void Master::NotifyCall(enum RT_FUNC_KIND fkind, int opt) {
   MPI_Bcast(&r, sizeof(Request), MPI_BYTE, 0, comm_);
 }
 
+// Writes the profile of each process and prints the totals reduced
+// across all processes at the root.
+static void FinalizeProfile(int rank, MPI_Comm comm) {
+  performance::Profiler &prof = performance::profiler;
+  if (!prof.enabled()) return;
+  prof.WriteTrace(rank);
+  std::vector<double> totals;
+  prof.GetTotals(totals);
+  int n = totals.size();
+  std::vector<double> min(n), max(n), avg(n);
+  CHECK_MPI(MPI_Reduce(&totals[0], &min[0], n, MPI_DOUBLE, MPI_MIN,
+                       0, comm));
+  CHECK_MPI(MPI_Reduce(&totals[0], &max[0], n, MPI_DOUBLE, MPI_MAX,
+                       0, comm));
+  CHECK_MPI(MPI_Reduce(&totals[0], &avg[0], n, MPI_DOUBLE, MPI_SUM,
+                       0, comm));
+  if (rank != 0) return;
+  int num_procs;
+  CHECK_MPI(MPI_Comm_size(comm, &num_procs));
+  for (int i = 0; i < n; ++i) avg[i] /= num_procs;
+  prof.PrintStencils(std::cerr);
+  performance::Profiler::PrintTotals(std::cerr, num_procs, min, avg, max);
+}
+
 // Finalize
 void Master::Finalize() {
   LOG_DEBUG() << "[" << pinfo_.rank() << "] Finalize\n";
   NotifyCall(FUNC_FINALIZE);
+  gs_->WaitCheckpoint();
+  FinalizeProfile(pinfo_.rank(), comm_);
   MPI_Finalize();
 }
 
 void Client::Finalize() {
   LOG_DEBUG() << "[" << pinfo_.rank() << "] Finalize\n";
+  gs_->WaitCheckpoint();
+  FinalizeProfile(pinfo_.rank(), comm_);
   MPI_Finalize();
   exit(0);
 }
@@ -192,117 +241,80 @@ void Client::GridDelete(int id) {
   return;
 }
 
-void Master::GridCopyinLocal(GridMPI *g, const void *buf) {
-  size_t s = g->local_size().accumulate(g->num_dims()) *
-             g->elm_size();
-  PSAssert(g->buffer()->GetLinearSize() == s);
-  CopyoutSubgrid(g->elm_size(), g->num_dims(), buf,
-                 g->size(), g->buffer()->Get(),
-                 g->local_offset(), g->local_size());
-}
-
 // Copyin
 void Master::GridCopyin(GridMPI *g, const void *buf) {
   LOG_DEBUG() << "[" << pinfo_.rank() << "] Copyin\n";
-
-
-  // copyin to own buffer
-  GridCopyinLocal(g, buf);
-
-  // Copyin to remote subgrids
-  NotifyCall(FUNC_COPYIN, g->id());  
-  BufferHost sbuf(g->num_dims(), g->elm_size());
-  for (int i = 1; i < gs_->num_procs(); ++i) {
-    IndexArray subgrid_size, subgrid_offset;
-    PS_MPI_Recv(&subgrid_offset, sizeof(IndexArray), MPI_BYTE, i,
-                0, comm_, MPI_STATUS_IGNORE);
-    LOG_VERBOSE_MPI() << "sg offset: " << subgrid_offset << "\n";    
-    PS_MPI_Recv(&subgrid_size, sizeof(IndexArray), MPI_BYTE, i,
-                0, comm_, MPI_STATUS_IGNORE);
-    LOG_VERBOSE_MPI() << "sg size: " << subgrid_size << "\n";        
-    size_t gsize = sbuf.GetLinearSize(subgrid_size);
-    if (gsize == 0) continue;
-    sbuf.EnsureCapacity(subgrid_size);
-    CopyoutSubgrid(g->elm_size(), g->num_dims(), buf,
-                   g->size(), sbuf.Get(),
-                   subgrid_offset, subgrid_size);
-    PS_MPI_Send(sbuf.Get(), gsize, MPI_BYTE, i, 0, comm_);
-  }
+  NotifyCall(FUNC_COPYIN, g->id());
+  gs_->ScatterGrid(g, buf, pinfo_.rank());
   return;
 }
 
 void Client::GridCopyin(int id) {
   LOG_DEBUG() << "Copyin\n";
-
   GridMPI *g = static_cast<GridMPI*>(gs_->FindGrid(id));
-  // notify the local offset
-  IndexArray ia = g->local_offset();
-  PS_MPI_Send(&ia, sizeof(IndexArray), MPI_BYTE, 0, 0, comm_);
-  // notify the local size
-  ia = g->local_size();
-  PS_MPI_Send(&ia, sizeof(IndexArray), MPI_BYTE, 0, 0, comm_);
-  if (g->empty()) {
-    LOG_DEBUG() << "No copy needed because this grid is empty.\n";
-    return;
-  }
-  // receive the subregion for this process
-  void *cur_buf_ptr = g->buffer()->Get();
-  g->buffer()->MPIRecv(0, comm_, IndexArray(), g->local_size());
-  PSAssert(g->buffer()->Get() == cur_buf_ptr);
-  //print_grid<float>(g, gs_->my_rank(), std::cerr);
-  return;
-}
-
-void Master::GridCopyoutLocal(GridMPI *g, void *buf) {
-  if (g->empty()) return;
-  
-  CopyinSubgrid(g->elm_size(), g->num_dims(), buf,
-                g->size(), g->buffer()->Get(), g->local_offset(),
-                g->local_size());
+  gs_->ScatterGrid(g, NULL, 0);
   return;
 }
 
 // Copyout
 void Master::GridCopyout(GridMPI *g, void *buf) {
   LOG_DEBUG() << "Copyout\n";
-
-  // Copyout self
-  GridCopyoutLocal(g, buf);
-  
-  // Copyout from remote grids
   NotifyCall(FUNC_COPYOUT, g->id());
-  BufferHost sbuf(g->num_dims(), g->elm_size());
-  for (int i = 1; i < gs_->num_procs(); ++i) {
-    IndexArray subgrid_size, subgrid_offset;
-    PS_MPI_Recv(&subgrid_offset, sizeof(IndexArray), MPI_BYTE, i,
-                0, comm_, MPI_STATUS_IGNORE);
-    LOG_VERBOSE() << "sg offset: " << subgrid_offset << "\n";
-    PS_MPI_Recv(&subgrid_size, sizeof(IndexArray), MPI_BYTE, i,
-                0, comm_, MPI_STATUS_IGNORE);
-    LOG_VERBOSE() << "sg size: " << subgrid_size << "\n";
-    size_t gsize = sbuf.GetLinearSize(subgrid_size);
-    if (gsize == 0) continue;
-    sbuf.MPIRecv(i, comm_, IndexArray(), subgrid_size);
-    CopyinSubgrid(g->elm_size(), g->num_dims(), buf,
-                  g->size(), sbuf.Get(), subgrid_offset,
-                  subgrid_size);
-  }
+  gs_->GatherGrid(g, buf, pinfo_.rank());
+  return;
 }
 
 void Client::GridCopyout(int id) {
   LOG_DEBUG() << "Copyout\n";
   GridMPI *g = static_cast<GridMPI*>(gs_->FindGrid(id));
-  // notify the local offset
-  IndexArray ia = g->local_offset();
-  PS_MPI_Send(&ia, sizeof(IndexArray), MPI_BYTE, 0, 0, comm_);
-  // notify the local size
-  ia = g->local_size();
-  PS_MPI_Send(&ia, sizeof(IndexArray), MPI_BYTE, 0, 0, comm_);
-  if (g->empty()) {
-    LOG_DEBUG() << "No copy needed because this grid is empty.\n";
-    return;
-  }
-  g->buffer()->MPISend(0, comm_, IndexArray(), g->local_size());
+  gs_->GatherGrid(g, NULL, 0);
+  return;
+}
+
+// File I/O
+void Master::BroadcastPath(const char *path) {
+  int len = strlen(path) + 1;
+  PS_MPI_Bcast(&len, 1, MPI_INT, 0, comm_);
+  PS_MPI_Bcast(const_cast<char*>(path), len, MPI_CHAR, 0, comm_);
+}
+
+static std::string ReceivePath(MPI_Comm comm) {
+  int len;
+  PS_MPI_Bcast(&len, 1, MPI_INT, 0, comm);
+  std::vector<char> path(len);
+  PS_MPI_Bcast(&path[0], len, MPI_CHAR, 0, comm);
+  return std::string(&path[0]);
+}
+
+void Master::GridLoadFile(GridMPI *g, const char *path) {
+  LOG_DEBUG() << "LoadFile: " << path << "\n";
+  NotifyCall(FUNC_LOAD_FILE, g->id());
+  BroadcastPath(path);
+  gs_->LoadFile(g, path);
+  return;
+}
+
+void Client::GridLoadFile(int id) {
+  GridMPI *g = static_cast<GridMPI*>(gs_->FindGrid(id));
+  std::string path = ReceivePath(comm_);
+  LOG_DEBUG() << "LoadFile: " << path << "\n";
+  gs_->LoadFile(g, path);
+  return;
+}
+
+void Master::GridSaveFile(GridMPI *g, const char *path) {
+  LOG_DEBUG() << "SaveFile: " << path << "\n";
+  NotifyCall(FUNC_SAVE_FILE, g->id());
+  BroadcastPath(path);
+  gs_->SaveFile(g, path);
+  return;
+}
+
+void Client::GridSaveFile(int id) {
+  GridMPI *g = static_cast<GridMPI*>(gs_->FindGrid(id));
+  std::string path = ReceivePath(comm_);
+  LOG_DEBUG() << "SaveFile: " << path << "\n";
+  gs_->SaveFile(g, path);
   return;
 }
 
@@ -439,5 +451,126 @@ void Master::GridReduce(void *buf, PSReduceOp op, GridMPI *g) {
   LOG_DEBUG() << "Master GridReduce done\n";  
 }
 
+// Checkpoint
+void Master::Checkpoint() {
+  LOG_DEBUG() << "Master Checkpoint\n";
+  NotifyCall(FUNC_CHECKPOINT);
+  gs_->Save();
+}
+
+void Client::Checkpoint() {
+  LOG_DEBUG() << "Client Checkpoint\n";
+  gs_->Save();
+}
+
+// Restart
+void Master::Restart() {
+  LOG_DEBUG() << "Master Restart\n";
+  NotifyCall(FUNC_RESTART);
+  gs_->Restore();
+}
+
+void Client::Restart() {
+  LOG_DEBUG() << "Client Restart\n";
+  gs_->Restore();
+}
+
+//
+// SPMD execution
+//
+
+SPMDMaster::SPMDMaster(const ProcInfo &pinfo, GridSpaceMPI *gs,
+                       MPI_Comm comm): Master(pinfo, gs, comm) {
+}
+
+void SPMDMaster::Finalize() {
+  LOG_DEBUG() << "[" << pinfo_.rank() << "] Finalize\n";
+  gs_->WaitCheckpoint();
+  FinalizeProfile(pinfo_.rank(), comm_);
+  MPI_Finalize();
+}
+
+void SPMDMaster::Barrier() {
+  LOG_DEBUG() << "[" << pinfo_.rank() << "] Barrier\n";
+  MPI_Barrier(comm_);
+}
+
+// Grid IDs match across processes as grids are created in the same
+// order
+GridMPI *SPMDMaster::GridNew(PSType type, int elm_size,
+                             int num_dims, const IndexArray &size,
+                             bool double_buffering,
+                             const IndexArray &global_offset,
+                             int attr) {
+  LOG_DEBUG() << "[" << pinfo_.rank() << "] New\n";
+  return gs_->CreateGrid(type, elm_size, num_dims, size,
+                         double_buffering, global_offset, attr);
+}
+
+void SPMDMaster::GridDelete(GridMPI *g) {
+  LOG_DEBUG() << "[" << pinfo_.rank() << "] Delete\n";
+  gs_->DeleteGrid(g);
+}
+
+void SPMDMaster::GridCopyin(GridMPI *g, const void *buf) {
+  LOG_DEBUG() << "[" << pinfo_.rank() << "] Copyin\n";
+  gs_->ScatterGrid(g, buf, -1);
+}
+
+void SPMDMaster::GridCopyout(GridMPI *g, void *buf) {
+  LOG_DEBUG() << "[" << pinfo_.rank() << "] Copyout\n";
+  gs_->GatherGrid(g, buf, -1);
+}
+
+void SPMDMaster::GridLoadFile(GridMPI *g, const char *path) {
+  LOG_DEBUG() << "LoadFile: " << path << "\n";
+  gs_->LoadFile(g, path);
+}
+
+void SPMDMaster::GridSaveFile(GridMPI *g, const char *path) {
+  LOG_DEBUG() << "SaveFile: " << path << "\n";
+  gs_->SaveFile(g, path);
+}
+
+void SPMDMaster::StencilRun(int id, int iter, int num_stencils,
+                            void **stencils, unsigned *stencil_sizes) {
+  LOG_DEBUG() << "SPMD StencilRun(" << id << ")\n";
+  __PS_stencils[id](iter, stencils);
+}
+
+void SPMDMaster::GridSet(GridMPI *g, const void *buf,
+                         const IndexArray &index) {
+  LOG_DEBUG() << "SPMD GridSet\n";
+  // All processes set the same value; only the owner keeps it
+  if (gs_->FindOwnerProcess(g, index) == pinfo_.rank()) {
+    g->Set(index, buf);
+  }
+}
+
+void SPMDMaster::GridGet(GridMPI *g, void *buf, const IndexArray &index) {
+  LOG_DEBUG() << "SPMD GridGet\n";
+  int owner = gs_->FindOwnerProcess(g, index);
+  if (owner == pinfo_.rank()) {
+    g->Get(index, buf);
+  }
+  PS_MPI_Bcast(buf, g->elm_size(), MPI_BYTE, owner, comm_);
+}
+
+void SPMDMaster::GridReduce(void *buf, PSReduceOp op, GridMPI *g) {
+  LOG_DEBUG() << "SPMD GridReduce\n";
+  gs_->ReduceGrid(buf, op, g);
+  PS_MPI_Bcast(buf, g->elm_size(), MPI_BYTE, 0, comm_);
+}
+
+void SPMDMaster::Checkpoint() {
+  LOG_DEBUG() << "SPMD Checkpoint\n";
+  gs_->Save();
+}
+
+void SPMDMaster::Restart() {
+  LOG_DEBUG() << "SPMD Restart\n";
+  gs_->Restore();
+}
+
 } // namespace runtime
 } // namespace physis
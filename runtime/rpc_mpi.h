@@ -22,7 +22,8 @@ enum RT_FUNC_KIND {
   FUNC_COPYIN, FUNC_COPYOUT,
   FUNC_GET, FUNC_SET,
   FUNC_RUN, FUNC_FINALIZE, FUNC_BARRIER,
-  FUNC_GRID_REDUCE
+  FUNC_GRID_REDUCE, FUNC_LOAD_FILE, FUNC_SAVE_FILE,
+  FUNC_CHECKPOINT, FUNC_RESTART
 };
 
 class ProcInfo {
@@ -51,10 +52,14 @@ class Client {
   virtual void GridDelete(int id);
   virtual void GridCopyin(int id);
   virtual void GridCopyout(int id);
+  virtual void GridLoadFile(int id);
+  virtual void GridSaveFile(int id);
   virtual void GridSet(int id);
   virtual void GridGet(int id);  
   virtual void StencilRun(int id);
   virtual void GridReduce(int id);
+  virtual void Checkpoint();
+  virtual void Restart();
 };
 
 class Master {
@@ -64,6 +69,7 @@ class Master {
   GridSpaceMPI *gs_;  
   MPI_Comm comm_;
   void NotifyCall(enum RT_FUNC_KIND fkind, int opt=0);
+  void BroadcastPath(const char *path);
  public:
   Master(const ProcInfo &pinfo, GridSpaceMPI *gs, MPI_Comm comm);
   virtual ~Master() {}
@@ -77,14 +83,51 @@ class Master {
                            int attr);
   virtual void GridDelete(GridMPI *g);
   virtual void GridCopyin(GridMPI *g, const void *buf);
-  virtual void GridCopyinLocal(GridMPI *g, const void *buf);  
   virtual void GridCopyout(GridMPI *g, void *buf);
-  virtual void GridCopyoutLocal(GridMPI *g, void *buf);  
+  virtual void GridLoadFile(GridMPI *g, const char *path);
+  virtual void GridSaveFile(GridMPI *g, const char *path);
   virtual void GridSet(GridMPI *g, const void *buf, const IndexArray &index);
   virtual void GridGet(GridMPI *g, void *buf, const IndexArray &index);  
   virtual void StencilRun(int id, int iter, int num_stencils,
                           void **stencils, unsigned *stencil_sizes);
   virtual void GridReduce(void *buf, PSReduceOp op, GridMPI *g);
+  virtual void Checkpoint();
+  virtual void Restart();
+};
+
+//! Runtime calls of the SPMD execution mode.
+/*!
+  All processes execute the program, so each call is executed
+  locally or as a collective operation by all processes without
+  being broadcast from the root. Arguments given by the program,
+  e.g., the buffers of copyin, are assumed to be the same at all
+  processes, and results, e.g., of copyout, are returned to all
+  processes.
+ */
+class SPMDMaster: public Master {
+ public:
+  SPMDMaster(const ProcInfo &pinfo, GridSpaceMPI *gs, MPI_Comm comm);
+  virtual ~SPMDMaster() {}
+  virtual void Finalize();
+  virtual void Barrier();
+  virtual GridMPI *GridNew(PSType type, int elm_size,
+                           int num_dims,
+                           const IndexArray &size,
+                           bool double_buffering,
+                           const IndexArray &global_offset,
+                           int attr);
+  virtual void GridDelete(GridMPI *g);
+  virtual void GridCopyin(GridMPI *g, const void *buf);
+  virtual void GridCopyout(GridMPI *g, void *buf);
+  virtual void GridLoadFile(GridMPI *g, const char *path);
+  virtual void GridSaveFile(GridMPI *g, const char *path);
+  virtual void GridSet(GridMPI *g, const void *buf, const IndexArray &index);
+  virtual void GridGet(GridMPI *g, void *buf, const IndexArray &index);
+  virtual void StencilRun(int id, int iter, int num_stencils,
+                          void **stencils, unsigned *stencil_sizes);
+  virtual void GridReduce(void *buf, PSReduceOp op, GridMPI *g);
+  virtual void Checkpoint();
+  virtual void Restart();
 };
 
 } // namespace runtime
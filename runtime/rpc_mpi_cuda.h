@@ -23,10 +23,6 @@ class MasterMPICUDA: public Master {
                 MPI_Comm comm);
   virtual ~MasterMPICUDA();
   virtual void Finalize();
-  virtual void GridCopyinLocal(GridMPI *g, const void *buf);
-  virtual void GridCopyoutLocal(GridMPI *g, void *buf);  
- protected:
-  BufferCUDAHost *pinned_buf_;
 };
 
 class ClientMPICUDA: public Client {
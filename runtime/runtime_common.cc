@@ -7,6 +7,10 @@
 // Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
 
 #include "runtime/runtime_common.h"
+#include "runtime/host_allocator.h"
+#include "runtime/profiler.h"
+#include "runtime/roofline.h"
+#include "runtime/threading.h"
 
 #include <string>
 
@@ -49,6 +53,15 @@ void PSInitCommon(int *argc, char ***argv) {
       __ps_trace = stderr;
       LOG_INFO() << "Tracing enabled\n";
   }
+  ParseThreadOptions(argc, argv);
+  ParseHostAllocOptions(argc, argv);
+  // Enable the profiler if physis-profile option is given
+  opts.clear();
+  if (ParseOption(argc, argv, "physis-profile", 1, opts)) {
+    performance::profiler.Enable(opts[1]);
+    LOG_INFO() << "Profiling enabled\n";
+  }
+  performance::ParseRooflineOptions(argc, argv);
 }
 
 static int ParseProcDim(const string &s, IntArray &psize) {
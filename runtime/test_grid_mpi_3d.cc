@@ -4,6 +4,15 @@
 #include "runtime/mpi_runtime.h"
 #include "runtime/grid_mpi_debug_util.h"
 #include "runtime/mpi_util.h"
+#include "runtime/host_allocator.h"
+#include "runtime/profiler.h"
+#include "runtime/roofline.h"
+#include "runtime/threading.h"
+
+#include <fstream>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 #define N (4)
 #define NDIM (3)
@@ -48,6 +57,44 @@ static void init_grid(GridMPI *g) {
 }  
 
 
+// Sets each point to its global linear index plus base
+static void init_grid_index(GridMPI *g, float base=0) {
+  const IndexArray &lo = g->local_offset();
+  const IndexArray &ls = g->local_size();
+  for (PSIndex k = lo[2]; k < lo[2] + ls[2]; ++k) {
+    for (PSIndex j = lo[1]; j < lo[1] + ls[1]; ++j) {
+      for (PSIndex i = lo[0]; i < lo[0] + ls[0]; ++i) {
+        *(float*)g->GetAddress(IndexArray(i, j, k)) =
+            base + i + j * N + k * N * N;
+      }
+    }
+  }
+}
+
+// Checks the subgrid and its halo of width one including diagonal
+// points
+static void check_grid_index(GridMPI *g, float base=0) {
+  const IndexArray &lo = g->local_offset();
+  const IndexArray &ls = g->local_size();
+  for (PSIndex k = lo[2] - 1; k < lo[2] + ls[2] + 1; ++k) {
+    for (PSIndex j = lo[1] - 1; j < lo[1] + ls[1] + 1; ++j) {
+      for (PSIndex i = lo[0] - 1; i < lo[0] + ls[0] + 1; ++i) {
+        IndexArray idx(i, j, k);
+        bool in_grid = true;
+        for (int l = 0; l < NDIM; ++l) {
+          if (idx[l] < 0 || idx[l] >= N) in_grid = false;
+        }
+        if (!in_grid) continue;
+        float v = *(float*)g->GetAddress(idx);
+        if (v != base + i + j * N + k * N * N) {
+          LOG_ERROR_MPI() << "Wrong halo value at " << idx << ": " << v << "\n";
+          PSAbort(1);
+        }
+      }
+    }
+  }
+}
+
 void test1() {
   LOG_DEBUG_MPI() << "Test 1: Grid space creation and deletion\n";
   IndexArray global_size(N, N, N);
@@ -201,8 +248,600 @@ void test8() {
   LOG_DEBUG_MPI() << "Finished\n";
 }
 
+void test9() {
+  LOG_DEBUG_MPI() << "Split-phase exchange with diagonal points\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              false, global_offset, 0);
+  init_grid_index(g);
+  UnsignedArray halo(1, 1, 1);
+  gs->ExchangeBoundariesBegin(g, halo, halo, true, false);
+  gs->ExchangeBoundariesEnd();
+  check_grid_index(g);
+  delete g;
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test10() {
+  LOG_DEBUG_MPI() << "Simultaneous exchange with diagonal points\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  gs->set_simultaneous_exchange(true);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              false, global_offset, 0);
+  init_grid_index(g);
+  UnsignedArray halo(1, 1, 1);
+  gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+  check_grid_index(g);
+  delete g;
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test11() {
+  LOG_DEBUG_MPI() << "Simultaneous exchange with padded halos\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  gs->set_simultaneous_exchange(true);
+  gs->set_halo_padding(1);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              false, global_offset, 0);
+  init_grid_index(g);
+  UnsignedArray halo(1, 1, 1);
+  gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+  check_grid_index(g);
+  delete g;
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test12() {
+  LOG_DEBUG_MPI() << "Repeated exchanges of a double-buffered grid\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              true, global_offset, 0);
+  UnsignedArray halo(1, 1, 1);
+  for (int i = 0; i < 6; ++i) {
+    // Alternate the exchange modes as well as the buffers
+    gs->set_simultaneous_exchange(i / 2 % 2);
+    init_grid_index(g, i * N * N * N);
+    gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+    check_grid_index(g, i * N * N * N);
+    g->Swap();
+  }
+  gs->DeleteGrid(g);
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test13() {
+  LOG_DEBUG_MPI() << "Save and load a grid file\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  gs->set_halo_padding(1);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              false, global_offset, 0);
+  init_grid_index(g);
+  const char *path = "test_grid_mpi_3d_test13.dat";
+  gs->SaveFile(g, path);
+  if (my_rank == 0) {
+    // The file must be a raw global array
+    float buf[N*N*N];
+    FILE *fp = fopen(path, "rb");
+    assert(fp);
+    assert(fread(buf, sizeof(float), N*N*N, fp) == N*N*N);
+    fclose(fp);
+    for (int i = 0; i < N*N*N; ++i) {
+      if (buf[i] != i) {
+        LOG_ERROR_MPI() << "Mismatch at " << i << ": " << buf[i] << "\n";
+        PSAbort(1);
+      }
+    }
+  }
+  gs->set_halo_padding(0);
+  GridMPI *g2 = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                               false, global_offset, 0);
+  gs->LoadFile(g2, path);
+  UnsignedArray halo(1, 1, 1);
+  gs->ExchangeBoundaries(g2->id(), halo, halo, true, false);
+  check_grid_index(g2);
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (my_rank == 0) remove(path);
+  gs->DeleteGrid(g);
+  gs->DeleteGrid(g2);
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+// Saves a grid and restores it with a different decomposition
+static void test_checkpoint(bool async) {
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  gs->set_async_checkpoint(async);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              false, global_offset, 0);
+  init_grid_index(g);
+  gs->Save();
+  // The checkpoint must not be affected by updates after Save
+  init_grid_index(g, 1);
+  gs->WaitCheckpoint();
+  gs->DeleteGrid(g);
+  delete gs;
+
+  proc_size = IntArray(1, 2, 4);
+  gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  gs->set_halo_padding(1);
+  g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                     false, global_offset, 0);
+  gs->Restore();
+  UnsignedArray halo(1, 1, 1);
+  gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+  check_grid_index(g);
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (my_rank == 0) remove(("./physis_ckpt_" + toString(g->id())).c_str());
+  gs->DeleteGrid(g);
+  delete gs;
+}
+
+void test14() {
+  LOG_DEBUG_MPI() << "Checkpoint and restart\n";
+  test_checkpoint(false);
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test15() {
+  LOG_DEBUG_MPI() << "Asynchronous checkpoint and restart\n";
+  test_checkpoint(true);
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+template <class T>
+static T reduce_serial(PSReduceOp op, const T *d, size_t n) {
+  T v = d[0];
+  for (size_t i = 1; i < n; ++i) {
+    switch (op) {
+      case PS_MAX: v = std::max(v, d[i]); break;
+      case PS_MIN: v = std::min(v, d[i]); break;
+      case PS_SUM: v += d[i]; break;
+      case PS_PROD: v *= d[i]; break;
+    }
+  }
+  return v;
+}
+
+void test16() {
+  LOG_DEBUG_MPI() << "Reduction\n";
+  PSReduceOp ops[] = {PS_MAX, PS_MIN, PS_SUM, PS_PROD};
+  // Large enough to be reduced by multiple threads
+  size_t n = kParallelReductionMinSize * 3 + 7;
+  double *d = new double[n];
+  for (size_t i = 0; i < n; ++i) {
+    d[i] = (i % 3 == 0) ? 1.0 : ((i % 3 == 1) ? -0.5 : 2.0);
+  }
+  for (int i = 0; i < 4; ++i) {
+    double v = ReduceArray<double>(ops[i], d, n);
+    if (v != reduce_serial<double>(ops[i], d, n)) {
+      LOG_ERROR_MPI() << "Wrong array reduction: " << v << "\n";
+      PSAbort(1);
+    }
+  }
+  delete[] d;
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  for (unsigned padding = 0; padding < 2; ++padding) {
+    GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+    gs->set_halo_padding(padding);
+    IndexArray global_offset;
+    GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                                false, global_offset, 0);
+    init_grid_index(g, -N * N * N / 2);
+    float v[N*N*N];
+    for (int i = 0; i < N*N*N; ++i) v[i] = i - N * N * N / 2;
+    for (int i = 0; i < 3; ++i) {
+      float r;
+      gs->ReduceGrid(&r, ops[i], g);
+      if (my_rank == 0 && r != reduce_serial<float>(ops[i], v, N*N*N)) {
+        LOG_ERROR_MPI() << "Wrong grid reduction: " << r << "\n";
+        PSAbort(1);
+      }
+    }
+    // Products of powers of two stay exact in any order
+    const IndexArray &lo = g->local_offset();
+    const IndexArray &ls = g->local_size();
+    for (PSIndex k = lo[2]; k < lo[2] + ls[2]; ++k) {
+      for (PSIndex j = lo[1]; j < lo[1] + ls[1]; ++j) {
+        for (PSIndex i = lo[0]; i < lo[0] + ls[0]; ++i) {
+          int idx = i + j * N + k * N * N;
+          *(float*)g->GetAddress(IndexArray(i, j, k)) =
+              (idx % 3 == 0) ? -1.0f : ((idx % 3 == 1) ? 0.5f : 4.0f);
+        }
+      }
+    }
+    for (int i = 0; i < N*N*N; ++i) {
+      v[i] = (i % 3 == 0) ? -1.0f : ((i % 3 == 1) ? 0.5f : 4.0f);
+    }
+    float r;
+    gs->ReduceGrid(&r, PS_PROD, g);
+    if (my_rank == 0 && r != reduce_serial<float>(PS_PROD, v, N*N*N)) {
+      LOG_ERROR_MPI() << "Wrong grid reduction: " << r << "\n";
+      PSAbort(1);
+    }
+    gs->DeleteGrid(g);
+    delete gs;
+  }
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test17() {
+  LOG_DEBUG_MPI() << "Aligned grid allocation\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  HostAllocPolicy default_policy = host_alloc_policy;
+  host_alloc_policy.alignment = 4096;
+  host_alloc_policy.huge_page = HUGE_PAGE_TRANSPARENT;
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              true, global_offset, 0);
+  for (int i = 0; i < 2; ++i) {
+    float *p = (float*)(i == 0 ? g->_data() : g->_data_emit());
+    if ((intptr_t)p % 4096) {
+      LOG_ERROR_MPI() << "Grid buffer not aligned: " << p << "\n";
+      PSAbort(1);
+    }
+    for (PSIndex j = 0; j < g->local_size().accumulate(NDIM); ++j) {
+      if (p[j] != 0.0f) {
+        LOG_ERROR_MPI() << "Grid buffer not zero-filled\n";
+        PSAbort(1);
+      }
+    }
+  }
+  gs->DeleteGrid(g);
+  delete gs;
+  host_alloc_policy = default_policy;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test18() {
+  LOG_DEBUG_MPI() << "Profiling halo exchanges\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  performance::Profiler &prof = performance::profiler;
+  prof.Enable("test18_profile");
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              true, global_offset, 0);
+  UnsignedArray halo(1, 1, 1);
+  init_grid_index(g, 0);
+  __PSTraceStencilPre("test18_kernel");
+  gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+  __PSTraceStencilPost(0.0f);
+  check_grid_index(g, 0);
+  std::vector<double> totals;
+  std::vector<string> names;
+  prof.GetTotals(totals);
+  performance::Profiler::GetTotalNames(names);
+  PSAssert(totals.size() == names.size());
+  std::map<string, double> t;
+  ENUMERATE (i, it, names.begin(), names.end()) t[*it] = totals[i];
+  // Each process has a neighbor in each dimension
+  if (t["stencil runs"] != 1 || t["messages sent"] < NDIM ||
+      t["bytes sent"] <= 0 || t["halo_pack (bytes)"] <= 0) {
+    LOG_ERROR_MPI() << "Unexpected profile\n";
+    performance::Profiler::PrintTotals(std::cerr, 1, totals, totals,
+                                       totals);
+    PSAbort(1);
+  }
+  prof.WriteTrace(my_rank);
+  string path = "test18_profile." + toString(my_rank) + ".json";
+  std::ifstream is(path.c_str());
+  string trace((std::istreambuf_iterator<char>(is)),
+               std::istreambuf_iterator<char>());
+  if (trace.find("\"traceEvents\"") == string::npos ||
+      trace.find("\"name\":\"mpi_wait\"") == string::npos ||
+      trace.find("\"stencil\":\"test18_kernel\"") == string::npos) {
+    LOG_ERROR_MPI() << "Unexpected trace: " << trace << "\n";
+    PSAbort(1);
+  }
+  remove(path.c_str());
+  gs->DeleteGrid(g);
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test19() {
+  LOG_DEBUG_MPI() << "Stencil performance model\n";
+  performance::Roofline &r = performance::roofline;
+  r.peak_gflops = 100.0;
+  r.peak_bandwidth = 10.0;
+  // Bandwidth bound, compute bound, and no flops
+  PSAssert(fabs(r.GetFraction(2.5, 5.0) - 0.5) < 1e-9);
+  PSAssert(fabs(r.GetFraction(50.0, 2.0) - 0.5) < 1e-9);
+  PSAssert(fabs(r.GetFraction(0.0, 5.0) - 0.5) < 1e-9);
+  FILE *trace = __ps_trace;
+  __ps_trace = tmpfile();
+  __PSDomain dom;
+  for (int i = 0; i < NDIM; ++i) {
+    dom.min[i] = dom.local_min[i] = 0;
+    dom.max[i] = dom.local_max[i] = N;
+  }
+  r.peak_gflops = 0.01;
+  r.peak_bandwidth = 0.002;
+  __PSTraceStencilPre("test19_kernel");
+  // 2 iterations of N^3 points with 10 flops and 8 bytes per point
+  __PSTraceStencilModel(&dom, NDIM, 2, 10.0, 8.0);
+  __PSTraceStencilPost(1.0f);
+  rewind(__ps_trace);
+  char line[256];
+  string out;
+  while (fgets(line, sizeof(line), __ps_trace)) out += line;
+  fclose(__ps_trace);
+  __ps_trace = trace;
+  r = performance::Roofline();
+  if (out.find("(0.001280 GFLOP/s, 0.001024 GB/s, 51.2% of roofline)")
+      == string::npos) {
+    LOG_ERROR_MPI() << "Unexpected trace: " << out << "\n";
+    PSAbort(1);
+  }
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test20() {
+  LOG_DEBUG_MPI() << "Thread binding\n";
+  PSAssert(GetNumThreads() >= 1);
+#if defined(__linux__) && defined(_OPENMP)
+  cpu_set_t allowed;
+  PSAssert(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+  if (!BindThreads(THREAD_AFFINITY_SCATTER)) {
+    LOG_ERROR_MPI() << "Failed to bind threads\n";
+    PSAbort(1);
+  }
+  int num_failures = 0;
+#pragma omp parallel reduction(+:num_failures)
+  {
+    cpu_set_t set;
+    // Each thread runs on a single CPU the process was allowed to use
+    if (sched_getaffinity(0, sizeof(set), &set) || CPU_COUNT(&set) != 1) {
+      ++num_failures;
+    } else {
+      for (int i = 0; i < CPU_SETSIZE; ++i) {
+        if (CPU_ISSET(i, &set) && !CPU_ISSET(i, &allowed)) ++num_failures;
+      }
+    }
+  }
+  if (num_failures) {
+    LOG_ERROR_MPI() << "Threads not bound as expected\n";
+    PSAbort(1);
+  }
+  // Halos are exchanged correctly by bound threads
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              true, global_offset, 0);
+  UnsignedArray halo(1, 1, 1);
+  init_grid_index(g, 0);
+  gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+  check_grid_index(g, 0);
+  gs->DeleteGrid(g);
+  delete gs;
+  // Restores the affinity of the threads
+#pragma omp parallel
+  sched_setaffinity(0, sizeof(allowed), &allowed);
+#endif
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test21() {
+  LOG_DEBUG_MPI() << "Load subgrids of double-buffered grids\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  for (unsigned padding = 0; padding < 2; ++padding) {
+    GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+    gs->set_halo_padding(padding);
+    IndexArray global_offset;
+    GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                                true, global_offset, 0);
+    IndexArray goffset = g->local_offset() - 1;
+    goffset.SetNoLessThan(0L);
+    IndexArray gy = g->local_offset() + g->local_size() + 1;
+    gy.SetNoMoreThan(g->size());
+    // Each buffer is loaded twice to reuse the windows and plans
+    for (int i = 0; i < 4; ++i) {
+      init_grid_index(g, i);
+      GridMPI *g2 = gs->LoadSubgrid(g, goffset, gy - goffset);
+      PSAssert(g2);
+      for (PSIndex z = goffset[2]; z < gy[2]; ++z) {
+        for (PSIndex y = goffset[1]; y < gy[1]; ++y) {
+          for (PSIndex x = goffset[0]; x < gy[0]; ++x) {
+            IndexArray idx(x, y, z);
+            float v = *(float*)g->GetAddress(idx);
+            if (v != i + x + y * N + z * N * N) {
+              LOG_ERROR_MPI() << "Wrong subgrid value at " << idx
+                              << ": " << v << "\n";
+              PSAbort(1);
+            }
+          }
+        }
+      }
+      g->remote_grid_active() = false;
+      g->Swap();
+    }
+    gs->DeleteGrid(g);
+    delete gs;
+  }
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+// Checks the halo of width one, where halo points out of the grid
+// are checked only if periodic, and diagonal points only if diagonal
+static void check_grid_index_periodic(GridMPI *g, float base,
+                                      bool diagonal, bool periodic) {
+  const IndexArray &lo = g->local_offset();
+  const IndexArray &ls = g->local_size();
+  for (PSIndex k = lo[2] - 1; k < lo[2] + ls[2] + 1; ++k) {
+    for (PSIndex j = lo[1] - 1; j < lo[1] + ls[1] + 1; ++j) {
+      for (PSIndex i = lo[0] - 1; i < lo[0] + ls[0] + 1; ++i) {
+        IndexArray idx(i, j, k);
+        IndexArray wrapped = idx;
+        bool in_grid = true;
+        int num_halo_dims = 0;
+        for (int l = 0; l < NDIM; ++l) {
+          if (idx[l] < lo[l] || idx[l] >= lo[l] + ls[l]) ++num_halo_dims;
+          if (idx[l] < 0 || idx[l] >= N) in_grid = false;
+          wrapped[l] = (idx[l] + N) % N;
+        }
+        if ((!in_grid && !periodic) || (num_halo_dims > 1 && !diagonal)) {
+          continue;
+        }
+        float v = *(float*)g->GetAddress(idx);
+        if (v != base + wrapped[0] + wrapped[1] * N + wrapped[2] * N * N) {
+          LOG_ERROR_MPI() << "Wrong halo value at " << idx << ": " << v << "\n";
+          PSAbort(1);
+        }
+      }
+    }
+  }
+}
+
+// Exchanges halos of a double-buffered grid in all modes
+static void check_halo_exchanges(GridSpaceMPI *gs, GridMPI *g) {
+  UnsignedArray halo(1, 1, 1);
+  for (int i = 0; i < 16; ++i) {
+    bool diagonal = i / 2 % 2;
+    bool periodic = i / 4 % 2;
+    // Alternate the exchange modes as well as the buffers
+    gs->set_simultaneous_exchange(i / 8 % 2);
+    float base = i * N * N * N;
+    init_grid_index(g, base);
+    if (i % 4 == 3) {
+      gs->ExchangeBoundariesBegin(g, halo, halo, diagonal, periodic);
+      gs->ExchangeBoundariesEnd();
+    } else {
+      gs->ExchangeBoundaries(g->id(), halo, halo, diagonal, periodic);
+    }
+    check_grid_index_periodic(g, base, diagonal, periodic);
+    g->Swap();
+  }
+}
+
+void test22() {
+  LOG_DEBUG_MPI() << "RMA halo exchanges\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  gs->set_halo_padding(1);
+  gs->set_halo_transport(HALO_TRANSPORT_RMA);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              true, global_offset, 0);
+  check_halo_exchanges(gs, g);
+  gs->DeleteGrid(g);
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test23() {
+  LOG_DEBUG_MPI() << "Shared memory halo exchanges\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  // All processes on the node, and then split into two nodes along
+  // the last dimension to mix copies and messages
+  for (int nodes = 1; nodes <= 2; ++nodes) {
+    GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size,
+                                        my_rank);
+    gs->set_halo_padding(1);
+    gs->set_halo_transport(HALO_TRANSPORT_SHM);
+    if (nodes == 2) {
+      MPI_Comm comm;
+      MPI_Comm_split(MPI_COMM_WORLD, my_rank / 4, my_rank, &comm);
+      gs->set_shared_comm(comm);
+    }
+    IndexArray global_offset;
+    GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                                true, global_offset, 0);
+    for (int i = 0; i < gs->num_procs(); ++i) {
+      if (gs->IsSharedPeer(i) != (nodes == 1 || i / 4 == my_rank / 4)) {
+        LOG_ERROR_MPI() << "Wrong shared peer: " << i << "\n";
+        PSAbort(1);
+      }
+    }
+    check_halo_exchanges(gs, g);
+    gs->DeleteGrid(g);
+    delete gs;
+  }
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test24() {
+  LOG_DEBUG_MPI() << "Exchange with padded halos and diagonal points\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size, my_rank);
+  gs->set_halo_padding(1);
+  IndexArray global_offset;
+  GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                              false, global_offset, 0);
+  init_grid_index(g);
+  UnsignedArray halo(1, 1, 1);
+  gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+  check_grid_index(g);
+  delete g;
+  delete gs;
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
+void test25() {
+  LOG_DEBUG_MPI() << "Exchanges with different widths of higher dimensions\n";
+  IndexArray global_size(N, N, N);
+  IntArray proc_size(2, 2, 2);
+  int paddings[] = {0, 1, 1, 1};
+  HaloTransport transports[] = {HALO_TRANSPORT_P2P, HALO_TRANSPORT_P2P,
+                                HALO_TRANSPORT_RMA, HALO_TRANSPORT_SHM};
+  for (int i = 0; i < 4; ++i) {
+    GridSpaceMPI *gs = new GridSpaceMPI(NDIM, global_size, NDIM, proc_size,
+                                        my_rank);
+    gs->set_halo_padding(paddings[i]);
+    gs->set_halo_transport(transports[i]);
+    IndexArray global_offset;
+    GridMPI *g = gs->CreateGrid(PS_FLOAT, sizeof(float), NDIM, global_size,
+                                false, global_offset, 0);
+    // The diagonal points of the lower dimensions depend on the
+    // halo widths of the last dimension
+    UnsignedArray halo(1, 1, 1);
+    UnsignedArray halo_2d(1, 1, 0);
+    init_grid_index(g);
+    gs->ExchangeBoundaries(g->id(), halo_2d, halo_2d, true, false);
+    init_grid_index(g, N * N * N);
+    gs->ExchangeBoundaries(g->id(), halo, halo, true, false);
+    check_grid_index(g, N * N * N);
+    gs->DeleteGrid(g);
+    delete gs;
+  }
+  LOG_DEBUG_MPI() << "Finished\n";
+}
+
 int main(int argc, char *argv[]) {
-  MPI_Init(&argc, &argv);
+  // Threads are needed for asynchronous checkpointing
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
   MPI_Comm_rank(MPI_COMM_WORLD, &my_rank);
   int num_procs;
   MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
@@ -224,6 +863,40 @@ int main(int argc, char *argv[]) {
       test7();
     } else if (strcmp(argv[i], "test8") == 0) {
       test8();
+    } else if (strcmp(argv[i], "test9") == 0) {
+      test9();
+    } else if (strcmp(argv[i], "test10") == 0) {
+      test10();
+    } else if (strcmp(argv[i], "test11") == 0) {
+      test11();
+    } else if (strcmp(argv[i], "test12") == 0) {
+      test12();
+    } else if (strcmp(argv[i], "test13") == 0) {
+      test13();
+    } else if (strcmp(argv[i], "test14") == 0) {
+      test14();
+    } else if (strcmp(argv[i], "test15") == 0) {
+      test15();
+    } else if (strcmp(argv[i], "test16") == 0) {
+      test16();
+    } else if (strcmp(argv[i], "test17") == 0) {
+      test17();
+    } else if (strcmp(argv[i], "test18") == 0) {
+      test18();
+    } else if (strcmp(argv[i], "test19") == 0) {
+      test19();
+    } else if (strcmp(argv[i], "test20") == 0) {
+      test20();
+    } else if (strcmp(argv[i], "test21") == 0) {
+      test21();
+    } else if (strcmp(argv[i], "test22") == 0) {
+      test22();
+    } else if (strcmp(argv[i], "test23") == 0) {
+      test23();
+    } else if (strcmp(argv[i], "test24") == 0) {
+      test24();
+    } else if (strcmp(argv[i], "test25") == 0) {
+      test25();
     }
   }
   LOG_DEBUG_MPI() << "Finished\n";  
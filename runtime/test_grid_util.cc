@@ -0,0 +1,210 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "runtime/grid_util.h"
+#include "runtime/timing.h"
+
+#include <vector>
+
+using namespace std;
+using namespace physis::runtime;
+using namespace physis;
+
+// Naive element-wise copy for reference
+static void ref_copy(size_t elm_size, int num_dims,
+                     char *grid, const IndexArray &grid_size,
+                     char *buf, const IndexArray &offset,
+                     const IndexArray &size, bool copyout) {
+  IndexArray idx;
+  PSIndex n = size.accumulate(num_dims);
+  for (PSIndex p = 0; p < n; ++p) {
+    PSIndex q = p;
+    PSIndex goff = 0;
+    PSIndex gstride = 1;
+    for (int i = 0; i < num_dims; ++i) {
+      idx[i] = q % size[i];
+      q /= size[i];
+      goff += (offset[i] + idx[i]) * gstride;
+      gstride *= grid_size[i];
+    }
+    if (copyout) {
+      memcpy(buf + p * elm_size, grid + goff * elm_size, elm_size);
+    } else {
+      memcpy(grid + goff * elm_size, buf + p * elm_size, elm_size);
+    }
+  }
+}
+
+static void check_copy(size_t elm_size, int num_dims,
+                       const IndexArray &grid_size,
+                       const IndexArray &offset,
+                       const IndexArray &size) {
+  size_t grid_bytes = grid_size.accumulate(num_dims) * elm_size;
+  size_t buf_bytes = size.accumulate(num_dims) * elm_size;
+  vector<char> grid(grid_bytes), grid_ref(grid_bytes);
+  vector<char> buf(buf_bytes), buf_ref(buf_bytes);
+  for (size_t i = 0; i < grid_bytes; ++i) {
+    grid[i] = grid_ref[i] = (char)(i * 7);
+  }
+  CopyoutSubgrid(elm_size, num_dims, &grid[0], grid_size, &buf[0],
+                 offset, size);
+  ref_copy(elm_size, num_dims, &grid_ref[0], grid_size, &buf_ref[0],
+           offset, size, true);
+  if (buf != buf_ref) {
+    LOG_ERROR() << "CopyoutSubgrid mismatch: grid " << grid_size
+                << ", offset " << offset << ", size " << size
+                << ", element size " << elm_size << "\n";
+    PSAbort(1);
+  }
+  for (size_t i = 0; i < buf_bytes; ++i) {
+    buf[i] = buf_ref[i] = (char)(i * 3 + 1);
+  }
+  CopyinSubgrid(elm_size, num_dims, &grid[0], grid_size, &buf[0],
+                offset, size);
+  ref_copy(elm_size, num_dims, &grid_ref[0], grid_size, &buf_ref[0],
+           offset, size, false);
+  if (grid != grid_ref) {
+    LOG_ERROR() << "CopyinSubgrid mismatch: grid " << grid_size
+                << ", offset " << offset << ", size " << size
+                << ", element size " << elm_size << "\n";
+    PSAbort(1);
+  }
+}
+
+// Sub grids of various shapes
+void test1() {
+  size_t elm_sizes[] = {4, 8, 12};
+  for (int e = 0; e < 3; ++e) {
+    size_t es = elm_sizes[e];
+    check_copy(es, 1, IndexArray(16), IndexArray(3), IndexArray(9));
+    check_copy(es, 2, IndexArray(8, 6), IndexArray(1, 2), IndexArray(5, 3));
+    check_copy(es, 2, IndexArray(8, 6), IndexArray(0, 2), IndexArray(8, 3));
+    check_copy(es, 3, IndexArray(7, 6, 5), IndexArray(1, 2, 1),
+               IndexArray(4, 3, 3));
+    // Halo-like thin sub grids
+    check_copy(es, 3, IndexArray(7, 6, 5), IndexArray(6, 0, 0),
+               IndexArray(1, 6, 5));
+    check_copy(es, 3, IndexArray(7, 6, 5), IndexArray(0, 5, 0),
+               IndexArray(7, 1, 5));
+    check_copy(es, 3, IndexArray(7, 6, 5), IndexArray(0, 0, 4),
+               IndexArray(7, 6, 1));
+    // Whole grid
+    check_copy(es, 3, IndexArray(7, 6, 5), IndexArray(0, 0, 0),
+               IndexArray(7, 6, 5));
+  }
+}
+
+// Empty sub grids
+void test2() {
+  char c = 0;
+  CopyoutSubgrid(4, 3, &c, IndexArray(4, 4, 4), &c,
+                 IndexArray(1, 1, 1), IndexArray(0, 2, 2));
+  CopyinSubgrid(4, 3, &c, IndexArray(4, 4, 4), &c,
+                IndexArray(1, 1, 1), IndexArray(2, 2, 0));
+}
+
+// Large sub grids copied with multiple threads
+void test3() {
+  check_copy(8, 3, IndexArray(130, 128, 128), IndexArray(1, 1, 1),
+             IndexArray(128, 126, 126));
+}
+
+// Copies between grids of different sizes through a contiguous
+// buffer for reference
+static void check_copy_between_grids(size_t elm_size, int num_dims,
+                                     const IndexArray &dst_size,
+                                     const IndexArray &dst_offset,
+                                     const IndexArray &src_size,
+                                     const IndexArray &src_offset,
+                                     const IndexArray &size) {
+  size_t dst_bytes = dst_size.accumulate(num_dims) * elm_size;
+  size_t src_bytes = src_size.accumulate(num_dims) * elm_size;
+  vector<char> dst(dst_bytes), dst_ref(dst_bytes), src(src_bytes);
+  vector<char> buf(size.accumulate(num_dims) * elm_size);
+  for (size_t i = 0; i < src_bytes; ++i) src[i] = (char)(i * 5 + 2);
+  CopySubgridBetweenGrids(elm_size, num_dims, &dst[0], dst_size, dst_offset,
+                          &src[0], src_size, src_offset, size);
+  ref_copy(elm_size, num_dims, &src[0], src_size, &buf[0],
+           src_offset, size, true);
+  ref_copy(elm_size, num_dims, &dst_ref[0], dst_size, &buf[0],
+           dst_offset, size, false);
+  if (dst != dst_ref) {
+    LOG_ERROR() << "CopySubgridBetweenGrids mismatch: " << src_size
+                << " at " << src_offset << " to " << dst_size
+                << " at " << dst_offset << ", size " << size << "\n";
+    PSAbort(1);
+  }
+}
+
+// Halo-like copies between grids
+void test4() {
+  check_copy_between_grids(4, 1, IndexArray(10), IndexArray(0),
+                           IndexArray(12), IndexArray(9), IndexArray(2));
+  check_copy_between_grids(8, 2, IndexArray(6, 8), IndexArray(5, 1),
+                           IndexArray(7, 8), IndexArray(1, 1),
+                           IndexArray(1, 6));
+  check_copy_between_grids(4, 3, IndexArray(6, 6, 6), IndexArray(0, 1, 1),
+                           IndexArray(7, 6, 5), IndexArray(5, 1, 0),
+                           IndexArray(1, 4, 4));
+  check_copy_between_grids(4, 3, IndexArray(6, 6, 6), IndexArray(0, 0, 5),
+                           IndexArray(6, 6, 8), IndexArray(0, 0, 1),
+                           IndexArray(6, 6, 1));
+  // Large enough to be copied with multiple threads
+  check_copy_between_grids(8, 3, IndexArray(66, 66, 66), IndexArray(1, 1, 0),
+                           IndexArray(66, 66, 66), IndexArray(1, 1, 64),
+                           IndexArray(64, 64, 2));
+}
+
+// Microbenchmark of halo-like copies of a 3-D grid
+void bench(PSIndex n, int iter) {
+  IndexArray grid_size(n, n, n);
+  size_t elm_size = sizeof(double);
+  vector<char> grid(grid_size.accumulate(3) * elm_size);
+  vector<char> buf(grid.size());
+  const char *names[] = {"x-halo", "y-halo", "z-halo", "interior"};
+  IndexArray offsets[] = {IndexArray(0, 0, 0), IndexArray(0, 0, 0),
+                          IndexArray(0, 0, 0), IndexArray(1, 1, 1)};
+  IndexArray sizes[] = {IndexArray(1, n, n), IndexArray(n, 1, n),
+                        IndexArray(n, n, 1), IndexArray(n-2, n-2, n-2)};
+  for (int c = 0; c < 4; ++c) {
+    performance::Stopwatch st;
+    st.Start();
+    for (int i = 0; i < iter; ++i) {
+      CopyoutSubgrid(elm_size, 3, &grid[0], grid_size, &buf[0],
+                     offsets[c], sizes[c]);
+      CopyinSubgrid(elm_size, 3, &grid[0], grid_size, &buf[0],
+                    offsets[c], sizes[c]);
+    }
+    float t = st.Stop();
+    double bytes = 2.0 * sizes[c].accumulate(3) * elm_size * iter;
+    cout << names[c] << ": " << t / iter << " ms/iter, "
+         << bytes / (t * 1e-3) / 1e9 << " GB/s\n";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "test1") == 0) {
+      test1();
+    } else if (strcmp(argv[i], "test2") == 0) {
+      test2();
+    } else if (strcmp(argv[i], "test3") == 0) {
+      test3();
+    } else if (strcmp(argv[i], "test4") == 0) {
+      test4();
+    } else if (strcmp(argv[i], "bench") == 0) {
+      PSIndex n = 256;
+      int iter = 10;
+      if (i + 1 < argc) n = physis::toInteger(argv[++i]);
+      if (i + 1 < argc) iter = physis::toInteger(argv[++i]);
+      bench(n, iter);
+    }
+  }
+  LOG_DEBUG() << "Finished\n";
+  return 0;
+}
@@ -118,11 +118,10 @@ void test4() {
 void test5() {
   LOG_DEBUG() << "Test 5: Copyin and copyout";
   //PSVectorInt halo = {0, 0, 0};
-  PSVectorInt global_offset = {0, 0, 0};
   PSVectorInt grid_size = {N, N, N};
   int num_elms = N*N*N;
   GridMPI *g = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM, grid_size, 0,
-                                        0, global_offset);
+                                        0, NULL);
 
   float *idata = new float[num_elms];
   float *odata = new float[num_elms];
@@ -169,8 +168,285 @@ void test6() {
   PSPrintInternalInfo(stderr);
 }
 
+// Compares the inline accesses with __PSGridGetAddr at all points
+// but diagonal ones of the local subgrid and its halo, executed by all
+// processes.
+static void inline_access_client(int iter, void **stencils) {
+  int gid = *(int*)stencils[0];
+  GridMPI *g = (GridMPI*)__PSGetGridByID(gid);
+  PSVectorInt offset_min = {-1, -1, -1};
+  PSVectorInt offset_max = {1, 1, 1};
+  __PSLoadNeighbor(g, offset_min, offset_max, 0, 0, 0, 0);
+  __PSGridMPIDesc d = __PSGridGetDesc(g);
+  const IndexArray &lo = g->local_offset();
+  const IndexArray &ls = g->local_size();
+  for (PSIndex k = lo[2] - 1; k < lo[2] + ls[2] + 1; ++k) {
+    for (PSIndex j = lo[1] - 1; j < lo[1] + ls[1] + 1; ++j) {
+      for (PSIndex i = lo[0] - 1; i < lo[0] + ls[0] + 1; ++i) {
+        IndexArray idx(i, j, k);
+        int num_outside = 0;
+        bool in_grid = true;
+        for (int l = 0; l < NDIM; ++l) {
+          if (idx[l] < 0 || idx[l] >= N) in_grid = false;
+          if (idx[l] < lo[l] || idx[l] >= lo[l] + ls[l]) ++num_outside;
+        }
+        // Diagonal points are not exchanged
+        if (!in_grid || num_outside > 1) continue;
+        float *p = __PSGridGetAddrInlineFloat3D(g, &d, i, j, k);
+        if (p != __PSGridGetAddrFloat3D(g, i, j, k) ||
+            *p != i + j * N + k * N * N) {
+          cerr << "Inline access mismatch at " << idx << std::endl;
+          exit(1);
+        }
+      }
+    }
+  }
+}
+
+void test7() {
+  LOG_DEBUG() << "Test 7: inline grid access\n";
+  PSVectorInt grid_size = {N, N, N};
+  int num_elms = N*N*N;
+  GridMPI *g = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM,
+                                        grid_size, 0, 0, NULL);
+  float *data = new float[num_elms];
+  for (int i = 0; i < num_elms; ++i) data[i] = i;
+  PSGridCopyin(g, data);
+  int gid = g->id();
+  __PSStencilRun(2, 1, 1, sizeof(gid), &gid);
+  PSGridFree(g);
+  delete[] data;
+}
+
+void test9() {
+  LOG_DEBUG() << "Test 9: Save and load a grid file\n";
+  PSVectorInt grid_size = {N, N, N};
+  int num_elms = N*N*N;
+  GridMPI *g = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM, grid_size, 0,
+                                        0, NULL);
+  GridMPI *g2 = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM, grid_size, 0,
+                                         0, NULL);
+  float *idata = new float[num_elms];
+  float *odata = new float[num_elms];
+  for (int i = 0; i < num_elms; ++i) {
+    idata[i] = i;
+  }
+  const char *path = "test_mpi_runtime_3d_test9.dat";
+  PSGridCopyin(g, idata);
+  PSGridSaveFile(g, path);
+  PSGridLoadFile(g2, path);
+  PSGridCopyout(g2, odata);
+  remove(path);
+  for (int i = 0; i < num_elms; ++i) {
+    if (idata[i] != odata[i]) {
+      cerr << "Save and load failed; "
+           << "Input: " << idata[i]
+           << ", Output: " << odata[i] << std::endl;
+      exit(1);
+    }
+  }
+  PSGridFree(g);
+  PSGridFree(g2);
+  delete[] idata;
+  delete[] odata;
+}
+
+void test10() {
+  LOG_DEBUG() << "Test 10: Checkpoint and restart\n";
+  PSVectorInt grid_size = {N, N, N};
+  int num_elms = N*N*N;
+  GridMPI *g = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM, grid_size, 0,
+                                        0, NULL);
+  float *idata = new float[num_elms];
+  float *odata = new float[num_elms];
+  for (int i = 0; i < num_elms; ++i) {
+    idata[i] = i;
+    odata[i] = 0;
+  }
+  PSGridCopyin(g, idata);
+  PSCheckpoint();
+  PSGridCopyin(g, odata);
+  PSRestart();
+  PSGridCopyout(g, odata);
+  remove(("./physis_ckpt_" + toString(g->id())).c_str());
+  for (int i = 0; i < num_elms; ++i) {
+    if (idata[i] != odata[i]) {
+      cerr << "Checkpoint and restart failed; "
+           << "Input: " << idata[i]
+           << ", Output: " << odata[i] << std::endl;
+      exit(1);
+    }
+  }
+  PSGridFree(g);
+  delete[] idata;
+  delete[] odata;
+}
+
+// Client handler as generated for kernel reductions
+static void reduce_client(int iter, void **stencils) {
+  float *v = (float*)stencils[1];
+  *v = pinfo->rank() + 1;
+  __PSReduceAllFloat(v, PS_SUM);
+}
+
+void test11() {
+  LOG_DEBUG() << "Test 11: Kernel reduction\n";
+  int dummy = 0;
+  float v = 0;
+  __PSStencilRun(0, 1, 2, sizeof(dummy), &dummy, sizeof(v), &v);
+  int np;
+  MPI_Comm_size(MPI_COMM_WORLD, &np);
+  if (v != np * (np + 1) / 2) {
+    cerr << "Reduction failed; "
+         << "Expected: " << np * (np + 1) / 2
+         << ", Output: " << v << std::endl;
+    exit(1);
+  }
+}
+
+// Sums the 7-point neighbors of src into dst over a domain.
+static void sum_neighbors(GridMPI *src, GridMPI *dst,
+                          const __PSDomain *dom) {
+  for (PSIndex k = dom->local_min[2]; k < dom->local_max[2]; ++k) {
+    for (PSIndex j = dom->local_min[1]; j < dom->local_max[1]; ++j) {
+      for (PSIndex i = dom->local_min[0]; i < dom->local_max[0]; ++i) {
+        float v = *(float*)src->GetAddress(IndexArray(i, j, k))
+            + *(float*)src->GetAddress(IndexArray(i-1, j, k))
+            + *(float*)src->GetAddress(IndexArray(i+1, j, k))
+            + *(float*)src->GetAddress(IndexArray(i, j-1, k))
+            + *(float*)src->GetAddress(IndexArray(i, j+1, k))
+            + *(float*)src->GetAddress(IndexArray(i, j, k-1))
+            + *(float*)src->GetAddress(IndexArray(i, j, k+1));
+        *(float*)dst->GetAddress(IndexArray(i, j, k)) = v;
+      }
+    }
+  }
+}
+
+// Runs two stencils per iteration like the code translated with deep
+// halos; the halos of width 2 are exchanged once per iteration, and
+// the first stencil is also computed on the halo of width 1.
+static void deep_halo_client(int iter, void **stencils) {
+  int *ids = (int*)stencils[0];
+  GridMPI *g0 = (GridMPI*)__PSGetGridByID(ids[0]);
+  GridMPI *g1 = (GridMPI*)__PSGetGridByID(ids[1]);
+  __PSDomain dom;
+  for (int i = 0; i < PS_MAX_DIM; ++i) {
+    dom.min[i] = 1;
+    dom.max[i] = N - 1;
+  }
+  __PSDomainSetLocalSize(&dom);
+  PSVectorInt offset_min = {-2, -2, -2};
+  PSVectorInt offset_max = {2, 2, 2};
+  for (int i = 0; i < iter; ++i) {
+    __PSLoadNeighbor((__PSGridMPI*)g0, offset_min, offset_max, 1, 0, 0, 0);
+    __PSLoadNeighbor((__PSGridMPI*)g1, offset_min, offset_max, 1, 0, 0, 0);
+    __PSDomain extended_dom = __PSDomainExtend(&dom, 1);
+    sum_neighbors(g0, g1, &extended_dom);
+    sum_neighbors(g1, g0, &dom);
+  }
+}
+
+void test12() {
+  LOG_DEBUG() << "Test 12: Deep halo\n";
+  PSVectorInt grid_size = {N, N, N};
+  int num_elms = N*N*N;
+  GridMPI *g0 = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM,
+                                         grid_size, 0, 0, NULL);
+  GridMPI *g1 = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM,
+                                         grid_size, 0, 0, NULL);
+  float *data0 = new float[num_elms];
+  float *data1 = new float[num_elms];
+  float *odata = new float[num_elms];
+  for (int i = 0; i < num_elms; ++i) {
+    data0[i] = i % 7;
+    data1[i] = i % 5;
+  }
+  PSGridCopyin(g0, data0);
+  PSGridCopyin(g1, data1);
+  int ids[2] = {g0->id(), g1->id()};
+  int iter = 3;
+  __PSStencilRun(1, iter, 1, sizeof(ids), ids);
+  PSGridCopyout(g0, odata);
+
+  // Same computation over the whole grids
+  for (int t = 0; t < iter; ++t) {
+    for (int l = 0; l < 2; ++l) {
+      float *src = l == 0 ? data0 : data1;
+      float *dst = l == 0 ? data1 : data0;
+      for (int k = 1; k < N-1; ++k) {
+        for (int j = 1; j < N-1; ++j) {
+          for (int i = 1; i < N-1; ++i) {
+            int x = i + j * N + k * N * N;
+            dst[x] = src[x] + src[x-1] + src[x+1] + src[x-N] + src[x+N]
+                + src[x-N*N] + src[x+N*N];
+          }
+        }
+      }
+    }
+  }
+  for (int i = 0; i < num_elms; ++i) {
+    if (data0[i] != odata[i]) {
+      cerr << "Deep halo run failed at " << i << "; "
+           << "Expected: " << data0[i]
+           << ", Output: " << odata[i] << std::endl;
+      exit(1);
+    }
+  }
+  PSGridFree(g0);
+  PSGridFree(g1);
+  delete[] data0;
+  delete[] data1;
+  delete[] odata;
+}
+
+void test13() {
+  LOG_DEBUG() << "Test 13: Set, get and reduce grid elements\n";
+  PSVectorInt grid_size = {N, N, N};
+  GridMPI *g = (GridMPI*)__PSGridNewMPI(PS_FLOAT, sizeof(float), NDIM, grid_size, 0,
+                                        0, NULL);
+  int num_elms = N*N*N;
+  float *data = new float[num_elms];
+  for (int i = 0; i < num_elms; ++i) data[i] = 1;
+  PSGridCopyin(g, data);
+  float v = 5;
+  __PSGridSet((__PSGridMPI*)g, &v, (PSIndex)N-1, (PSIndex)0, (PSIndex)N-1);
+  // Values are returned to the processes executing the program
+  v = __PSGridGetFloat((__PSGridMPI*)g, (PSIndex)N-1, (PSIndex)0,
+                       (PSIndex)N-1);
+  if (v != 5) {
+    cerr << "Get failed; Expected: 5, Output: " << v << std::endl;
+    exit(1);
+  }
+  __PSReduceGridFloat(&v, PS_SUM, (__PSGridMPI*)g);
+  if (v != num_elms + 4) {
+    cerr << "Grid reduction failed; "
+         << "Expected: " << num_elms + 4
+         << ", Output: " << v << std::endl;
+    exit(1);
+  }
+  PSGridFree(g);
+  delete[] data;
+}
+
 int main(int argc, char *argv[]) {
-  PSInit(&argc, &argv, NDIM, N, N, N);
+  __PSStencilRunClientFunction stencil_clients[] = {reduce_client,
+                                                    deep_halo_client,
+                                                    inline_access_client};
+  // Grids need to be padded for deep halos before initialization
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "test12") == 0) __PSSetMinHaloPadding(2);
+  }
+  // Test 13 checks the values returned to all processes
+  vector<char*> args(argv, argv + argc);
+  char spmd_option[] = "--physis-spmd";
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "test13") == 0) args.push_back(spmd_option);
+  }
+  args.push_back(NULL);
+  argc = args.size() - 1;
+  argv = &args[0];
+  PSInit(&argc, &argv, NDIM, N, N, N, 3, stencil_clients);
   for (int i = 1; i < argc; ++i) {
     if (strcmp(argv[i], "test0") == 0) {
       test0();
@@ -186,6 +462,18 @@ int main(int argc, char *argv[]) {
       test5();
     } else if (strcmp(argv[i], "test6") == 0) {
       test6();
+    } else if (strcmp(argv[i], "test7") == 0) {
+      test7();
+    } else if (strcmp(argv[i], "test9") == 0) {
+      test9();
+    } else if (strcmp(argv[i], "test10") == 0) {
+      test10();
+    } else if (strcmp(argv[i], "test11") == 0) {
+      test11();
+    } else if (strcmp(argv[i], "test12") == 0) {
+      test12();
+    } else if (strcmp(argv[i], "test13") == 0) {
+      test13();
     }
   }
 
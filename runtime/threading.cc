@@ -0,0 +1,102 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "runtime/threading.h"
+
+#include <string>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using std::string;
+
+namespace physis {
+namespace runtime {
+
+void ParseThreadOptions(int *argc, char ***argv) {
+  vector<string> opts;
+  if (ParseOption(argc, argv, "physis-threads", 1, opts)) {
+    int num_threads = physis::toInteger(opts[1]);
+    if (num_threads < 1) {
+      LOG_ERROR() << "Invalid number of threads: " << opts[1] << "\n";
+      PSAbort(1);
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(num_threads);
+    LOG_INFO() << "Number of threads: " << num_threads << "\n";
+#else
+    LOG_WARNING() << "Runtime built without OpenMP; "
+                  << "physis-threads option ignored\n";
+#endif
+  }
+  opts.clear();
+  if (ParseOption(argc, argv, "physis-thread-affinity", 1, opts)) {
+    ThreadAffinity affinity;
+    if (opts[1] == "none") {
+      affinity = THREAD_AFFINITY_NONE;
+    } else if (opts[1] == "compact") {
+      affinity = THREAD_AFFINITY_COMPACT;
+    } else if (opts[1] == "scatter") {
+      affinity = THREAD_AFFINITY_SCATTER;
+    } else {
+      LOG_ERROR() << "Unknown thread affinity: " << opts[1] << "\n";
+      PSAbort(1);
+    }
+    if (affinity != THREAD_AFFINITY_NONE && !BindThreads(affinity)) {
+      LOG_WARNING() << "Failed to bind threads; "
+                    << "physis-thread-affinity option ignored\n";
+    }
+  }
+}
+
+bool BindThreads(ThreadAffinity affinity) {
+#if defined(__linux__) && defined(_OPENMP)
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed)) return false;
+  vector<int> cpus;
+  for (int i = 0; i < CPU_SETSIZE; ++i) {
+    if (CPU_ISSET(i, &allowed)) cpus.push_back(i);
+  }
+  if (cpus.empty()) return false;
+  int num_threads = GetNumThreads();
+  int num_cpus = cpus.size();
+  int num_failures = 0;
+#pragma omp parallel reduction(+:num_failures)
+  {
+    int tid = omp_get_thread_num();
+    int cpu = affinity == THREAD_AFFINITY_COMPACT ?
+        cpus[tid % num_cpus] :
+        cpus[(long)tid * num_cpus / num_threads % num_cpus];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // Applies to the calling thread
+    if (sched_setaffinity(0, sizeof(set), &set)) ++num_failures;
+  }
+  if (num_failures) return false;
+  LOG_INFO() << "Bound " << num_threads << " threads to "
+             << num_cpus << " CPUs\n";
+  return true;
+#else
+  return false;
+#endif
+}
+
+int GetNumThreads() {
+#ifdef _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+} // namespace runtime
+} // namespace physis
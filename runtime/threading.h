@@ -0,0 +1,49 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#ifndef PHYSIS_RUNTIME_THREADING_H_
+#define PHYSIS_RUNTIME_THREADING_H_
+
+#include "runtime/runtime_common.h"
+
+namespace physis {
+namespace runtime {
+
+enum ThreadAffinity {
+  //! Leave the placement of threads to the OS and OpenMP runtime
+  THREAD_AFFINITY_NONE,
+  //! Bind consecutive threads to consecutive CPUs
+  THREAD_AFFINITY_COMPACT,
+  //! Spread threads evenly over the CPUs
+  THREAD_AFFINITY_SCATTER
+};
+
+//! Parse the threading options.
+/*!
+  Threads are bound to the CPUs the process is allowed to run on,
+  e.g., the socket an MPI process is bound to by mpirun.
+
+  Options:
+  --physis-threads <number of threads>
+  --physis-thread-affinity <none|compact|scatter>
+ */
+void ParseThreadOptions(int *argc, char ***argv);
+
+//! Bind each OpenMP thread to a CPU.
+/*!
+  \return False if not supported or failed.
+ */
+bool BindThreads(ThreadAffinity affinity);
+
+//! Number of threads used in parallel regions.
+int GetNumThreads();
+
+} // namespace runtime
+} // namespace physis
+
+#endif /* PHYSIS_RUNTIME_THREADING_H_ */
@@ -208,6 +208,46 @@ function generate_translation_configurations_ref()
     echo "OPT_LOOP_OPT = true" >> $c		
 	new_configs="$new_configs $c"
 	idx=$(($idx + 1))
+
+	c=config.ref.$idx
+    echo "OPT_OPENMP = true" > $c
+	new_configs="$new_configs $c"
+	idx=$(($idx + 1))
+
+	c=config.ref.$idx
+    echo "OPT_KERNEL_INLINING = true" > $c
+    echo "OPT_OPENMP = true" >> $c
+    echo "OPT_OPENMP_SCHEDULE = \"dynamic\"" >> $c
+	new_configs="$new_configs $c"
+	idx=$(($idx + 1))
+
+	c=config.ref.$idx
+    echo "TEMPORAL_BLOCKING = 2" > $c
+    echo "TEMPORAL_BLOCKING_SIZE = 2" >> $c
+	new_configs="$new_configs $c"
+	idx=$(($idx + 1))
+
+	c=config.ref.$idx
+    echo "OPT_STENCIL_FUSION = true" > $c
+	new_configs="$new_configs $c"
+	idx=$(($idx + 1))
+
+	c=config.ref.$idx
+    echo "OPT_LOOP_TILING = true" > $c
+	new_configs="$new_configs $c"
+	idx=$(($idx + 1))
+
+	c=config.ref.$idx
+    echo "OPT_LOOP_TILING = true" > $c
+    echo "OPT_LOOP_TILING_SIZE = {0, 5, 3}" >> $c
+    echo "OPT_OPENMP = true" >> $c
+	new_configs="$new_configs $c"
+	idx=$(($idx + 1))
+
+	c=config.ref.$idx
+    echo "OPT_SIMD = true" > $c
+	new_configs="$new_configs $c"
+	idx=$(($idx + 1))
 	
     echo $new_configs
 }
@@ -328,9 +368,23 @@ function generate_translation_configurations_mpi()
 {
     if [ $# -gt 0 ]; then
 		echo $1
-    else
-		generate_empty_translation_configuration
+		return
     fi
+    local new_configs=$(generate_empty_translation_configuration)
+    local c=config.mpi.0
+    echo "MPI_OVERLAP = true" > $c
+    new_configs="$new_configs $c"
+    c=config.mpi.1
+    echo "MPI_DEEP_HALO = 2" > $c
+    new_configs="$new_configs $c"
+    c=config.mpi.2
+    echo "OPT_OPENMP = true" > $c
+    new_configs="$new_configs $c"
+    c=config.mpi.3
+    echo "OPT_OPENMP = true" > $c
+    echo "MPI_OVERLAP = true" >> $c
+    new_configs="$new_configs $c"
+    echo $new_configs
 }
 
 function generate_translation_configurations_mpi_cuda()
@@ -405,11 +459,17 @@ function compile()
     LDFLAGS="-L${CMAKE_BINARY_DIR}/runtime -lm"
     NVCC_CFLAGS="-arch sm_20"
     CUDA_LDFLAGS="-lcudart -L${CUDA_RT_DIR}"
+    # The runtime libraries are compiled with OpenMP
+    OPENMP_LDFLAGS="${OpenMP_CXX_FLAGS}"
+    NVCC_OPENMP_LDFLAGS=""
+    if [ -n "$OPENMP_LDFLAGS" ]; then
+		NVCC_OPENMP_LDFLAGS="-Xcompiler $OPENMP_LDFLAGS"
+    fi
     case $target in
 		ref)
 			src_file="$src_file_base".c
-			cc -c $src_file -I${CMAKE_SOURCE_DIR}/include $CFLAGS &&
-			c++ "$src_file_base".o -lphysis_rt_ref $LDFLAGS -o "$src_file_base".exe
+			cc -c $src_file -I${CMAKE_SOURCE_DIR}/include $CFLAGS ${OpenMP_C_FLAGS} &&
+			c++ "$src_file_base".o -lphysis_rt_ref $LDFLAGS $OPENMP_LDFLAGS -o "$src_file_base".exe
 			;;
 		cuda)
 			if [ "${CUDA_ENABLED}" != "TRUE" ]; then
@@ -419,7 +479,7 @@ function compile()
 			src_file="$src_file_base".cu
 			nvcc -m64 -c $src_file -I${CMAKE_SOURCE_DIR}/include $NVCC_CFLAGS -Xcompiler $(echo $CFLAGS|sed 's/ /,/g') &&
 			nvcc -m64 "$src_file_base".o  -lphysis_rt_cuda $LDFLAGS \
-				'${CUDA_CUT_LIBRARIES}' -o "$src_file_base".exe
+				$NVCC_OPENMP_LDFLAGS '${CUDA_CUT_LIBRARIES}' -o "$src_file_base".exe
 			;;
 		mpi)
 			if [ "${MPI_ENABLED}" != "TRUE" ]; then
@@ -427,8 +487,8 @@ function compile()
 				return 0
 			fi
 			src_file="$src_file_base".c			
-			cc -c $src_file -I${CMAKE_SOURCE_DIR}/include $MPI_CFLAGS $CFLAGS &&
-			mpic++ "$src_file_base".o -lphysis_rt_mpi $LDFLAGS -o "$src_file_base".exe
+			cc -c $src_file -I${CMAKE_SOURCE_DIR}/include $MPI_CFLAGS $CFLAGS ${OpenMP_C_FLAGS} &&
+			mpic++ "$src_file_base".o -lphysis_rt_mpi $LDFLAGS $OPENMP_LDFLAGS -o "$src_file_base".exe
 			;;
 		mpi-cuda)
 			if [ "${MPI_ENABLED}" != "TRUE" -o "${CUDA_ENABLED}" != "TRUE" ]; then
@@ -447,6 +507,7 @@ function compile()
 			nvcc -m64 -c $src_file -I${CMAKE_SOURCE_DIR}/include \
 				$NVCC_CFLAGS $MPI_CUDA_CFLAGS &&
 			mpic++ "$src_file_base".o -lphysis_rt_mpi_cuda $LDFLAGS $CUDA_LDFLAGS \
+				$OPENMP_LDFLAGS \
 				'${CUDA_CUT_LIBRARIES}' -o "$src_file_base".exe
 			;;
 		*)
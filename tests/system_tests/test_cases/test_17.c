@@ -0,0 +1,61 @@
+/*
+ * TEST: Kernel reduction OP=PS_SUM
+ * DIM: 3
+ * PRIORITY: 2
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "physis/physis.h"
+
+#define N 8
+#define REAL float
+#define PSGrid3D PSGrid3DFloat
+#define PSGrid3DNew PSGrid3DFloatNew
+
+REAL kernel(const int x, const int y, const int z, PSGrid3D g) {
+  return PSGridGet(g, x-1, y, z) + PSGridGet(g, x+1, y, z)
+      + PSGridGet(g, x, y, z-1) * PSGridGet(g, x, y, z+1);
+}
+
+#define IDX(x, y, z) ((x) + (y) * N + (z) * N * N)
+
+REAL reduce(REAL *g) {
+  REAL v = 0;
+  int x, y, z;
+  for (z = 1; z < N-1; ++z) {
+    for (y = 1; y < N-1; ++y) {
+      for (x = 1; x < N-1; ++x) {
+        v += g[IDX(x-1, y, z)] + g[IDX(x+1, y, z)]
+            + g[IDX(x, y, z-1)] * g[IDX(x, y, z+1)];
+      }
+    }
+  }
+  return v;
+}
+
+int main(int argc, char *argv[]) {
+  PSInit(&argc, &argv, 3, N, N, N);
+  PSGrid3D g1 = PSGrid3DNew(N, N, N);
+  PSDomain3D d = PSDomain3DNew(1, N-1, 1, N-1, 1, N-1);
+  size_t nelms = N*N*N;
+  REAL *indata = (REAL *)malloc(sizeof(REAL) * nelms);
+  int i;
+  for (i = 0; i < nelms; i++) {
+    indata[i] = i % 7;
+  }
+  PSGridCopyin(g1, indata);
+  REAL v;
+  PSReduce(&v, PS_SUM, kernel, d, g1);
+  REAL v_ref = reduce(indata);
+  fprintf(stderr, "Reduction result: %f, reference: %f\n", v, v_ref);
+  if (v != v_ref) {
+    fprintf(stderr, "Error: Non matching result\n");
+    exit(1);
+  }
+  PSGridFree(g1);
+  PSFinalize();
+  free(indata);
+  return 0;
+}
+
@@ -22,15 +22,24 @@ class Configuration: public pu::Configuration {
     CUDA_PRE_CALC_GRID_ADDRESS,
     CUDA_BLOCK_SIZE,
     MPI_OVERLAP,
-    MULTISTREAM_BOUNDARY};
+    MULTISTREAM_BOUNDARY,
+    TEMPORAL_BLOCKING,
+    TEMPORAL_BLOCKING_SIZE,
+    MPI_DEEP_HALO,
+    OPT_LOOP_TILING_SIZE};
   Configuration() {
     AddKey(CUDA_PRE_CALC_GRID_ADDRESS,
            "CUDA_PRE_CALC_GRID_ADDRESS");
     AddKey(CUDA_BLOCK_SIZE, "CUDA_BLOCK_SIZE");
     AddKey(MPI_OVERLAP, "MPI_OVERLAP");
     AddKey(MULTISTREAM_BOUNDARY, "MULTISTREAM_BOUNDARY");    
+    AddKey(TEMPORAL_BLOCKING, "TEMPORAL_BLOCKING");
+    AddKey(TEMPORAL_BLOCKING_SIZE, "TEMPORAL_BLOCKING_SIZE");
+    AddKey(MPI_DEEP_HALO, "MPI_DEEP_HALO");
+    AddKey(OPT_LOOP_TILING_SIZE, "OPT_LOOP_TILING_SIZE");
   }
   virtual ~Configuration() {}
+  using pu::Configuration::Lookup;
   const pu::LuaValue *Lookup(ConfigKey key) const {
     return LookupInternal((int)key);
   }
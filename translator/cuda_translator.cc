@@ -204,6 +204,11 @@ SgExpression *CUDATranslator::BuildBlockDimZ() {
   return sb::buildIntVal(block_dim_z_);
 }
 
+void CUDATranslator::TranslateReduceKernel(Reduce *rd) {
+  LOG_ERROR() << "Kernel reduction is not supported in this target.\n";
+  PSAbort(1);
+}
+
 SgBasicBlock *CUDATranslator::BuildRunBody(Run *run) {
   SgBasicBlock *block = sb::buildBasicBlock();
   // int i;
@@ -93,6 +93,8 @@ class CUDATranslator : public ReferenceTranslator {
     \return The basic block of the stencil run function. 
    */
   virtual SgBasicBlock *BuildRunBody(Run *run);
+  //! Kernel reductions are not supported yet.
+  virtual void TranslateReduceKernel(Reduce *rd);
   //! Generates a basic block of the run loop body.
   /*!
     This is a helper function for BuildRunBody. The run parameter
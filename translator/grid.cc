@@ -220,6 +220,15 @@ SgExpression *Grid::BuildAttributeExpr() {
   return si::copyExpression(attribute_);
 }
 
+bool MayAlias(const GridSet *x, const GridSet *y) {
+  if (x == NULL || y == NULL) return true;
+  if (y->find(NULL) != y->end()) return true;
+  FOREACH (it, x->begin(), x->end()) {
+    if (*it == NULL || y->find(*it) != y->end()) return true;
+  }
+  return false;
+}
+
 const std::string GridOffsetAttribute::name = "PSGridOffset";
 const std::string GridGetAttribute::name = "PSGridGet";
 const std::string GridEmitAttr::name = "PSGridEmit";
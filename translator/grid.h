@@ -171,6 +171,13 @@ class Grid {
 
 typedef std::set<Grid*> GridSet;
 
+//! Returns true if two grid sets may share a grid.
+/*!
+  A NULL set or a NULL member stands for an unknown grid, which may
+  be any grid.
+ */
+bool MayAlias(const GridSet *x, const GridSet *y);
+
 class GridOffsetAttribute: public AstAttribute {
  public:
   GridOffsetAttribute(int num_dim, bool periodic,
@@ -9,6 +9,7 @@
 #include "translator/map.h"
 #include "translator/rose_util.h"
 #include "translator/grid.h"
+#include "translator/reduce.h"
 #include "translator/translation_context.h"
 
 namespace physis {
@@ -19,7 +20,7 @@ Counter StencilMap::c;
 StencilMap::StencilMap(SgFunctionCallExp *call, TranslationContext *tx)
     :id(StencilMap::c.next()) , stencil_type_(NULL), func(NULL),
      run_(NULL), run_inner_(NULL), run_boundary_(NULL),
-     fc_(call) {
+     fc_(call), kernel_arg_index_(getKernelArgIndex(call)) {
   kernel = StencilMap::getKernelFromMapCall(fc_);
   assert(kernel);
   dom = StencilMap::getDomFromMapCall(fc_);
@@ -29,7 +30,7 @@ StencilMap::StencilMap(SgFunctionCallExp *call, TranslationContext *tx)
   SgInitializedNamePtrList &params = kernel->get_args();
   int param_index = numDim; // skip the index parameters
   // skip the first two args (kernel and domain)
-  FOREACH (it, args.begin()+2, args.end()) {
+  FOREACH (it, args.begin() + kernel_arg_index_ + 2, args.end()) {
     SgExpression *a = *it;
     if (GridType::isGridType(a->get_type())) {
       SgVarRefExp *gv = isSgVarRefExp(a);
@@ -45,7 +46,7 @@ StencilMap::StencilMap(SgFunctionCallExp *call, TranslationContext *tx)
 
 SgExpression *StencilMap::getDomFromMapCall(SgFunctionCallExp *call) {
   SgExpressionPtrList &args = call->get_args()->get_expressions();
-  SgExpression *domExp = args[1];
+  SgExpression *domExp = args[getKernelArgIndex(call) + 1];
   LOG_DEBUG() << "dom: " << domExp->unparseToString() << "\n";
   return domExp;
 }
@@ -53,7 +54,7 @@ SgExpression *StencilMap::getDomFromMapCall(SgFunctionCallExp *call) {
 SgFunctionDeclaration *StencilMap::getKernelFromMapCall(
     SgFunctionCallExp *call) {
   SgExpressionPtrList &args = call->get_args()->get_expressions();
-  SgExpression *kernelExp = args.front();
+  SgExpression *kernelExp = args[getKernelArgIndex(call)];
   SgFunctionDeclaration *kernel = rose_util::getFuncDeclFromFuncRef(kernelExp);
   LOG_DEBUG() << "kernel: " << kernel->unparseToString() << "\n";
   return kernel;
@@ -75,6 +76,11 @@ string StencilMap::toString() const {
   return ss.str();
 }
 
+int StencilMap::getKernelArgIndex(SgFunctionCallExp *call) {
+  // PSReduce(&v, op, kernel, dom, ...)
+  return Reduce::IsReduce(call) ? 2 : 0;
+}
+
 bool StencilMap::isMap(SgFunctionCallExp *call) {
   SgFunctionRefExp *f = isSgFunctionRefExp(call->get_function());
   if (!f) return false;
@@ -93,6 +99,15 @@ std::string GridRangeMapToString(GridRangeMap &gr) {
   return "{" + sj.str() + "}";
 }
 
+std::string StencilPerformanceModel::toString() const {
+  StringJoin sj;
+  sj << num_loads << " loads";
+  sj << num_stores << " stores";
+  sj << num_flops << " flops";
+  sj << num_bytes << " bytes";
+  return sj.str() + " per point";
+}
+
 // StencilRange AggregateStencilRange(GridRangeMap &gr,
 //                                    const GridSet *gs) {
 //   PSAssert(gs->size() > 0);
@@ -124,6 +139,20 @@ void StencilMap::SetGridPeriodic(SgInitializedName *gv) {
   grid_periodic_set_.insert(gv);
 }
 
+bool StencilMap::HasReadWriteGrid(TranslationContext *tx) {
+  Kernel *k = tx->findKernel(getKernel());
+  for (unsigned i = 0; i < grid_params_.size(); ++i) {
+    if (!k->isGridParamModified(grid_params_[i])) continue;
+    const GridSet *written = tx->findGrid(grid_args_[i]);
+    for (unsigned j = 0; j < grid_params_.size(); ++j) {
+      if (!k->isGridParamRead(grid_params_[j])) continue;
+      const GridSet *read = tx->findGrid(grid_args_[j]);
+      if (MayAlias(written, read)) return true;
+    }
+  }
+  return false;
+}
+
 
 } // namespace translator
 } // namespace physis
@@ -25,6 +25,26 @@ class TranslationContext;
 typedef map<SgInitializedName*, StencilRange> GridRangeMap;
 
 std::string GridRangeMapToString(GridRangeMap &gr);
+
+//! Static cost of computing a point of a stencil.
+/*!
+  The operations are counted as they appear in the kernel function,
+  so operations in loops or untaken branches are counted once.
+ */
+struct StencilPerformanceModel {
+  //! Number of grid reads
+  int num_loads;
+  //! Number of grid writes
+  int num_stores;
+  //! Number of floating-point arithmetic operations
+  int num_flops;
+  //! Bytes transferred from and to memory, assuming that each
+  //! element of the accessed grids is transferred only once
+  int num_bytes;
+  StencilPerformanceModel():
+      num_loads(0), num_stores(0), num_flops(0), num_bytes(0) {}
+  std::string toString() const;
+};
 // StencilRange AggregateStencilRange(GridRangeMap &gr,
 //                                    const GridSet *gs);
 
@@ -35,6 +55,7 @@ class StencilMap {
   static bool isMap(SgFunctionCallExp *call);
   static SgFunctionDeclaration *getKernelFromMapCall(SgFunctionCallExp *call);
   static SgExpression *getDomFromMapCall(SgFunctionCallExp *call);
+  static int getKernelArgIndex(SgFunctionCallExp *call);
 
   string toString() const;
   SgExpression *getDom() const { return dom; }
@@ -50,6 +71,24 @@ class StencilMap {
   string getRunName() const {
     return "__PSStencil" + dimStr() + "Run_" + kernel->get_name();
   }
+  //! Name of the function reducing the kernel over its domain.
+  /*!
+    Suffixed with the map ID as the reduction operator and thus the
+    generated code may differ at each call site.
+   */
+  string getReduceName() const {
+    return "__PSStencil" + dimStr() + "Reduce_" + kernel->get_name()
+        + "_" + physis::toString(id);
+  }
+  //! Returns true if this map is the kernel of a PSReduce call.
+  bool IsReduction() const { return kernel_arg_index_ > 0; }
+  //! Returns the index of the kernel argument in the call.
+  /*!
+    The kernel is the first argument of PSStencilMap, whereas the
+    reduction variable and operator precede it in PSReduce. The domain
+    and the kernel arguments follow the kernel in both cases.
+   */
+  int GetKernelArgIndex() const { return kernel_arg_index_; }
   SgClassType*& stencil_type() { return stencil_type_; };
   SgClassDefinition *GetStencilTypeDefinition() {
     SgClassDeclaration *decl
@@ -97,6 +136,22 @@ class StencilMap {
     \param gv Grid param name.
   */
   void SetGridPeriodic(SgInitializedName *gv);  
+  //! Returns true if a grid may be both read and written by the map.
+  /*!
+    Unlike Grid::isReadWrite, which holds if the grid is read and
+    written by any map of the program, only the grid arguments of this
+    map are considered, so stencils alternating two grids are not
+    included.
+    \param tx The translation context.
+    \return True if a written grid may alias a read grid.
+   */
+  bool HasReadWriteGrid(TranslationContext *tx);
+  StencilPerformanceModel &performance_model() {
+    return performance_model_;
+  }
+  const StencilPerformanceModel &performance_model() const {
+    return performance_model_;
+  }
 
  protected:
   SgExpression *dom;
@@ -120,7 +175,9 @@ class StencilMap {
   SgInitializedNamePtrList grid_args_;
   SgInitializedNamePtrList grid_params_;  
   SgFunctionCallExp *fc_;
+  int kernel_arg_index_;
   std::set<SgInitializedName*> grid_periodic_set_;
+  StencilPerformanceModel performance_model_;
 
  private:
   // NOTE: originally dimenstion is added to names, but it is probably
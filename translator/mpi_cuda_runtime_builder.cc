@@ -37,16 +37,6 @@ SgFunctionCallExp *BuildGetLocalOffset(SgExpression *dim) {
   return fc;
 }
 
-SgFunctionCallExp *BuildDomainShrink(SgExpression *dom,
-                                     SgExpression *width) {
-  SgFunctionSymbol *fs
-      = si::lookupFunctionSymbolInParentScopes("__PSDomainShrink");
-  SgFunctionCallExp *fc =
-      sb::buildFunctionCallExp(
-          fs, sb::buildExprListExp(dom, width));
-  return fc;
-}
-
 SgExpression *BuildStreamBoundaryKernel(int idx) {
   SgVarRefExp *inner_stream = sb::buildVarRefExp("stream_boundary_kernel");
   return sb::buildPntrArrRefExp(inner_stream, sb::buildIntVal(idx));
@@ -18,8 +18,6 @@ namespace translator {
 SgFunctionCallExp *BuildGridGetDev(SgExpression *grid_var);
 SgFunctionCallExp *BuildGetLocalSize(SgExpression *dim);
 SgFunctionCallExp *BuildGetLocalOffset(SgExpression *dim);
-SgFunctionCallExp *BuildDomainShrink(SgExpression *dom,
-                                     SgExpression *width);
 SgExpression *BuildStreamBoundaryKernel(int idx);
 
 class MPICUDARuntimeBuilder: public MPIRuntimeBuilder {
@@ -46,6 +46,12 @@ MPICUDATranslator::MPICUDATranslator(const Configuration &config)
       boundary_suffix_("_boundary") {  
   grid_create_name_ = "__PSGridNewMPI";
   target_specific_macro_ = "PHYSIS_MPI_CUDA";
+  // Device code has its own grid accessors
+  flag_inline_grid_access_ = false;
+  if (deep_halo_iterations_ > 1) {
+    LOG_WARNING() << "Deep halos are not supported in this target.\n";
+    deep_halo_iterations_ = 0;
+  }
   flag_multistream_boundary_ = false;
   const pu::LuaValue *lv =
       config.Lookup(Configuration::MULTISTREAM_BOUNDARY);
@@ -651,6 +657,11 @@ void MPICUDATranslator::ProcessStencilMap(
   FixGridAddresses(smap, sdecl, function_body);
 }
 
+void MPICUDATranslator::TranslateReduceKernel(Reduce *rd) {
+  LOG_ERROR() << "Kernel reduction is not supported in this target.\n";
+  PSAbort(1);
+}
+
 SgBasicBlock *MPICUDATranslator::BuildRunBody(Run *run) {
   SgBasicBlock *block = sb::buildBasicBlock();
   si::attachComment(block, "Generated by " + string(__FUNCTION__));
@@ -54,6 +54,8 @@ class MPICUDATranslator: public MPITranslator {
                                  SgScopeStatement *loop_body,
                                  SgVariableDeclaration *block_dim);
   virtual SgBasicBlock *BuildRunBody(Run *run); 
+  //! Kernel reductions are not supported yet.
+  virtual void TranslateReduceKernel(Reduce *rd);
   virtual void translateKernelDeclaration(SgFunctionDeclaration *node);
   //! Generates a CUDA function declaration that runs a stencil map. 
   /*!
@@ -68,20 +68,32 @@ SgFunctionCallExp *BuildLoadNeighbor(SgExpression *grid_var,
                                      SgExpression *reuse,
                                      SgExpression *overlap,
                                      bool is_periodic) {
-  SgFunctionSymbol *load_neighbor_func
-      = si::lookupFunctionSymbolInParentScopes("__PSLoadNeighbor");
   IntVector offset_min, offset_max;
   PSAssert(sr.GetNeighborAccess(offset_min, offset_max));
+  bool diag_needed = sr.IsNeighborAccessDiagonalAccessed();
+  return BuildLoadNeighbor(grid_var, offset_min, offset_max, diag_needed,
+                           scope, reuse, overlap, is_periodic);
+}
+
+SgFunctionCallExp *BuildLoadNeighbor(SgExpression *grid_var,
+                                     const IntVector &offset_min,
+                                     const IntVector &offset_max,
+                                     bool diagonal,
+                                     SgScopeStatement *scope,
+                                     SgExpression *reuse,
+                                     SgExpression *overlap,
+                                     bool is_periodic) {
+  SgFunctionSymbol *load_neighbor_func
+      = si::lookupFunctionSymbolInParentScopes("__PSLoadNeighbor");
   SgVariableDeclaration *offset_min_decl =
       rose_util::DeclarePSVectorInt("offset_min", offset_min, scope);
   SgVariableDeclaration *offset_max_decl =
       rose_util::DeclarePSVectorInt("offset_max", offset_max, scope);
-  bool diag_needed = sr.IsNeighborAccessDiagonalAccessed();
   SgExprListExp *load_neighbor_args =
       sb::buildExprListExp(grid_var,
                            sb::buildVarRefExp(offset_min_decl),                           
                            sb::buildVarRefExp(offset_max_decl),
-                           sb::buildIntVal(diag_needed),
+                           sb::buildIntVal(diagonal),
                            reuse, overlap,
                            sb::buildIntVal(is_periodic));
   SgFunctionCallExp *fc = sb::buildFunctionCallExp(load_neighbor_func,
@@ -89,6 +101,75 @@ SgFunctionCallExp *BuildLoadNeighbor(SgExpression *grid_var,
   return fc;
 }
 
+SgFunctionCallExp *BuildLoadNeighborEnd() {
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes("__PSLoadNeighborEnd");
+  SgFunctionCallExp *fc =
+      sb::buildFunctionCallExp(fs, sb::buildExprListExp());
+  return fc;
+}
+
+SgFunctionCallExp *BuildDomainShrink(SgExpression *dom,
+                                     SgExpression *width) {
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes("__PSDomainShrink");
+  SgFunctionCallExp *fc =
+      sb::buildFunctionCallExp(
+          fs, sb::buildExprListExp(dom, width));
+  return fc;
+}
+
+SgFunctionCallExp *BuildDomainExtend(SgExpression *dom,
+                                     SgExpression *width) {
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes("__PSDomainExtend");
+  SgFunctionCallExp *fc =
+      sb::buildFunctionCallExp(
+          fs, sb::buildExprListExp(dom, width));
+  return fc;
+}
+
+SgFunctionCallExp *BuildSetMinHaloPadding(SgExpression *width) {
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes("__PSSetMinHaloPadding");
+  SgFunctionCallExp *fc =
+      sb::buildFunctionCallExp(fs, sb::buildExprListExp(width));
+  return fc;
+}
+
+SgFunctionCallExp *BuildDomainGetShell(SgExpression *dom,
+                                       int dim, bool right,
+                                       SgExpression *width) {
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes("__PSDomainGetShell");
+  SgFunctionCallExp *fc =
+      sb::buildFunctionCallExp(
+          fs, sb::buildExprListExp(dom, sb::buildIntVal(dim),
+                                   sb::buildIntVal(right), width));
+  return fc;
+}
+
+SgFunctionCallExp *BuildReduceAll(SgExpression *buf,
+                                  SgExpression *op,
+                                  SgType *type) {
+  type = type->stripTypedefsAndModifiers();
+  string name;
+  if (isSgTypeFloat(type)) {
+    name = "__PSReduceAllFloat";
+  } else if (isSgTypeDouble(type)) {
+    name = "__PSReduceAllDouble";
+  } else {
+    LOG_ERROR() << "Unsupported reduction type: "
+                << type->unparseToString() << "\n";
+    PSAbort(1);
+  }
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes(name);
+  SgFunctionCallExp *fc =
+      sb::buildFunctionCallExp(fs, sb::buildExprListExp(buf, op));
+  return fc;
+}
+
 SgFunctionCallExp *BuildActivateRemoteGrid(SgExpression *grid_var,
                                            bool active) {
   SgFunctionSymbol *fs
@@ -39,8 +39,35 @@ SgFunctionCallExp *BuildLoadNeighbor(SgExpression *grid_var,
                                      SgExpression *reuse,
                                      SgExpression *overlap,
                                      bool is_periodic);
+//! Build a call loading the neighbor points of given offsets.
+SgFunctionCallExp *BuildLoadNeighbor(SgExpression *grid_var,
+                                     const IntVector &offset_min,
+                                     const IntVector &offset_max,
+                                     bool diagonal,
+                                     SgScopeStatement *scope,
+                                     SgExpression *reuse,
+                                     SgExpression *overlap,
+                                     bool is_periodic);
+SgFunctionCallExp *BuildLoadNeighborEnd();
 SgFunctionCallExp *BuildActivateRemoteGrid(SgExpression *grid_var,
                                            bool active);
+SgFunctionCallExp *BuildDomainShrink(SgExpression *dom,
+                                     SgExpression *width);
+SgFunctionCallExp *BuildDomainExtend(SgExpression *dom,
+                                     SgExpression *width);
+SgFunctionCallExp *BuildSetMinHaloPadding(SgExpression *width);
+SgFunctionCallExp *BuildDomainGetShell(SgExpression *dom,
+                                       int dim, bool right,
+                                       SgExpression *width);
+//! Build a call combining a reduction value of all processes.
+/*!
+  \param buf A pointer to the value.
+  \param op The reduction operator.
+  \param type The type of the value.
+ */
+SgFunctionCallExp *BuildReduceAll(SgExpression *buf,
+                                  SgExpression *op,
+                                  SgType *type);
 
                                    
 
@@ -8,6 +8,8 @@
 
 #include "translator/mpi_translator.h"
 
+#include <algorithm>
+
 #include "translator/translation_context.h"
 #include "translator/translation_util.h"
 #include "translator/mpi_runtime_builder.h"
@@ -21,13 +23,15 @@ namespace translator {
 
 MPITranslator::MPITranslator(const Configuration &config):
     ReferenceTranslator(config), mpi_rt_builder_(NULL),
-    flag_mpi_overlap_(false) {
+    flag_mpi_overlap_(false), deep_halo_iterations_(0),
+    deep_halo_padding_(0), flag_inline_grid_access_(true) {
   grid_type_name_ = "__PSGridMPI";
   grid_create_name_ = "__PSGridNewMPI";
   target_specific_macro_ = "PHYSIS_MPI";
   get_addr_name_ = "__PSGridGetAddr";
   get_addr_no_halo_name_ = "__PSGridGetAddrNoHalo";
   emit_addr_name_ = "__PSGridEmitAddr";
+  inline_suffix_ = "Inline";
   
   const pu::LuaValue *lv
       = config.Lookup(Configuration::MPI_OVERLAP);
@@ -37,6 +41,16 @@ MPITranslator::MPITranslator(const Configuration &config):
   if (flag_mpi_overlap_) {
     LOG_INFO() << "Overlapping enabled\n";
   }
+  lv = config.Lookup(Configuration::MPI_DEEP_HALO);
+  if (lv) {
+    double v;
+    PSAssert(lv->get(v));
+    deep_halo_iterations_ = (int)v;
+  }
+  if (deep_halo_iterations_ > 1) {
+    LOG_INFO() << "Deep halos exchanged every " << deep_halo_iterations_
+               << " iterations\n";
+  }
   
   validate_ast_ = true;
 }
@@ -110,19 +124,23 @@ void MPITranslator::Translate() {
   // Insert prototypes of stencil run functions
   FOREACH (it, tx_->run_map().begin(), tx_->run_map().end()) {
     Run *r = it->second;
-    SgFunctionParameterTypeList *client_func_params
-        = sb::buildFunctionParameterTypeList
-        (sb::buildIntType(),
-         sb::buildPointerType(sb::buildPointerType(sb::buildVoidType())));
-    SgFunctionDeclaration *prototype =
-      sb::buildNondefiningFunctionDeclaration(
-          r->GetName(),
-          sb::buildVoidType(),
-          sb::buildFunctionParameterList(client_func_params), global_scope_);
-    rose_util::SetFunctionStatic(prototype);
-    si::insertStatementBefore(
-        si::findFirstDefiningFunctionDecl(global_scope_),
-        prototype);
+    InsertClientPrototype(r->GetName());
+  }
+  // Kernel reductions are also run by the clients; their handlers
+  // are registered after the stencil runs.
+  SgNodePtrList calls =
+      NodeQuery::querySubTree(project_, V_SgFunctionCallExp);
+  FOREACH (it, calls.begin(), calls.end()) {
+    SgFunctionCallExp *call = isSgFunctionCallExp(*it);
+    Reduce *rd = rose_util::GetASTAttribute<Reduce>(call);
+    if (!(rd && rd->IsKernel())) continue;
+    kernel_reduces_.push_back(call);
+    InsertClientPrototype(GetReduceClientName(call));
+  }
+  // Grids are padded for the widest deep halo
+  FOREACH (it, tx_->run_map().begin(), tx_->run_map().end()) {
+    deep_halo_padding_ = std::max(deep_halo_padding_,
+                                  GetDeepHaloWidth(it->second));
   }
   
   ReferenceTranslator::Translate();
@@ -130,11 +148,39 @@ void MPITranslator::Translate() {
   mpi_rt_builder_ = NULL;
 }
 
+void MPITranslator::InsertClientPrototype(const string &name) {
+  SgFunctionParameterTypeList *client_func_params
+      = sb::buildFunctionParameterTypeList
+      (sb::buildIntType(),
+       sb::buildPointerType(sb::buildPointerType(sb::buildVoidType())));
+  SgFunctionDeclaration *prototype =
+      sb::buildNondefiningFunctionDeclaration(
+          name,
+          sb::buildVoidType(),
+          sb::buildFunctionParameterList(client_func_params), global_scope_);
+  rose_util::SetFunctionStatic(prototype);
+  si::insertStatementBefore(
+      si::findFirstDefiningFunctionDecl(global_scope_),
+      prototype);
+}
+
+int MPITranslator::GetReduceClientID(SgFunctionCallExp *call) const {
+  SgFunctionCallExpPtrList::const_iterator it =
+      std::find(kernel_reduces_.begin(), kernel_reduces_.end(), call);
+  PSAssert(it != kernel_reduces_.end());
+  return tx_->run_map().size() + (it - kernel_reduces_.begin());
+}
+
+string MPITranslator::GetReduceClientName(SgFunctionCallExp *call) const {
+  return "__" + string(REDUCE_NAME) + "_" +
+      toString(GetReduceClientID(call));
+}
+
 void MPITranslator::translateInit(SgFunctionCallExp *node) {
   LOG_DEBUG() << "Translating Init call\n";
 
-  // Append the number of run calls
-  int num_runs = tx_->run_map().size();
+  // Append the number of run calls, including kernel reductions
+  int num_runs = tx_->run_map().size() + kernel_reduces_.size();
   si::appendExpression(node->get_args(),
                        sb::buildIntVal(num_runs));
 
@@ -153,6 +199,11 @@ void MPITranslator::translateInit(SgFunctionCallExp *node) {
                                                      client_func_type);
     client_func_exprs[run->id()] = fref;
   }
+  FOREACH (it, kernel_reduces_.begin(), kernel_reduces_.end()) {
+    SgFunctionRefExp *fref = sb::buildFunctionRefExp(
+        GetReduceClientName(*it), client_func_type);
+    client_func_exprs[GetReduceClientID(*it)] = fref;
+  }
   SgInitializer *ai = NULL;
   if (client_func_exprs.size()) {
     ai = sb::buildAggregateInitializer(
@@ -171,6 +222,11 @@ void MPITranslator::translateInit(SgFunctionCallExp *node) {
   si::appendStatement(clients, tmp_block);
   si::appendExpression(node->get_args(),
                        sb::buildVarRefExp(clients));
+  if (deep_halo_padding_ > 0) {
+    rose_util::AppendExprStatement(
+        tmp_block,
+        BuildSetMinHaloPadding(sb::buildIntVal(deep_halo_padding_)));
+  }
 
   si::appendStatement(
       si::copyStatement(getContainingStatement(node)),
@@ -226,6 +282,126 @@ void MPITranslator::translateRun(SgFunctionCallExp *node,
   si::replaceStatement(getContainingStatement(node), tmp_block);
 }
 
+// Generates code like this:
+// static void __PSReduce_1(int iter, void **stencils) {
+//   struct stencil *s0 = stencils[0];
+//   float *v = stencils[1];
+//   s0->g = __PSGetGridByID(s0->__g_index);
+//   __PSLoadNeighbor(s0->g, ...);
+//   *v = __PSStencilReduce_kernel_0(s0);
+//   __PSReduceAllFloat(v, PS_SUM);
+// }
+SgFunctionDeclaration *MPITranslator::GenerateReduceClient(
+    Reduce *rd, SgFunctionDeclaration *reduce_func) {
+  SgFunctionCallExp *rdcall = rd->reduce_call();
+  StencilMap *smap = tx_->findMap(rdcall);
+  SgExpressionPtrList &args = rdcall->get_args()->get_expressions();
+  SgType *v_type = isSgPointerType(args[0]->get_type())->get_base_type();
+
+  SgFunctionParameterList *parlist = sb::buildFunctionParameterList();
+  si::appendArg(parlist,
+                sb::buildInitializedName("iter",
+                                         sb::buildIntType()));
+  si::appendArg(parlist,
+                sb::buildInitializedName(
+                    "stencils", sb::buildPointerType(
+                        sb::buildPointerType(sb::buildVoidType()))));
+  SgFunctionDeclaration *client_func =
+      sb::buildDefiningFunctionDeclaration(GetReduceClientName(rdcall),
+                                           sb::buildVoidType(),
+                                           parlist, global_scope_);
+  rose_util::SetFunctionStatic(client_func);
+  si::attachComment(client_func, "Generated by " + string(__FUNCTION__));
+
+  SgBasicBlock *block = sb::buildBasicBlock();
+  SgVarRefExp *stencils = sb::buildVarRefExp("stencils", block);
+  SgType *stencil_ptr_type = sb::buildPointerType(smap->stencil_type());
+  SgVariableDeclaration *sdecl =
+      rose_util::buildVarDecl(
+          "s0", stencil_ptr_type,
+          sb::buildPntrArrRefExp(stencils, sb::buildIntVal(0)), block);
+  SgVariableDeclaration *vdecl =
+      rose_util::buildVarDecl(
+          "v", sb::buildPointerType(v_type),
+          sb::buildPntrArrRefExp(si::copyExpression(stencils),
+                                 sb::buildIntVal(1)), block);
+  // Referenced by the reuse flags of neighbor loading; the halos are
+  // always loaded as there is no enclosing iteration.
+  rose_util::buildVarDecl("i", sb::buildIntType(), sb::buildIntVal(0),
+                          block);
+  FixGridAddresses(smap, sdecl, block);
+
+  SgInitializedNamePtrList remote_grids;
+  SgStatementPtrList load_statements;
+  bool overlap_eligible;
+  int overlap_width;
+  GenerateLoadRemoteGridRegion(smap, sdecl, NULL, block,
+                               remote_grids, load_statements,
+                               overlap_eligible, overlap_width);
+  FOREACH (sit, load_statements.begin(), load_statements.end()) {
+    si::appendStatement(*sit, block);
+  }
+  si::appendStatement(
+      sb::buildAssignStatement(
+          sb::buildPointerDerefExp(sb::buildVarRefExp(vdecl)),
+          sb::buildFunctionCallExp(
+              rose_util::getFunctionSymbol(reduce_func),
+              sb::buildExprListExp(sb::buildVarRefExp(sdecl)))),
+      block);
+  // Combine the partials of all processes
+  rose_util::AppendExprStatement(
+      block, BuildReduceAll(sb::buildVarRefExp(vdecl),
+                            si::copyExpression(args[1]), v_type));
+  DeactivateRemoteGrids(smap, sdecl, block, remote_grids);
+
+  rose_util::ReplaceFuncBody(client_func, block);
+  return client_func;
+}
+
+void MPITranslator::TranslateReduceKernel(Reduce *rd) {
+  SgFunctionCallExp *original_rdcall = rd->reduce_call();
+  StencilMap *s = tx_->findMap(original_rdcall);
+  PSAssert(s);
+  SgFunctionDeclaration *caller = getContainingFunction(original_rdcall);
+  SgFunctionDeclaration *reduce_func = BuildReduceKernel(rd);
+  si::insertStatementBefore(caller, reduce_func);
+  si::insertStatementBefore(caller, GenerateReduceClient(rd, reduce_func));
+
+  // The reduction is run by all processes just like stencil runs. The
+  // result variable is passed as the second stencil object, so the
+  // result is written to it at the root process.
+  // {
+  //   __PSStencil_kernel s0 = __PSStencilMap_kernel(dom, g);
+  //   __PSStencilRun(1, 1, 2, sizeof(s0), &s0, sizeof(*(&v)), &v);
+  // }
+  SgBasicBlock *tmp_block = sb::buildBasicBlock();
+  SgExpressionPtrList &args = original_rdcall->get_args()->get_expressions();
+  SgExprListExp *map_args = sb::buildExprListExp();
+  FOREACH (it, args.begin() + s->GetKernelArgIndex() + 1, args.end()) {
+    si::appendExpression(map_args, si::copyExpression(*it));
+  }
+  SgVariableDeclaration *sdecl =
+      rose_util::buildVarDecl(
+          "s0", s->stencil_type(),
+          sb::buildFunctionCallExp(rose_util::getFunctionSymbol(s->getFunc()),
+                                   map_args),
+          tmp_block);
+  SgExprListExp *run_args = sb::buildExprListExp(
+      sb::buildIntVal(GetReduceClientID(original_rdcall)),
+      sb::buildIntVal(1), sb::buildIntVal(2));
+  si::appendExpression(run_args, sb::buildSizeOfOp(s->stencil_type()));
+  si::appendExpression(run_args,
+                       sb::buildAddressOfOp(sb::buildVarRefExp(sdecl)));
+  si::appendExpression(run_args, sb::buildSizeOfOp(
+      sb::buildPointerDerefExp(si::copyExpression(args[0]))));
+  si::appendExpression(run_args, si::copyExpression(args[0]));
+  rose_util::AppendExprStatement(
+      tmp_block,
+      sb::buildFunctionCallExp(sb::buildFunctionRefExp(stencil_run_func_),
+                               run_args));
+  si::replaceStatement(getContainingStatement(original_rdcall), tmp_block);
+}
+
 void MPITranslator::GenerateLoadRemoteGridRegion(
     StencilMap *smap,
     SgVariableDeclaration *stencil_decl,
@@ -400,15 +576,34 @@ void MPITranslator::ProcessStencilMap(StencilMap *smap,
   GenerateLoadRemoteGridRegion(smap, sdecl, run, loop_body,
                                remote_grids, load_statements,
                                overlap_eligible, overlap_width);
-  FOREACH (sit, load_statements.begin(), load_statements.end()) {
-    si::appendStatement(*sit, loop_body);
-  }
+  bool overlap_enabled = flag_mpi_overlap_ && overlap_eligible &&
+      overlap_width > 0;
+  if (overlap_enabled) {
+    LOG_INFO() << "Generating overlapping code\n";
+    // Start loading the neighbors, and run the interior while the
+    // halos are in flight. 
+    SgFunctionSymbol *load_neighbor_begin =
+        si::lookupFunctionSymbolInParentScopes("__PSLoadNeighborBegin",
+                                               global_scope_);
+    PSAssert(load_neighbor_begin);
+    FOREACH (sit, load_statements.begin(), load_statements.end()) {
+      rose_util::RedirectFunctionCalls(
+          *sit, "__PSLoadNeighbor",
+          load_neighbor_begin->get_declaration());
+      si::appendStatement(*sit, loop_body);
+    }
+    BuildOverlappedRun(smap, sdecl, fs, overlap_width, loop_body);
+  } else {
+    FOREACH (sit, load_statements.begin(), load_statements.end()) {
+      si::appendStatement(*sit, loop_body);
+    }
     
-  // Call the stencil kernel
-  SgExprListExp *args = sb::buildExprListExp(
-      sb::buildVarRefExp(sdecl));
-  SgFunctionCallExp *c = sb::buildFunctionCallExp(fs, args);
-  si::appendStatement(sb::buildExprStatement(c), loop_body);
+    // Call the stencil kernel
+    SgExprListExp *args = sb::buildExprListExp(
+        sb::buildVarRefExp(sdecl));
+    SgFunctionCallExp *c = sb::buildFunctionCallExp(fs, args);
+    si::appendStatement(sb::buildExprStatement(c), loop_body);
+  }
   appendGridSwap(smap, stencil_name, true, loop_body);
   DeactivateRemoteGrids(smap, sdecl, loop_body,
                         remote_grids);
@@ -416,7 +611,72 @@ void MPITranslator::ProcessStencilMap(StencilMap *smap,
   FixGridAddresses(smap, sdecl, function_body);
 }
 
+// Generates code like this:
+// {
+//   struct stencil s0_sub = *s0;
+//   s0_sub.dom = __PSDomainShrink(&s0->dom, width);
+//   run_kernel(&s0_sub);
+//   __PSLoadNeighborEnd();
+//   s0_sub.dom = __PSDomainGetShell(&s0->dom, 0, 0, width);
+//   run_kernel(&s0_sub);
+//   s0_sub.dom = __PSDomainGetShell(&s0->dom, 0, 1, width);
+//   run_kernel(&s0_sub);
+//   ...
+// }
+void MPITranslator::BuildOverlappedRun(StencilMap *smap,
+                                       SgVariableDeclaration *stencil_decl,
+                                       SgFunctionSymbol *run_kernel,
+                                       int width,
+                                       SgScopeStatement *scope) {
+  SgBasicBlock *block = sb::buildBasicBlock();
+  si::appendStatement(block, scope);
+  SgVariableDeclaration *sub_decl =
+      sb::buildVariableDeclaration(
+          stencil_decl->get_variables()[0]->get_name() + "_sub",
+          smap->stencil_type(),
+          sb::buildAssignInitializer(
+              sb::buildPointerDerefExp(sb::buildVarRefExp(stencil_decl)),
+              smap->stencil_type()),
+          block);
+  si::appendStatement(sub_decl, block);
+  SgExpression *sub_dom = BuildStencilDomRef(sb::buildVarRefExp(sub_decl));
+  SgExpression *dom_ptr = sb::buildAddressOfOp(
+      BuildStencilDomRef(sb::buildVarRefExp(stencil_decl)));
+
+  // Interior
+  si::appendStatement(
+      sb::buildAssignStatement(
+          sub_dom, BuildDomainShrink(dom_ptr, sb::buildIntVal(width))),
+      block);
+  rose_util::AppendExprStatement(
+      block, sb::buildFunctionCallExp(
+          run_kernel, sb::buildExprListExp(
+              sb::buildAddressOfOp(sb::buildVarRefExp(sub_decl)))));
+
+  rose_util::AppendExprStatement(block, BuildLoadNeighborEnd());
+
+  // Boundary shell
+  for (int i = 0; i < smap->getNumDim(); ++i) {
+    for (int j = 0; j < 2; ++j) {
+      si::appendStatement(
+          sb::buildAssignStatement(
+              si::copyExpression(sub_dom),
+              BuildDomainGetShell(si::copyExpression(dom_ptr), i, j,
+                                  sb::buildIntVal(width))),
+          block);
+      rose_util::AppendExprStatement(
+          block, sb::buildFunctionCallExp(
+              run_kernel, sb::buildExprListExp(
+                  sb::buildAddressOfOp(sb::buildVarRefExp(sub_decl)))));
+    }
+  }
+}
+
 SgBasicBlock *MPITranslator::BuildRunBody(Run *run) {
+  int deep_halo_width = GetDeepHaloWidth(run);
+  if (deep_halo_width > 0) {
+    return BuildDeepHaloRunBody(run, deep_halo_width);
+  }
   SgBasicBlock *block = sb::buildBasicBlock();
   si::attachComment(block, "Generated by BuildRunBody");
 
@@ -450,6 +710,161 @@ SgBasicBlock *MPITranslator::BuildRunBody(Run *run) {
   return block;
 }
 
+int MPITranslator::GetDeepHaloWidth(Run *run) {
+  if (deep_halo_iterations_ < 2) return 0;
+  int radius = 0;
+  FOREACH (it, run->stencils().begin(), run->stencils().end()) {
+    StencilMap *smap = it->second;
+    Kernel *kernel = tx_->findKernel(smap->getKernel());
+    FOREACH (pit, smap->grid_params().begin(), smap->grid_params().end()) {
+      SgInitializedName *gv = *pit;
+      if (!kernel->isGridParamRead(gv)) continue;
+      if (!isContained<SgInitializedName*, StencilRange>(
+              smap->grid_stencil_range_map(), gv)) {
+        return 0;
+      }
+      StencilRange &sr = smap->GetStencilRange(gv);
+      if (!sr.IsNeighborAccess() || sr.num_dims() != smap->getNumDim() ||
+          smap->IsGridPeriodic(gv)) {
+        LOG_INFO() << "Deep halos not used for " << run->GetName()
+                   << " due to non-neighbor or periodic access\n";
+        return 0;
+      }
+      radius = std::max(radius, sr.GetMaxWidth());
+    }
+  }
+  // Each stencil of an iteration consumes the radius from the halo
+  return deep_halo_iterations_ * (int)run->stencils().size() * radius;
+}
+
+// Generates code like this for k = deep_halo_iterations_:
+// {
+//   struct stencil *s0 = stencils[0];
+//   ...
+//   for (i = 0; i < iter; ++i) {
+//     if (i % k == 0) {
+//       __PSLoadNeighbor(s0->g, {-w, ...}, {w, ...}, 1, ...);
+//     }
+//     {
+//       struct stencil s0_ext = *s0;
+//       s0_ext.dom = __PSDomainExtend(&s0->dom,
+//                                     ((k-1-i%k)*N+N-1-0)*r);
+//       run_kernel(&s0_ext);
+//     }
+//     ...
+//   }
+// }
+SgBasicBlock *MPITranslator::BuildDeepHaloRunBody(Run *run, int width) {
+  SgBasicBlock *block = sb::buildBasicBlock();
+  si::attachComment(block, "Generated by " + string(__FUNCTION__));
+  SgVarRefExp *stencils = sb::buildVarRefExp("stencils", block);
+  int num_stencils = run->stencils().size();
+  int radius = width / (deep_halo_iterations_ * num_stencils);
+  LOG_INFO() << "Deep halos of width " << width << " used for "
+             << run->GetName() << "\n";
+
+  SgVariableDeclaration *lv
+      = sb::buildVariableDeclaration("i", sb::buildIntType(), NULL, block);
+  si::appendStatement(lv, block);
+  SgBasicBlock *loop_body = sb::buildBasicBlock();
+  SgBasicBlock *load_block = sb::buildBasicBlock();
+  // i % k
+  SgExpression *block_step = sb::buildModOp(
+      sb::buildVarRefExp(lv), sb::buildIntVal(deep_halo_iterations_));
+  vector<const GridSet*> loaded_grids;
+  ENUMERATE(i, it, run->stencils().begin(), run->stencils().end()) {
+    StencilMap *smap = it->second;
+    string stencil_name = "s" + toString(i);
+    SgType *stencil_ptr_type = sb::buildPointerType(smap->stencil_type());
+    SgVariableDeclaration *sdecl = rose_util::buildVarDecl(
+        stencil_name, stencil_ptr_type,
+        sb::buildPntrArrRefExp(si::copyExpression(stencils),
+                               sb::buildIntVal(i)), block);
+    FixGridAddresses(smap, sdecl, block);
+
+    // Load all grids read in the run at the beginning of every k
+    // iterations. Points outside the stencil domains are also read
+    // from the halos.
+    Kernel *kernel = tx_->findKernel(smap->getKernel());
+    ENUMERATE(j, pit, smap->grid_params().begin(),
+              smap->grid_params().end()) {
+      SgInitializedName *gv = *pit;
+      if (!kernel->isGridParamRead(gv)) continue;
+      if (smap->GetStencilRange(gv).IsZero()) continue;
+      const GridSet *gs = tx_->findGrid(smap->grid_args()[j]);
+      bool loaded = false;
+      if (gs && gs->size() == 1) {
+        FOREACH (lit, loaded_grids.begin(), loaded_grids.end()) {
+          if (**lit == *gs) loaded = true;
+        }
+        loaded_grids.push_back(gs);
+      }
+      if (loaded) continue;
+      SgExpression *reuse = kernel->isGridParamWritten(gv) ?
+          (SgExpression*)sb::buildIntVal(0) :
+          (SgExpression*)sb::buildGreaterThanOp(sb::buildVarRefExp(lv),
+                                                sb::buildIntVal(0));
+      IntVector offset_min(smap->getNumDim(), -width);
+      IntVector offset_max(smap->getNumDim(), width);
+      SgBasicBlock *bb = sb::buildBasicBlock();
+      rose_util::AppendExprStatement(
+          bb, BuildLoadNeighbor(
+              BuildStencilFieldRef(sb::buildVarRefExp(sdecl),
+                                   gv->get_name()),
+              offset_min, offset_max, true, bb, reuse,
+              sb::buildIntVal(0), false));
+      si::appendStatement(bb, load_block);
+    }
+
+    // Run the stencil on the domain extended by the radius times the
+    // number of the remaining stencils until the next exchange
+    SgBasicBlock *run_block = sb::buildBasicBlock();
+    SgVariableDeclaration *ext_decl = rose_util::buildVarDecl(
+        stencil_name + "_ext", smap->stencil_type(),
+        sb::buildPointerDerefExp(sb::buildVarRefExp(sdecl)), run_block);
+    SgExpression *ext_width = sb::buildMultiplyOp(
+        sb::buildAddOp(
+            sb::buildMultiplyOp(
+                sb::buildSubtractOp(
+                    sb::buildIntVal(deep_halo_iterations_ - 1),
+                    si::copyExpression(block_step)),
+                sb::buildIntVal(num_stencils)),
+            sb::buildIntVal(num_stencils - 1 - i)),
+        sb::buildIntVal(radius));
+    si::appendStatement(
+        sb::buildAssignStatement(
+            BuildStencilDomRef(sb::buildVarRefExp(ext_decl)),
+            BuildDomainExtend(
+                sb::buildAddressOfOp(
+                    BuildStencilDomRef(sb::buildVarRefExp(sdecl))),
+                ext_width)),
+        run_block);
+    rose_util::AppendExprStatement(
+        run_block, sb::buildFunctionCallExp(
+            rose_util::getFunctionSymbol(smap->run()),
+            sb::buildExprListExp(
+                sb::buildAddressOfOp(sb::buildVarRefExp(ext_decl)))));
+    si::appendStatement(run_block, loop_body);
+    appendGridSwap(smap, stencil_name, true, loop_body);
+  }
+  si::prependStatement(
+      sb::buildIfStmt(sb::buildEqualityOp(block_step, sb::buildIntVal(0)),
+                      load_block, NULL),
+      loop_body);
+
+  SgForStatement *loop =
+      sb::buildForStatement(
+          sb::buildAssignStatement(sb::buildVarRefExp(lv),
+                                   sb::buildIntVal(0)),
+          sb::buildExprStatement(
+              sb::buildLessThanOp(sb::buildVarRefExp(lv),
+                                  sb::buildVarRefExp("iter", block))),
+          sb::buildPlusPlusOp(sb::buildVarRefExp(lv)),
+          loop_body);
+  TraceStencilRun(run, loop, block);
+  return block;
+}
+
 SgFunctionDeclaration *MPITranslator::GenerateRun(Run *run) {
   // setup the parameter list
   SgFunctionParameterList *parlist = sb::buildFunctionParameterList();
@@ -538,14 +953,30 @@ bool MPITranslator::translateGetKernel(SgFunctionCallExp *node,
   const StencilIndexList *sil = tx_->findStencilIndex(node);
   PSAssert(sil);
   LOG_DEBUG() << "Stencil index: " << *sil;
-  if (StencilIndexSelf(*sil, nd)) {
+  bool no_halo = StencilIndexSelf(*sil, nd);
+  if (flag_inline_grid_access_) {
+    get_address_name = get_addr_name_ + inline_suffix_ +
+        GetTypeDimName(gt);
+    get_address_no_halo_name = get_addr_no_halo_name_ + inline_suffix_ +
+        GetTypeDimName(gt);
+  }
+  if (no_halo) {
     get_address = sb::buildFunctionRefExp(get_address_no_halo_name,
                                           global_scope_);
   } else {
     get_address = sb::buildFunctionRefExp(get_address_name,
                                           global_scope_);
   }
-  SgExprListExp *args = sb::buildExprListExp(g);
+  SgExprListExp *args = NULL;
+  if (flag_inline_grid_access_) {
+    // The no-halo version does not need the grid itself
+    SgExpression *desc = sb::buildVarRefExp(
+        GetGridDescName(gv->get_name().getString()), scope);
+    args = no_halo ? sb::buildExprListExp(desc) :
+        sb::buildExprListExp(g, desc);
+  } else {
+    args = sb::buildExprListExp(g);
+  }
   FOREACH (it, node->get_args()->get_expressions().begin(),
            node->get_args()->get_expressions().end()) {
     si::appendExpression(args, si::copyExpression(*it));
@@ -577,9 +1008,18 @@ void MPITranslator::translateEmit(SgFunctionCallExp *node,
   SgVarRefExp *g = sb::buildVarRefExp(gv->get_name(), scope);
 
   string get_address_name = emit_addr_name_ +  GetTypeDimName(gt);  
+  SgExprListExp *args = NULL;
+  if (flag_inline_grid_access_) {
+    get_address_name = emit_addr_name_ + inline_suffix_ +
+        GetTypeDimName(gt);
+    args = sb::buildExprListExp(
+        sb::buildVarRefExp(GetGridDescName(gv->get_name().getString()),
+                           scope));
+  } else {
+    args = sb::buildExprListExp(g);
+  }
   SgFunctionRefExp *get_address = sb::buildFunctionRefExp(get_address_name,
                                                           global_scope_);
-  SgExprListExp *args = sb::buildExprListExp(g);
   SgInitializedNamePtrList &params = getContainingFunction(node)->get_args();
   FOREACH(it, params.begin(), params.begin() + nd) {
     SgInitializedName *p = *it;
@@ -601,6 +1041,119 @@ void MPITranslator::translateEmit(SgFunctionCallExp *node,
   si::replaceExpression(node, emit);
 }
 
+string MPITranslator::GetGridDescName(const string &grid_name) const {
+  return "__ps_desc_" + grid_name;
+}
+
+void MPITranslator::translateKernelDeclaration(
+    SgFunctionDeclaration *node) {
+  ReferenceTranslator::translateKernelDeclaration(node);
+  if (!flag_inline_grid_access_) return;
+  // const __PSGridMPIDesc *__ps_desc_g is appended for each grid
+  // parameter g, in the order of the grid parameters.
+  SgType *desc_type =
+      si::lookupNamedTypeInParentScopes("__PSGridMPIDesc", global_scope_);
+  PSAssert(desc_type);
+  SgFunctionParameterList *params = node->get_parameterList();
+  SgInitializedNamePtrList grid_params;
+  FOREACH (it, params->get_args().begin(), params->get_args().end()) {
+    if (GridType::isGridType((*it)->get_type())) grid_params.push_back(*it);
+  }
+  FOREACH (it, grid_params.begin(), grid_params.end()) {
+    si::appendArg(
+        params,
+        sb::buildInitializedName(
+            GetGridDescName((*it)->get_name().getString()),
+            sb::buildPointerType(sb::buildConstType(desc_type))));
+  }
+}
+
+//! Returns the grid members of a stencil struct in the order of the
+//! grid parameters of its kernel.
+static vector<SgVariableDeclaration*> GetStencilGridMembers(StencilMap *s) {
+  vector<SgVariableDeclaration*> grids;
+  SgDeclarationStatementPtrList &members =
+      s->GetStencilTypeDefinition()->get_members();
+  // The first member is the domain
+  FOREACH (it, ++(members.begin()), members.end()) {
+    SgVariableDeclaration *d = isSgVariableDeclaration(*it);
+    PSAssert(d);
+    if (!GridType::isGridType(d->get_variables()[0]->get_type())) continue;
+    grids.push_back(d);
+    // skip the grid id
+    ++it;
+  }
+  return grids;
+}
+
+void MPITranslator::PrependGridDescs(StencilMap *s,
+                                     SgInitializedName *stencil_param,
+                                     SgBasicBlock *block) {
+  // const __PSGridMPIDesc __ps_desc_g = __PSGridGetDesc(s->g);
+  SgType *desc_type =
+      si::lookupNamedTypeInParentScopes("__PSGridMPIDesc", global_scope_);
+  PSAssert(desc_type);
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes("__PSGridGetDesc",
+                                               global_scope_);
+  PSAssert(fs);
+  vector<SgVariableDeclaration*> grids = GetStencilGridMembers(s);
+  // Prepend in the reverse order to keep the order of the members
+  FOREACH (it, grids.rbegin(), grids.rend()) {
+    SgExpression *grid = sb::buildArrowExp(sb::buildVarRefExp(stencil_param),
+                                           sb::buildVarRefExp(*it));
+    SgFunctionCallExp *get_desc = sb::buildFunctionCallExp(
+        fs, sb::buildExprListExp(grid));
+    SgVariableDeclaration *desc = sb::buildVariableDeclaration(
+        GetGridDescName(
+            (*it)->get_variables()[0]->get_name().getString()),
+        sb::buildConstType(desc_type),
+        sb::buildAssignInitializer(get_desc), block);
+    si::prependStatement(desc, block);
+  }
+}
+
+SgFunctionCallExp *MPITranslator::BuildKernelCall(
+    StencilMap *s, SgExpressionPtrList &indexArgs,
+    SgInitializedName *stencil_param) {
+  SgFunctionCallExp *c =
+      ReferenceTranslator::BuildKernelCall(s, indexArgs, stencil_param);
+  if (!flag_inline_grid_access_) return c;
+  // The descriptors are declared by PrependGridDescs in the enclosing
+  // function.
+  vector<SgVariableDeclaration*> grids = GetStencilGridMembers(s);
+  FOREACH (it, grids.begin(), grids.end()) {
+    si::appendExpression(
+        c->get_args(),
+        sb::buildAddressOfOp(sb::buildVarRefExp(
+            GetGridDescName(
+                (*it)->get_variables()[0]->get_name().getString()))));
+  }
+  return c;
+}
+
+SgBasicBlock *MPITranslator::BuildRunKernelBody(
+    StencilMap *s, SgInitializedName *stencil_param) {
+  SgBasicBlock *block =
+      ReferenceTranslator::BuildRunKernelBody(s, stencil_param);
+  if (flag_inline_grid_access_) {
+    PrependGridDescs(s, stencil_param, block);
+  }
+  return block;
+}
+
+SgFunctionDeclaration *MPITranslator::BuildReduceKernel(Reduce *rd) {
+  SgFunctionDeclaration *reduce_func =
+      ReferenceTranslator::BuildReduceKernel(rd);
+  if (flag_inline_grid_access_) {
+    StencilMap *s = tx_->findMap(rd->reduce_call());
+    PSAssert(s);
+    PrependGridDescs(s, reduce_func->get_args().front(),
+                     reduce_func->get_definition()->get_body());
+  }
+  return reduce_func;
+}
+
 void MPITranslator::FixAST() {
   if (validate_ast_) {
     si::fixVariableReferences(project_);
@@ -25,11 +25,52 @@ class MPITranslator: public ReferenceTranslator {
  protected:
   MPIRuntimeBuilder *mpi_rt_builder_;
   bool flag_mpi_overlap_;
+  //! Number of iterations between deep halo exchanges; disabled if
+  //! less than 2.
+  int deep_halo_iterations_;
+  //! Halo padding needed by the runs with deep halos.
+  int deep_halo_padding_;
+  //! Emits inline accesses for local grid points if true.
+  bool flag_inline_grid_access_;
   virtual void translateInit(SgFunctionCallExp *node);
   virtual void translateRun(SgFunctionCallExp *node,
                             Run *run);
   virtual SgBasicBlock *BuildRunBody(Run *run);
+  //! Returns the width of the deep halos of a run.
+  /*!
+    \param run The stencil run.
+    \return The halo width, or 0 if deep halos cannot be used.
+   */
+  virtual int GetDeepHaloWidth(Run *run);
+  //! Build the body of a run function with deep halos.
+  /*!
+    The halos of the given width are exchanged once every
+    deep_halo_iterations_ iterations. In between, the stencils are
+    redundantly computed on the part of the halos that is read by
+    the following stencils.
+    \param run The stencil run.
+    \param width The width of the deep halos.
+    \return The body of the run function.
+   */
+  virtual SgBasicBlock *BuildDeepHaloRunBody(Run *run, int width);
   virtual SgFunctionDeclaration *GenerateRun(Run *run);
+  virtual void TranslateReduceKernel(Reduce *rd);
+  //! Build a client handler running a kernel reduction.
+  /*!
+    The handler reduces the local domain of each process, and then
+    combines the partial results of all processes.
+    \param rd A reduction of kernel.
+    \param reduce_func The function reducing the local domain.
+    \return A function declaration of the handler.
+   */
+  virtual SgFunctionDeclaration *GenerateReduceClient(
+      Reduce *rd, SgFunctionDeclaration *reduce_func);
+  //! Inserts a prototype of a client handler function.
+  virtual void InsertClientPrototype(const string &name);
+  //! Returns the client handler ID of a kernel reduction.
+  int GetReduceClientID(SgFunctionCallExp *call) const;
+  //! Returns the client handler name of a kernel reduction.
+  string GetReduceClientName(SgFunctionCallExp *call) const;
   virtual SgExprListExp *generateNewArg(GridType *gt, Grid *g,
                                         SgVariableDeclaration *dim_decl);
   virtual void appendNewArgExtra(SgExprListExp *args, Grid *g);
@@ -51,6 +92,22 @@ class MPITranslator: public ReferenceTranslator {
                                  int stencil_index, Run *run,
                                  SgScopeStatement *function_body,
                                  SgScopeStatement *loop_body);
+  //! Build a run of a stencil overlapped with neighbor loading.
+  /*!
+    The interior of the domain is computed while the halos are
+    exchanged, and then the boundary shell of the given width.
+    
+    \param smap The stencil map.
+    \param stencil_decl The stencil variable.
+    \param run_kernel The run kernel of the stencil.
+    \param width The width of the boundary shell.
+    \param scope The scope to append the run.
+   */
+  virtual void BuildOverlappedRun(StencilMap *smap,
+                                  SgVariableDeclaration *stencil_decl,
+                                  SgFunctionSymbol *run_kernel,
+                                  int width,
+                                  SgScopeStatement *scope);
   virtual void DeactivateRemoteGrids(
       StencilMap *smap,
       SgVariableDeclaration *stencil_decl,      
@@ -64,9 +121,33 @@ class MPITranslator: public ReferenceTranslator {
   int global_num_dims_;
   //IntArray global_size_;
   SgFunctionSymbol *stencil_run_func_;
+  //! Calls to PSReduce with kernels, in the order of their IDs.
+  SgFunctionCallExpPtrList kernel_reduces_;
   string get_addr_name_;
   string get_addr_no_halo_name_;
   string emit_addr_name_;
+  string inline_suffix_;
+  //! Returns the name of the descriptor variable of a grid.
+  string GetGridDescName(const string &grid_name) const;
+  //! Appends a descriptor parameter for each grid parameter of a kernel.
+  virtual void translateKernelDeclaration(SgFunctionDeclaration *node);
+  //! Declares the descriptors of the grids of a stencil in a block.
+  /*!
+    The descriptors are computed once per run kernel and passed to
+    the kernel calls built by BuildKernelCall.
+    \param s The stencil map object.
+    \param stencil_param The stencil parameter of the enclosing function.
+    \param block The block to prepend the declarations to.
+   */
+  virtual void PrependGridDescs(StencilMap *s,
+                                SgInitializedName *stencil_param,
+                                SgBasicBlock *block);
+  virtual SgFunctionCallExp *BuildKernelCall(
+      StencilMap *s, SgExpressionPtrList &indexArgs,
+      SgInitializedName *stencil_param);
+  virtual SgBasicBlock *BuildRunKernelBody(
+      StencilMap *s, SgInitializedName *stencil_param);
+  virtual SgFunctionDeclaration *BuildReduceKernel(Reduce *rd);
 
   virtual void FixAST();
 };
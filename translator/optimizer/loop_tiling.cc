@@ -0,0 +1,320 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "translator/optimizer/optimization_passes.h"
+#include "translator/optimizer/optimization_common.h"
+#include "translator/rose_util.h"
+#include "translator/runtime_builder.h"
+#include "translator/translation_util.h"
+
+#include <algorithm>
+#include <set>
+
+namespace si = SageInterface;
+namespace sb = SageBuilder;
+
+namespace physis {
+namespace translator {
+namespace optimizer {
+namespace pass {
+
+static const int num_tiling_dims = 3;
+
+//! Find the map loops of each dimension in a run kernel.
+/*!
+  \param loops Set to the loop of each dimension, or NULL if there
+  is not exactly one such loop, e.g., when it is peeled.
+ */
+static void FindMapLoops(SgNode *top, SgForStatement *loops[]) {
+  for (int i = 0; i < num_tiling_dims; ++i) {
+    loops[i] = FindMapLoop(top, i + 1);
+    if (loops[i] && (!GetLoopInit(loops[i]) || !GetLoopTest(loops[i]))) {
+      loops[i] = NULL;
+    }
+  }
+}
+
+//! Returns true if the body of outer consists of inner and variable
+//! declarations only.
+static bool IsNestedDirectly(SgForStatement *outer, SgForStatement *inner) {
+  SgBasicBlock *body = isSgBasicBlock(outer->get_loop_body());
+  if (!body || inner->get_parent() != body) return false;
+  FOREACH (it, body->get_statements().begin(),
+           body->get_statements().end()) {
+    if (*it != inner && !isSgVariableDeclaration(*it)) return false;
+  }
+  return true;
+}
+
+//! Returns true if the loop carries state in variables declared
+//! outside of it, which tiling would break.
+static bool HasCarriedVariable(SgForStatement *loop,
+                               const std::set<SgInitializedName*> &index_vars) {
+  std::set<SgInitializedName*> read_vars, write_vars;
+  if (!si::collectReadWriteVariables(loop, read_vars, write_vars)) {
+    LOG_DEBUG() << "Read/write analysis failed\n";
+    return true;
+  }
+  FOREACH (it, write_vars.begin(), write_vars.end()) {
+    SgInitializedName *v = *it;
+    if (index_vars.find(v) != index_vars.end()) continue;
+    SgScopeStatement *scope = v->get_scope();
+    // Grid buffers are written through stencil fields
+    if (isSgClassDefinition(scope)) continue;
+    if (scope == loop || si::isAncestor(loop, scope)) continue;
+    LOG_DEBUG() << "Variable carried across iterations: "
+                << v->get_name().getString() << "\n";
+    return true;
+  }
+  return false;
+}
+
+//! Estimate the tile size of the middle dimension.
+/*!
+  The innermost dimension is not tiled, and the outermost dimension
+  is streamed through, so that each plane is reused by the following
+  2*R iterations of the outermost loop, where R is the stencil radius
+  along it. The tile size is chosen so that the 2*R+1 planes of the
+  tile of each grid fit in the cache.
+
+  \return The tile size evaluated at run time.
+ */
+static SgExpression *BuildHeuristicTileSize(StencilMap *sm,
+                                            TranslationContext *tx,
+                                            RunKernelLoopAttribute *inner,
+                                            size_t cache_size) {
+  Kernel *kernel = tx->findKernel(sm->getKernel());
+  int radius = 1;
+  int point_size = 0;
+  FOREACH (it, sm->grid_params().begin(), sm->grid_params().end()) {
+    SgInitializedName *gv = *it;
+    if (!kernel->isGridParamRead(gv)) continue;
+    GridType *gt = tx->findGridType(gv);
+    point_size += isSgTypeFloat(gt->elm_type()) ?
+        sizeof(float) : sizeof(double);
+    if (!isContained<SgInitializedName*, StencilRange>(
+            sm->grid_stencil_range_map(), gv)) continue;
+    StencilRange &sr = sm->GetStencilRange(gv);
+    IntVector offset_min, offset_max;
+    if (sr.num_dims() != num_tiling_dims ||
+        !sr.GetNeighborAccess(offset_min, offset_max)) continue;
+    radius = std::max(radius, (int)std::max(-offset_min[num_tiling_dims-1],
+                                            offset_max[num_tiling_dims-1]));
+  }
+  point_size = std::max(point_size, (int)sizeof(float));
+  LOG_DEBUG() << "Tiling for radius " << radius << " and "
+              << point_size << " bytes per point\n";
+  // cache_size / ((2*R+1) * point_size * row_length)
+  SgExpression *row_length =
+      sb::buildSubtractOp(si::copyExpression(inner->end()),
+                          si::copyExpression(inner->begin()));
+  SgExpression *tile_size =
+      sb::buildDivideOp(
+          BuildIndexVal(cache_size / ((2 * radius + 1) * point_size)),
+          rose_util::BuildMax(row_length, BuildIndexVal(1)));
+  return rose_util::BuildMax(tile_size, BuildIndexVal(1));
+}
+
+//! Tile the map loops of a run kernel.
+static void TileRunKernel(SgFunctionDeclaration *run_kernel,
+                          TranslationContext *tx,
+                          const std::vector<int> &tile_size,
+                          size_t cache_size) {
+  StencilMap *sm = rose_util::GetASTAttribute<RunKernelAttribute>(
+      run_kernel)->stencil_map();
+  if (sm->getNumDim() != num_tiling_dims) {
+    LOG_DEBUG() << "Not tiled: " << sm->getNumDim() << "-D stencil\n";
+    return;
+  }
+  SgForStatement *loops[num_tiling_dims];
+  FindMapLoops(run_kernel->get_definition(), loops);
+  if (!loops[1] || !loops[2] || !IsNestedDirectly(loops[2], loops[1])) {
+    LOG_DEBUG() << "Not tiled: unknown loop structure\n";
+    return;
+  }
+  SgForStatement *outer_loop = loops[num_tiling_dims-1];
+  SgBasicBlock *outer_block = isSgBasicBlock(outer_loop->get_parent());
+  if (!outer_block) {
+    LOG_DEBUG() << "Not tiled: unknown loop structure\n";
+    return;
+  }
+
+  // Tile sizes; zero leaves the dimension untiled
+  SgExpression *sizes[num_tiling_dims];
+  for (int i = 0; i < num_tiling_dims; ++i) {
+    sizes[i] = NULL;
+    if (i < (int)tile_size.size() && tile_size[i] > 0) {
+      sizes[i] = BuildIndexVal(tile_size[i]);
+    }
+  }
+  if (tile_size.size() == 0) {
+    RunKernelLoopAttribute *inner_attr = NULL;
+    // The innermost loop may be peeled; use the main one
+    vector<SgForStatement*> inner_loops = FindInnermostLoops(run_kernel);
+    FOREACH (it, inner_loops.begin(), inner_loops.end()) {
+      RunKernelLoopAttribute *attr =
+          rose_util::GetASTAttribute<RunKernelLoopAttribute>(*it);
+      if (attr->dim() == 1 && attr->IsMain()) {
+        inner_attr = attr;
+        break;
+      }
+    }
+    if (!inner_attr) {
+      LOG_DEBUG() << "Not tiled: innermost loop not found\n";
+      return;
+    }
+    sizes[1] = BuildHeuristicTileSize(sm, tx, inner_attr, cache_size);
+  }
+  // Tiling the innermost dimension requires a single loop
+  if (sizes[0] && !(loops[0] && IsNestedDirectly(loops[1], loops[0]))) {
+    LOG_DEBUG() << "Innermost dimension not tiled: "
+                << "unknown loop structure\n";
+    sizes[0] = NULL;
+  }
+  if (!sizes[0] && !sizes[1] && !sizes[2]) return;
+
+  std::set<SgInitializedName*> index_vars;
+  for (int i = 0; i < num_tiling_dims; ++i) {
+    if (!loops[i]) continue;
+    index_vars.insert(
+        rose_util::GetASTAttribute<RunKernelLoopAttribute>(loops[i])->var());
+  }
+  // The outermost map loop is moved into the tile loops as well
+  if (HasCarriedVariable(outer_loop, index_vars)) {
+    LOG_DEBUG() << "Not tiled: loop-carried variable\n";
+    return;
+  }
+  for (int i = 0; i < num_tiling_dims - 1; ++i) {
+    if (sizes[i] && HasCarriedVariable(loops[i], index_vars)) {
+      LOG_DEBUG() << "Not tiled: loop-carried variable\n";
+      return;
+    }
+  }
+
+  // Build the tile loops outside of the map loops, from the
+  // outermost dimension inward
+  SgVariableDeclaration *size_decls[num_tiling_dims];
+  for (int i = num_tiling_dims - 1; i >= 0; --i) {
+    if (!sizes[i]) continue;
+    SgInitializedName *var =
+        rose_util::GetASTAttribute<RunKernelLoopAttribute>(loops[i])->var();
+    size_decls[i] = sb::buildVariableDeclaration(
+        var->get_name().getString() + "_tile_size",
+        BuildIndexType2(outer_block),
+        sb::buildAssignInitializer(sizes[i]), outer_block);
+    si::insertStatementBefore(outer_loop, size_decls[i]);
+  }
+  SgBasicBlock *tile_block = outer_block;
+  SgForStatement *outermost_tile_loop = NULL;
+  for (int i = num_tiling_dims - 1; i >= 0; --i) {
+    if (!sizes[i]) continue;
+    SgForStatement *loop = loops[i];
+    RunKernelLoopAttribute *attr =
+        rose_util::GetASTAttribute<RunKernelLoopAttribute>(loop);
+    SgInitializedName *var = attr->var();
+    SgAssignOp *init = GetLoopInit(loop);
+    SgLessThanOp *test = GetLoopTest(loop);
+    SgVariableDeclaration *size_decl = size_decls[i];
+
+    SgVariableDeclaration *tile_var = sb::buildVariableDeclaration(
+        var->get_name().getString() + "_tile", var->get_type(),
+        NULL, tile_block);
+    SgBasicBlock *tile_body = sb::buildBasicBlock();
+    SgForStatement *tile_loop = sb::buildForStatement(
+        sb::buildAssignStatement(
+            sb::buildVarRefExp(tile_var),
+            si::copyExpression(init->get_rhs_operand())),
+        sb::buildExprStatement(
+            sb::buildLessThanOp(
+                sb::buildVarRefExp(tile_var),
+                si::copyExpression(test->get_rhs_operand()))),
+        sb::buildPlusAssignOp(sb::buildVarRefExp(tile_var),
+                              sb::buildVarRefExp(size_decl)),
+        tile_body);
+    if (!outermost_tile_loop) {
+      si::insertStatementBefore(outer_loop, tile_var);
+      si::insertStatementBefore(outer_loop, tile_loop);
+      outermost_tile_loop = tile_loop;
+      // Parallelization is applied to the outermost tile loop
+      rose_util::AddASTAttribute(
+          tile_loop,
+          new RunKernelLoopAttribute(
+              attr->dim(), tile_var->get_variables()[0],
+              si::copyExpression(init->get_rhs_operand()),
+              si::copyExpression(test->get_rhs_operand())));
+    } else {
+      si::appendStatement(tile_var, tile_block);
+      si::appendStatement(tile_loop, tile_block);
+    }
+
+    // Restrict the map loop to the tile
+    SgExpression *end = si::copyExpression(test->get_rhs_operand());
+    si::replaceExpression(init->get_rhs_operand(),
+                          sb::buildVarRefExp(tile_var));
+    si::replaceExpression(
+        test->get_rhs_operand(),
+        rose_util::BuildMin(
+            sb::buildAddOp(sb::buildVarRefExp(tile_var),
+                           sb::buildVarRefExp(size_decl)),
+            end));
+    attr->begin() = init->get_rhs_operand();
+    attr->end() = test->get_rhs_operand();
+    tile_block = tile_body;
+  }
+  PSAssert(outermost_tile_loop);
+
+  // Move the map loops into the innermost tile loop. The index
+  // variable of the outermost map loop is moved as well to keep it
+  // private to each thread.
+  SgInitializedName *outer_var =
+      rose_util::GetASTAttribute<RunKernelLoopAttribute>(outer_loop)->var();
+  SgVariableDeclaration *outer_var_decl =
+      isSgVariableDeclaration(outer_var->get_declaration());
+  si::removeStatement(outer_loop);
+  if (outer_var_decl && outer_var_decl->get_parent() == outer_block &&
+      outer_var_decl->get_variables().size() == 1) {
+    SgVariableSymbol *sym = isSgVariableSymbol(
+        outer_var->search_for_symbol_from_symbol_table());
+    si::removeStatement(outer_var_decl);
+    outer_block->remove_symbol(sym);
+    outer_var->set_scope(tile_block);
+    tile_block->insert_symbol(outer_var->get_name(), sym);
+    si::appendStatement(outer_var_decl, tile_block);
+  }
+  si::appendStatement(outer_loop, tile_block);
+  si::attachComment(outermost_tile_loop,
+                    "Generated by " + string(__FUNCTION__));
+  LOG_INFO() << "Tiled " << run_kernel->get_name().str() << "\n";
+}
+
+void loop_tiling(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder,
+    const std::vector<int> &tile_size,
+    size_t cache_size) {
+  pre_process(proj, tx, __FUNCTION__);
+
+  vector<SgFunctionDeclaration*> run_kernels =
+      si::querySubTree<SgFunctionDeclaration>(proj, V_SgFunctionDeclaration);
+  FOREACH (it, run_kernels.begin(), run_kernels.end()) {
+    SgFunctionDeclaration *run_kernel = *it;
+    if (!rose_util::GetASTAttribute<RunKernelAttribute>(run_kernel) ||
+        !run_kernel->get_definition()) {
+      continue;
+    }
+    TileRunKernel(run_kernel, tx, tile_size, cache_size);
+  }
+
+  post_process(proj, tx, __FUNCTION__);
+}
+
+} // namespace pass
+} // namespace optimizer
+} // namespace translator
+} // namespace physis
@@ -20,6 +20,11 @@ void MPIOptimizer::DoStage2() {
   if (config_->LookupFlag("OPT_KERNEL_INLINING")) {
     pass::kernel_inlining(proj_, tx_, builder_);
   }
+  // Threads within each process for the hybrid execution
+  if (config_->LookupFlag("OPT_OPENMP")) {
+    pass::openmp_parallelization(proj_, tx_, builder_,
+                                 GetOpenMPSchedule());
+  }
 }
 
 } // namespace optimizer
@@ -0,0 +1,80 @@
+// Copyright 2011-2012, RIKEN AICS.
+// All rights reserved.
+//
+// This file is distributed under the BSD license. See LICENSE.txt for
+// details.
+
+#include "translator/optimizer/optimization_passes.h"
+#include "translator/optimizer/optimization_common.h"
+#include "translator/rose_util.h"
+#include "translator/runtime_builder.h"
+#include "translator/translation_util.h"
+
+#include <set>
+
+namespace si = SageInterface;
+namespace sb = SageBuilder;
+
+namespace physis {
+namespace translator {
+namespace optimizer {
+namespace pass {
+
+// Returns true if the loop writes a variable that is declared outside
+// of the loop, i.e., the variable would be shared among threads.
+static bool HasSharedWrite(SgForStatement *loop) {
+  std::set<SgInitializedName*> read_vars, write_vars;
+  if (!si::collectReadWriteVariables(loop, read_vars, write_vars)) {
+    LOG_DEBUG() << "Read/write analysis failed\n";
+    return true;
+  }
+  SgInitializedName *index_var =
+      rose_util::GetASTAttribute<RunKernelLoopAttribute>(loop)->var();
+  FOREACH (it, write_vars.begin(), write_vars.end()) {
+    SgInitializedName *v = *it;
+    if (v == index_var) continue;
+    SgScopeStatement *scope = v->get_scope();
+    // Grid buffers are written through stencil fields
+    if (isSgClassDefinition(scope)) continue;
+    // Variables declared inside the loop are private
+    if (scope == loop || si::isAncestor(loop, scope)) continue;
+    LOG_DEBUG() << "Shared variable written in loop: "
+                << v->get_name().getString() << "\n";
+    return true;
+  }
+  return false;
+}
+
+void openmp_parallelization(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder,
+    const std::string &schedule) {
+  pre_process(proj, tx, __FUNCTION__);
+
+  vector<SgForStatement*> target_loops = FindOutermostLoops(proj);
+  FOREACH (it, target_loops.begin(), target_loops.end()) {
+    SgForStatement *loop = *it;
+    RunKernelLoopAttribute *loop_attr =
+        rose_util::GetASTAttribute<RunKernelLoopAttribute>(loop);
+    // Peeled iterations are not worth parallelizing
+    if (!loop_attr->IsMain()) continue;
+    if (HasSharedWrite(loop)) {
+      LOG_WARNING() << "Loop not parallelized due to a shared variable\n";
+      continue;
+    }
+    LOG_DEBUG() << "Parallelizing loop of dimension "
+                << loop_attr->dim() << "\n";
+    SgPragmaDeclaration *pragma = sb::buildPragmaDeclaration(
+        "omp parallel for schedule(" + schedule + ")",
+        si::getScope(loop));
+    si::insertStatementBefore(loop, pragma);
+  }
+
+  post_process(proj, tx, __FUNCTION__);
+}
+
+} // namespace pass
+} // namespace optimizer
+} // namespace translator
+} // namespace physis
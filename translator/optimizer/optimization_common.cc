@@ -155,6 +155,64 @@ vector<SgForStatement*> FindInnermostLoops(SgNode *proj) {
   return target_loops;
 }
 
+vector<SgForStatement*> FindOutermostLoops(SgNode *proj) {
+  std::vector<SgNode*> run_kernel_loops =
+      rose_util::QuerySubTreeAttribute<RunKernelLoopAttribute>(proj);
+  vector<SgForStatement*> target_loops;
+  FOREACH (run_kernel_loops_it, run_kernel_loops.begin(),
+           run_kernel_loops.end()) {
+    SgForStatement *loop = isSgForStatement(*run_kernel_loops_it);
+    PSAssert(loop);
+    bool is_nested = false;
+    for (SgNode *parent = loop->get_parent();
+         parent && !isSgFunctionDefinition(parent);
+         parent = parent->get_parent()) {
+      if (isSgForStatement(parent) &&
+          rose_util::GetASTAttribute<RunKernelLoopAttribute>(parent)) {
+        is_nested = true;
+        break;
+      }
+    }
+    // This is not an outermost loop
+    if (is_nested) continue;
+
+    target_loops.push_back(loop);
+  }
+  if (target_loops.size() == 0) {
+    LOG_DEBUG() << "No target loop found\n";
+  }
+
+  return target_loops;
+}
+
+SgForStatement *FindMapLoop(SgNode *top, int dim) {
+  vector<SgForStatement*> loops =
+      si::querySubTree<SgForStatement>(top, V_SgForStatement);
+  SgForStatement *map_loop = NULL;
+  FOREACH (it, loops.begin(), loops.end()) {
+    RunKernelLoopAttribute *attr =
+        rose_util::GetASTAttribute<RunKernelLoopAttribute>(*it);
+    if (!attr || attr->dim() != dim) continue;
+    if (map_loop) return NULL;
+    map_loop = *it;
+  }
+  return map_loop;
+}
+
+SgAssignOp *GetLoopInit(SgForStatement *loop) {
+  SgStatementPtrList &init = loop->get_for_init_stmt()->get_init_stmt();
+  if (init.size() != 1) return NULL;
+  SgExprStatement *es = isSgExprStatement(init.front());
+  if (!es) return NULL;
+  return isSgAssignOp(es->get_expression());
+}
+
+SgLessThanOp *GetLoopTest(SgForStatement *loop) {
+  SgExprStatement *es = isSgExprStatement(loop->get_test());
+  if (!es) return NULL;
+  return isSgLessThanOp(es->get_expression());
+}
+
 static SgInitializedName *GetVariable(SgVarRefExp *e) {
   return e->get_symbol()->get_declaration();
 }
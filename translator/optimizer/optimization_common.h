@@ -27,6 +27,22 @@ extern void FixGridAttributes(
 //! Find innermost kernel loops
 extern vector<SgForStatement*> FindInnermostLoops(SgNode *proj);
 
+//! Find outermost kernel loops
+extern vector<SgForStatement*> FindOutermostLoops(SgNode *proj);
+
+//! Find the kernel loop of a dimension
+/*!
+  \return NULL unless there is exactly one such loop, e.g., when it
+  is peeled.
+ */
+extern SgForStatement *FindMapLoop(SgNode *top, int dim);
+
+//! Returns the assignment that initializes a loop, if any
+extern SgAssignOp *GetLoopInit(SgForStatement *loop);
+
+//! Returns the less-than comparison that tests a loop, if any
+extern SgLessThanOp *GetLoopTest(SgForStatement *loop);
+
 //! Find expressions that are assigned to variable v
 extern void GetVariableSrc(SgInitializedName *v,
                            vector<SgExpression*> &src_exprs);
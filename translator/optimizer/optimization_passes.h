@@ -173,6 +173,123 @@ extern void loop_opt(
     physis::translator::TranslationContext *tx,
     physis::translator::RuntimeBuilder *builder);
 
+//! Fuse consecutive stencils of a run into a single loop nest.
+/*!
+  Consecutive calls to run kernels are replaced by one loop over the
+  outermost dimension that executes a plane of each stencil per
+  iteration. A stencil lags behind its predecessors by as many planes
+  as its dependences on them require. Stencils with read-write grids
+  or non-neighbor accesses to dependent grids are not fused.
+
+  From:
+  \code
+  run_kernel0(&s0);
+  run_kernel1(&s1);
+  \endcode
+
+  To:
+  \code
+  for (zf = ...; zf < ...; ++zf) {
+    if (...) run_kernel0 loops over plane zf
+    if (...) run_kernel1 loops over plane zf - R
+  }
+  \endcode
+ */
+extern void stencil_fusion(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder);
+
+//! Tile the loop nests of 3-D run kernels for cache locality.
+/*!
+  The map loops of the given dimensions are strip-mined, and the
+  resulting tile loops are moved outside of the map loops. By default,
+  only the middle dimension is tiled, with a tile size chosen at run
+  time so that the planes of a tile reused along the outermost
+  dimension fit in cache_size bytes. Kernels with peeled loops of a
+  tiled dimension or with state carried across iterations are not
+  tiled.
+
+  From:
+  \code
+  for (i2 = ...) {
+    for (i1 = min1; i1 < max1; ++i1) {
+  \endcode
+
+  To:
+  \code
+  for (i1_tile = min1; i1_tile < max1; i1_tile += i1_tile_size) {
+    for (i2 = ...) {
+      for (i1 = i1_tile; i1 < min(i1_tile + i1_tile_size, max1); ++i1) {
+  \endcode
+
+  @param tile_size Tile size of each dimension, where zero leaves the
+  dimension untiled. The heuristic is used if empty.
+  @param cache_size Cache size in bytes for the heuristic.
+ */
+extern void loop_tiling(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder,
+    const std::vector<int> &tile_size,
+    size_t cache_size);
+
+//! Make the innermost kernel loops vectorizable.
+/*!
+  Grid buffer pointers are loaded once at the beginning of each run
+  kernel instead of at every access. When the alias analysis shows
+  that no written grid may alias another grid of the stencil, the
+  pointers are declared with restrict, and the innermost loops are
+  marked with the OpenMP simd directive. Assumes kernels are inlined.
+
+  From:
+  \code
+  for (i1 = ...) {
+    for (i0 = ...) {
+      ((float *)(s->g->p0))[...] = ...;
+  \endcode
+
+  To:
+  \code
+  float *restrict __ps_g_p0_0 = (float *)(s->g->p0);
+  for (i1 = ...) {
+  #pragma omp simd
+    for (i0 = ...) {
+      __ps_g_p0_0[...] = ...;
+  \endcode
+ */
+extern void simd_vectorization(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder);
+
+//! Parallelize the outermost kernel loops with OpenMP.
+/*!
+  Must be applied after all other loop transformations. Loops that
+  write variables declared outside of them are left sequential.
+
+  From:
+  \code
+  for (i2 = ...) {
+    for (i1 = ...) {
+  \endcode
+
+  To:
+  \code
+  #pragma omp parallel for schedule(static)
+  for (i2 = ...) {
+    for (i1 = ...) {
+  \endcode
+
+  @param schedule The OpenMP schedule kind, e.g., "static" and
+  "dynamic".
+ */
+extern void openmp_parallelization(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder,
+    const std::string &schedule);
+
 } // namespace pass
 } // namespace optimizer
 } // namespace translator
@@ -42,6 +42,17 @@ void Optimizer::PreProcess() {
 void Optimizer::PostProcess() {
 }
 
+std::string Optimizer::GetOpenMPSchedule() const {
+  std::string schedule = "static";
+  config_->Lookup<std::string>("OPT_OPENMP_SCHEDULE", schedule);
+  if (!(schedule == "static" || schedule == "dynamic" ||
+        schedule == "guided" || schedule == "runtime")) {
+    LOG_ERROR() << "Unknown OpenMP schedule: " << schedule << "\n";
+    PSAbort(1);
+  }
+  return schedule;
+}
+
 
 } // namespace optimizer
 } // namespace translator
@@ -33,7 +33,8 @@ class Optimizer {
         config_->LookupFlag("OPT_REGISTER_BLOCKING") ||
         config_->LookupFlag("OPT_OFFSET_CSE") ||
         config_->LookupFlag("OPT_OFFSET_SPATIAL_CSE") ||        
-        config_->LookupFlag("OPT_LOOP_OPT")) {
+        config_->LookupFlag("OPT_LOOP_OPT") ||
+        config_->LookupFlag("OPT_SIMD")) {
       config_->SetFlag("OPT_KERNEL_INLINING", true);
     }
     if (config_->LookupFlag("OPT_REGISTER_BLOCKING")) {
@@ -58,6 +59,8 @@ class Optimizer {
   virtual void DoStage2();  
   virtual void PreProcess();
   virtual void PostProcess();
+  //! Get the OpenMP schedule given by OPT_OPENMP_SCHEDULE.
+  std::string GetOpenMPSchedule() const;
 };
 
 } // namespace optimizer
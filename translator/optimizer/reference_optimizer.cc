@@ -40,6 +40,38 @@ void ReferenceOptimizer::DoStage2() {
     pass::loop_opt(proj_, tx_, builder_);
     pass::premitive_optimization(proj_, tx_, builder_);
   }
+  // Fusion copies the run kernels, so it is applied after they are
+  // optimized
+  if (config_->LookupFlag("OPT_STENCIL_FUSION")) {
+    pass::stencil_fusion(proj_, tx_, builder_);
+  }
+  if (config_->LookupFlag("OPT_LOOP_TILING")) {
+    std::vector<int> tile_size;
+    const pu::LuaValue *lv =
+        config_->Lookup(Configuration::OPT_LOOP_TILING_SIZE);
+    if (lv) {
+      const pu::LuaTable *tbl = lv->getAsLuaTable();
+      PSAssert(tbl);
+      std::vector<double> v;
+      PSAssert(tbl->get(v));
+      FOREACH (it, v.begin(), v.end()) {
+        tile_size.push_back((int)*it);
+      }
+    }
+    // Cache size in KB used to estimate the tile size
+    double cache_size = 256;
+    config_->Lookup<double>("OPT_LOOP_TILING_CACHE_SIZE", cache_size);
+    pass::loop_tiling(proj_, tx_, builder_, tile_size,
+                      (size_t)(cache_size * 1024));
+  }
+  if (config_->LookupFlag("OPT_SIMD")) {
+    pass::simd_vectorization(proj_, tx_, builder_);
+  }
+  // Parallelization should be placed after all loop transformations
+  if (config_->LookupFlag("OPT_OPENMP")) {
+    pass::openmp_parallelization(proj_, tx_, builder_,
+                                 GetOpenMPSchedule());
+  }
 }
 
 } // namespace optimizer
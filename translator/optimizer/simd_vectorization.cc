@@ -0,0 +1,237 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "translator/optimizer/optimization_passes.h"
+#include "translator/optimizer/optimization_common.h"
+#include "translator/rose_util.h"
+#include "translator/runtime_builder.h"
+#include "translator/translation_util.h"
+
+#include <map>
+
+namespace si = SageInterface;
+namespace sb = SageBuilder;
+
+namespace physis {
+namespace translator {
+namespace optimizer {
+namespace pass {
+
+//! Returns true if no grid written by a stencil may be accessed
+//! through another grid parameter.
+/*!
+  Grid sets are given by the alias analysis of grid variables. The
+  iterations of the innermost loop are then independent, since each
+  point only writes its own element of the written grids.
+ */
+static bool HasNoGridAlias(StencilMap *sm, TranslationContext *tx) {
+  Kernel *kernel = tx->findKernel(sm->getKernel());
+  const SgInitializedNamePtrList &params = sm->grid_params();
+  for (unsigned i = 0; i < params.size(); ++i) {
+    if (!kernel->isGridParamModified(params[i])) continue;
+    // Neighbor reads of a grid written in place are loop-carried
+    if (kernel->isGridParamRead(params[i])) {
+      LOG_DEBUG() << "Grid read and written: "
+                  << params[i]->get_name().getString() << "\n";
+      return false;
+    }
+    const GridSet *gs = tx->findGrid(sm->grid_args()[i]);
+    for (unsigned j = 0; j < params.size(); ++j) {
+      if (i == j) continue;
+      const GridSet *other = tx->findGrid(sm->grid_args()[j]);
+      if (MayAlias(gs, other)) {
+        LOG_DEBUG() << "Grid may be aliased: "
+                    << params[i]->get_name().getString() << "\n";
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//! Find the expression a grid reference in a run kernel is derived
+//! from.
+/*!
+  Kernel inlining introduces local variables for the grid parameters
+  of kernels, which are traced back to their definitions.
+
+  \return An expression referring only to the parameters of the run
+  kernel, or NULL if there is no such expression.
+ */
+static SgExpression *ResolveGridRef(SgExpression *e,
+                                    SgFunctionDeclaration *run_kernel) {
+  while (isSgVarRefExp(e)) {
+    SgInitializedName *v = isSgVarRefExp(e)->get_symbol()->get_declaration();
+    if (isContained(run_kernel->get_args(), v)) break;
+    e = GetDeterministicDefinition(v);
+  }
+  if (!e) return NULL;
+  if (si::querySubTree<SgFunctionCallExp>(e, V_SgFunctionCallExp).size()) {
+    return NULL;
+  }
+  vector<SgVarRefExp*> vrefs = si::querySubTree<SgVarRefExp>(e, V_SgVarRefExp);
+  FOREACH (it, vrefs.begin(), vrefs.end()) {
+    SgInitializedName *v = (*it)->get_symbol()->get_declaration();
+    // Fields of the stencil struct
+    if (isSgClassDefinition(v->get_scope())) continue;
+    if (!isContained(run_kernel->get_args(), v)) return NULL;
+  }
+  return e;
+}
+
+static string GetGridName(SgExpression *grid_ref) {
+  SgBinaryOp *field_ref = isSgBinaryOp(grid_ref);
+  if ((isSgArrowExp(grid_ref) || isSgDotExp(grid_ref)) &&
+      isSgVarRefExp(field_ref->get_rhs_operand())) {
+    return isSgVarRefExp(field_ref->get_rhs_operand())->get_symbol()->
+        get_name().getString();
+  }
+  return "grid";
+}
+
+//! Replace grid buffer references in a run kernel with pointers
+//! declared at its beginning.
+/*!
+  Grid element accesses have the form of ((T *)g->p0)[offset]. Since
+  stores to the elements may alias the grid struct as far as the
+  compiler knows, the buffer pointer would be reloaded after every
+  store.
+
+  \param use_restrict Declare the pointers with restrict. Ignored
+  unless all buffer references are replaced, since restrict requires
+  every access to go through the pointer.
+ */
+static void HoistGridPointers(SgFunctionDeclaration *run_kernel,
+                              bool use_restrict) {
+  SgBasicBlock *body = run_kernel->get_definition()->get_body();
+  vector<SgCastExp*> casts;
+  vector<SgExpression*> grid_refs;
+  vector<SgCastExp*> all_casts =
+      si::querySubTree<SgCastExp>(body, V_SgCastExp);
+  FOREACH (it, all_casts.begin(), all_casts.end()) {
+    SgCastExp *cast = *it;
+    SgArrowExp *buf_ref = isSgArrowExp(cast->get_operand());
+    if (!buf_ref || !isSgPointerType(cast->get_type())) continue;
+    SgVarRefExp *buf = isSgVarRefExp(buf_ref->get_rhs_operand());
+    if (!buf) continue;
+    string buf_name = buf->get_symbol()->get_name().getString();
+    if (buf_name != "p0" && buf_name != "p1") continue;
+    SgExpression *grid_ref =
+        ResolveGridRef(buf_ref->get_lhs_operand(), run_kernel);
+    if (!grid_ref) {
+      LOG_DEBUG() << "Grid reference not hoisted: "
+                  << buf_ref->unparseToString() << "\n";
+      use_restrict = false;
+      continue;
+    }
+    casts.push_back(cast);
+    grid_refs.push_back(grid_ref);
+  }
+
+  std::map<string, SgVariableDeclaration*> pointers;
+  ENUMERATE (i, it, casts.begin(), casts.end()) {
+    SgCastExp *cast = *it;
+    SgExpression *grid_ref = grid_refs[i];
+    string buf_name = isSgVarRefExp(
+        isSgArrowExp(cast->get_operand())->get_rhs_operand())->
+        get_symbol()->get_name().getString();
+    string key = grid_ref->unparseToString() + "->" + buf_name;
+    SgVariableDeclaration *decl;
+    if (isContained(pointers, key)) {
+      decl = pointers[key];
+    } else {
+      SgCastExp *init = isSgCastExp(si::copyExpression(cast));
+      si::replaceExpression(
+          isSgArrowExp(init->get_operand())->get_lhs_operand(),
+          si::copyExpression(grid_ref));
+      SgType *type = cast->get_type();
+      if (use_restrict) type = sb::buildRestrictType(type);
+      decl = sb::buildVariableDeclaration(
+          rose_util::generateUniqueName(
+              body, "__ps_" + GetGridName(grid_ref) + "_" + buf_name + "_"),
+          type, sb::buildAssignInitializer(init, type), body);
+      si::prependStatement(decl, body);
+      pointers.insert(std::make_pair(key, decl));
+    }
+    si::replaceExpression(cast, sb::buildVarRefExp(decl));
+  }
+}
+
+static bool HasKernelCall(SgForStatement *loop, TranslationContext *tx) {
+  vector<SgFunctionCallExp*> calls =
+      si::querySubTree<SgFunctionCallExp>(loop, V_SgFunctionCallExp);
+  FOREACH (it, calls.begin(), calls.end()) {
+    SgFunctionRefExp *ref = isSgFunctionRefExp((*it)->get_function());
+    if (!ref) continue;
+    SgFunctionDeclaration *decl = rose_util::getFuncDeclFromFuncRef(ref);
+    if (decl && tx->isKernel(decl)) return true;
+  }
+  return false;
+}
+
+static bool IsNestedMapLoop(SgForStatement *loop) {
+  for (SgNode *parent = loop->get_parent();
+       parent && !isSgFunctionDefinition(parent);
+       parent = parent->get_parent()) {
+    if (isSgForStatement(parent) &&
+        rose_util::GetASTAttribute<RunKernelLoopAttribute>(parent)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void VectorizeRunKernel(SgFunctionDeclaration *run_kernel,
+                               TranslationContext *tx) {
+  StencilMap *sm = rose_util::GetASTAttribute<RunKernelAttribute>(
+      run_kernel)->stencil_map();
+  bool independent = HasNoGridAlias(sm, tx);
+  HoistGridPointers(run_kernel, independent);
+  if (!independent) return;
+  vector<SgForStatement*> loops = FindInnermostLoops(run_kernel);
+  FOREACH (it, loops.begin(), loops.end()) {
+    SgForStatement *loop = *it;
+    RunKernelLoopAttribute *loop_attr =
+        rose_util::GetASTAttribute<RunKernelLoopAttribute>(loop);
+    // Peeled iterations are too few to vectorize
+    if (!loop_attr->IsMain() || loop_attr->dim() != 1) continue;
+    // Kernels not inlined are opaque to the compiler
+    if (HasKernelCall(loop, tx)) continue;
+    // A single loop is left to openmp_parallelization
+    if (!IsNestedMapLoop(loop)) continue;
+    LOG_DEBUG() << "Vectorizing loop in "
+                << run_kernel->get_name().str() << "\n";
+    si::insertStatementBefore(
+        loop, sb::buildPragmaDeclaration("omp simd", si::getScope(loop)));
+  }
+}
+
+void simd_vectorization(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder) {
+  pre_process(proj, tx, __FUNCTION__);
+
+  vector<SgFunctionDeclaration*> run_kernels =
+      si::querySubTree<SgFunctionDeclaration>(proj, V_SgFunctionDeclaration);
+  FOREACH (it, run_kernels.begin(), run_kernels.end()) {
+    SgFunctionDeclaration *run_kernel = *it;
+    if (!rose_util::GetASTAttribute<RunKernelAttribute>(run_kernel) ||
+        !run_kernel->get_definition()) {
+      continue;
+    }
+    VectorizeRunKernel(run_kernel, tx);
+  }
+
+  post_process(proj, tx, __FUNCTION__);
+}
+
+} // namespace pass
+} // namespace optimizer
+} // namespace translator
+} // namespace physis
@@ -0,0 +1,328 @@
+// Copyright 2011, Tokyo Institute of Technology.
+// All rights reserved.
+//
+// This file is distributed under the license described in
+// LICENSE.txt.
+//
+// Author: Naoya Maruyama (naoya@matsulab.is.titech.ac.jp)
+
+#include "translator/optimizer/optimization_passes.h"
+#include "translator/optimizer/optimization_common.h"
+#include "translator/rose_util.h"
+#include "translator/runtime_builder.h"
+#include "translator/translation_util.h"
+
+#include <algorithm>
+
+namespace si = SageInterface;
+namespace sb = SageBuilder;
+
+namespace physis {
+namespace translator {
+namespace optimizer {
+namespace pass {
+
+//! A call to a run kernel that is a member of a fused group.
+struct FusedStencil {
+  SgExprStatement *call;
+  SgFunctionDeclaration *run_kernel;
+  StencilMap *sm;
+  //! Number of planes the stencil lags behind the fused loop index.
+  int skew;
+};
+
+static SgFunctionDeclaration *GetRunKernel(SgStatement *stmt) {
+  SgExprStatement *es = isSgExprStatement(stmt);
+  if (!es) return NULL;
+  SgFunctionCallExp *call = isSgFunctionCallExp(es->get_expression());
+  if (!call) return NULL;
+  SgFunctionRefExp *ref = isSgFunctionRefExp(call->get_function());
+  if (!ref) return NULL;
+  SgFunctionDeclaration *decl = rose_util::getFuncDeclFromFuncRef(ref);
+  if (!decl || !decl->get_definingDeclaration()) return NULL;
+  decl = isSgFunctionDeclaration(decl->get_definingDeclaration());
+  if (!rose_util::GetASTAttribute<RunKernelAttribute>(decl)) return NULL;
+  return decl;
+}
+
+static bool IsGridSwap(SgStatement *stmt) {
+  SgExprStatement *es = isSgExprStatement(stmt);
+  if (!es) return false;
+  SgFunctionCallExp *call = isSgFunctionCallExp(es->get_expression());
+  if (!call) return false;
+  SgFunctionRefExp *ref = isSgFunctionRefExp(call->get_function());
+  if (!ref) return false;
+  return ref->get_symbol()->get_name().getString() == "__PSGridSwap";
+}
+
+//! Returns true if a run kernel can be executed plane by plane.
+static bool IsFusable(SgFunctionDeclaration *run_kernel, StencilMap *sm,
+                      TranslationContext *tx) {
+  SgForStatement *loop =
+      FindMapLoop(run_kernel->get_definition(), sm->getNumDim());
+  if (!loop || !GetLoopInit(loop) || !GetLoopTest(loop)) {
+    LOG_DEBUG() << "Not fused: unknown loop structure\n";
+    return false;
+  }
+  // Grid swaps are moved after the fused loop, which is only valid
+  // when they are no-ops, i.e., no grid is double buffered.
+  if (sm->HasReadWriteGrid(tx)) {
+    LOG_DEBUG() << "Not fused: read-write grid\n";
+    return false;
+  }
+#if defined(AUTO_DOUBLE_BUFFERING)
+  FOREACH (it, sm->grid_args().begin(), sm->grid_args().end()) {
+    const GridSet *gs = tx->findGrid(*it);
+    if (!gs) return false;
+    FOREACH (git, gs->begin(), gs->end()) {
+      if (*git == NULL || (*git)->isReadWrite()) {
+        LOG_DEBUG() << "Not fused: double-buffered grid\n";
+        return false;
+      }
+    }
+  }
+#endif
+  return true;
+}
+
+//! Returns true if every grid of a grid set is known.
+static bool IsKnownGridSet(const GridSet *gs) {
+  return gs != NULL && gs->find(NULL) == gs->end();
+}
+
+//! Get the access offsets of a grid along a dimension.
+static bool GetAccessOffset(StencilMap *sm, SgInitializedName *gv,
+                            int dim, int &offset_min, int &offset_max) {
+  if (!isContained<SgInitializedName*, StencilRange>(
+          sm->grid_stencil_range_map(), gv) ||
+      sm->IsGridPeriodic(gv)) {
+    return false;
+  }
+  StencilRange &sr = sm->GetStencilRange(gv);
+  IntVector min_vec, max_vec;
+  if (sr.num_dims() != sm->getNumDim() ||
+      !sr.GetNeighborAccess(min_vec, max_vec)) {
+    return false;
+  }
+  offset_min = (int)min_vec[dim];
+  offset_max = (int)max_vec[dim];
+  return true;
+}
+
+//! Compute the skew of dst relative to src along the outermost
+//! dimension.
+/*!
+  When dst runs the planes distance behind src, each plane that dst
+  reads from src has already been computed, and no plane that src
+  reads from dst has been overwritten yet.
+
+  \return false if the distance cannot be determined.
+ */
+static bool GetDependenceDistance(StencilMap *src, StencilMap *dst,
+                                  TranslationContext *tx,
+                                  int &distance) {
+  distance = 0;
+  int dim = src->getNumDim() - 1;
+  Kernel *src_kernel = tx->findKernel(src->getKernel());
+  Kernel *dst_kernel = tx->findKernel(dst->getKernel());
+  for (unsigned i = 0; i < src->grid_params().size(); ++i) {
+    SgInitializedName *src_param = src->grid_params()[i];
+    const GridSet *src_gs = tx->findGrid(src->grid_args()[i]);
+    if (!IsKnownGridSet(src_gs)) {
+      LOG_DEBUG() << "Not fused: unknown grid\n";
+      return false;
+    }
+    for (unsigned j = 0; j < dst->grid_params().size(); ++j) {
+      SgInitializedName *dst_param = dst->grid_params()[j];
+      const GridSet *dst_gs = tx->findGrid(dst->grid_args()[j]);
+      if (!IsKnownGridSet(dst_gs)) {
+        LOG_DEBUG() << "Not fused: unknown grid\n";
+        return false;
+      }
+      if (!MayAlias(src_gs, dst_gs)) continue;
+      int offset_min, offset_max;
+      // dst reads what src writes
+      if (src_kernel->isGridParamModified(src_param) &&
+          dst_kernel->isGridParamRead(dst_param)) {
+        if (!GetAccessOffset(dst, dst_param, dim, offset_min, offset_max)) {
+          LOG_DEBUG() << "Not fused: non-neighbor access\n";
+          return false;
+        }
+        distance = std::max(distance, offset_max);
+      }
+      // dst overwrites what src reads
+      if (dst_kernel->isGridParamModified(dst_param) &&
+          src_kernel->isGridParamRead(src_param)) {
+        if (!GetAccessOffset(src, src_param, dim, offset_min, offset_max)) {
+          LOG_DEBUG() << "Not fused: non-neighbor access\n";
+          return false;
+        }
+        distance = std::max(distance, -offset_min);
+      }
+    }
+  }
+  return true;
+}
+
+static bool ComputeSkew(const vector<FusedStencil> &group, StencilMap *sm,
+                        TranslationContext *tx, int &skew) {
+  skew = 0;
+  if (sm->getNumDim() != group.front().sm->getNumDim()) {
+    LOG_DEBUG() << "Not fused: mixed dimensions\n";
+    return false;
+  }
+  FOREACH (it, group.begin(), group.end()) {
+    int distance;
+    if (!GetDependenceDistance(it->sm, sm, tx, distance)) return false;
+    skew = std::max(skew, it->skew + distance);
+  }
+  return true;
+}
+
+//! Build a copy of a run kernel restricted to plane z - skew.
+/*!
+  \param begin Set to the first plane of the original loop.
+  \param end Set to the end of the original loop.
+ */
+static SgStatement *BuildPlane(const FusedStencil &fs,
+                               SgVariableDeclaration *z,
+                               SgExpression *&begin,
+                               SgExpression *&end) {
+  RunKernelAttribute *attr =
+      rose_util::GetASTAttribute<RunKernelAttribute>(fs.run_kernel);
+  SgBasicBlock *body = isSgBasicBlock(
+      si::copyStatement(fs.run_kernel->get_definition()->get_body()));
+  FixGridAttributes(body);
+  // Redirect the stencil parameter to the argument of the call
+  SgExpression *stencil_arg =
+      isSgFunctionCallExp(fs.call->get_expression())->
+      get_args()->get_expressions().front();
+  vector<SgVarRefExp*> vrefs =
+      si::querySubTree<SgVarRefExp>(body, V_SgVarRefExp);
+  FOREACH (it, vrefs.begin(), vrefs.end()) {
+    if ((*it)->get_symbol()->get_declaration() == attr->stencil_param()) {
+      si::replaceExpression(*it, si::copyExpression(stencil_arg));
+    }
+  }
+
+  SgForStatement *loop = FindMapLoop(body, fs.sm->getNumDim());
+  SgAssignOp *init = GetLoopInit(loop);
+  SgLessThanOp *test = GetLoopTest(loop);
+  begin = si::copyExpression(init->get_rhs_operand());
+  end = si::copyExpression(test->get_rhs_operand());
+  SgExpression *plane = sb::buildVarRefExp(z);
+  if (fs.skew) {
+    plane = sb::buildSubtractOp(plane, sb::buildIntVal(fs.skew));
+  }
+  si::replaceExpression(init->get_rhs_operand(),
+                        si::copyExpression(plane));
+  si::replaceExpression(test->get_rhs_operand(),
+                        sb::buildAddOp(si::copyExpression(plane),
+                                       sb::buildIntVal(1)));
+  // The loop has only one iteration now; leave parallelization to
+  // the inner loops.
+  loop->removeAttribute(RunKernelLoopAttribute::name);
+
+  SgExpression *cond = sb::buildAndOp(
+      sb::buildLessOrEqualOp(si::copyExpression(begin),
+                             si::copyExpression(plane)),
+      sb::buildLessThanOp(plane, si::copyExpression(end)));
+  return sb::buildIfStmt(cond, body, NULL);
+}
+
+//! Replace the calls of a group with a single loop over planes.
+static void Fuse(vector<FusedStencil> &group) {
+  if (group.size() < 2) return;
+  SgBasicBlock *block = sb::buildBasicBlock();
+  si::attachComment(block, "Generated by " + string(__FUNCTION__));
+  SgVariableDeclaration *z = sb::buildVariableDeclaration(
+      "zf", BuildIndexType2(block), NULL, block);
+  si::appendStatement(z, block);
+  SgBasicBlock *loop_body = sb::buildBasicBlock();
+  SgExpression *loop_begin = NULL;
+  SgExpression *loop_end = NULL;
+  FOREACH (it, group.begin(), group.end()) {
+    SgExpression *begin, *end;
+    si::appendStatement(BuildPlane(*it, z, begin, end), loop_body);
+    if (it->skew) {
+      begin = sb::buildAddOp(begin, sb::buildIntVal(it->skew));
+      end = sb::buildAddOp(end, sb::buildIntVal(it->skew));
+    }
+    loop_begin = loop_begin ? rose_util::BuildMin(loop_begin, begin) : begin;
+    loop_end = loop_end ? rose_util::BuildMax(loop_end, end) : end;
+  }
+  si::appendStatement(
+      sb::buildForStatement(
+          sb::buildAssignStatement(sb::buildVarRefExp(z), loop_begin),
+          sb::buildExprStatement(
+              sb::buildLessThanOp(sb::buildVarRefExp(z), loop_end)),
+          sb::buildPlusPlusOp(sb::buildVarRefExp(z)),
+          loop_body),
+      block);
+  LOG_INFO() << "Fusing " << group.size() << " stencils with skew "
+             << group.back().skew << "\n";
+  si::insertStatementBefore(group.front().call, block);
+  FOREACH (it, group.begin(), group.end()) {
+    si::removeStatement(it->call);
+  }
+}
+
+//! Fuse consecutive run kernel calls in a block.
+static void FuseBlock(SgBasicBlock *block, TranslationContext *tx) {
+  SgStatementPtrList stmts = block->get_statements();
+  vector<FusedStencil> group;
+  FOREACH (it, stmts.begin(), stmts.end()) {
+    SgStatement *stmt = *it;
+    // Swaps of fusable stencils do not separate the group
+    if (IsGridSwap(stmt)) continue;
+    SgFunctionDeclaration *run_kernel = GetRunKernel(stmt);
+    if (!run_kernel) {
+      Fuse(group);
+      group.clear();
+      continue;
+    }
+    StencilMap *sm = rose_util::GetASTAttribute<RunKernelAttribute>(
+        run_kernel)->stencil_map();
+    if (!IsFusable(run_kernel, sm, tx)) {
+      Fuse(group);
+      group.clear();
+      continue;
+    }
+    FusedStencil fs = {isSgExprStatement(stmt), run_kernel, sm, 0};
+    if (!group.empty() && !ComputeSkew(group, sm, tx, fs.skew)) {
+      Fuse(group);
+      group.clear();
+      fs.skew = 0;
+    }
+    group.push_back(fs);
+  }
+  Fuse(group);
+}
+
+void stencil_fusion(
+    SgProject *proj,
+    physis::translator::TranslationContext *tx,
+    physis::translator::RuntimeBuilder *builder) {
+  pre_process(proj, tx, __FUNCTION__);
+
+  // Collect blocks that call run kernels
+  vector<SgBasicBlock*> blocks;
+  vector<SgExprStatement*> stmts =
+      si::querySubTree<SgExprStatement>(proj, V_SgExprStatement);
+  FOREACH (it, stmts.begin(), stmts.end()) {
+    if (!GetRunKernel(*it)) continue;
+    SgBasicBlock *block = isSgBasicBlock((*it)->get_parent());
+    if (!block || isContained(blocks, block)) continue;
+    blocks.push_back(block);
+  }
+  FOREACH (it, blocks.begin(), blocks.end()) {
+    FuseBlock(*it, tx);
+  }
+
+  post_process(proj, tx, __FUNCTION__);
+}
+
+} // namespace pass
+} // namespace optimizer
+} // namespace translator
+} // namespace physis
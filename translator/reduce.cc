@@ -70,6 +70,22 @@ SgVarRefExp *Reduce::GetGrid() const {
   return isSgVarRefExp(ge);
 }
 
+bool Reduce::GetStaticOp(PSReduceOp &op) const {
+  SgExpression *op_exp =
+      reduce_call()->get_args()->get_expressions()[1];
+  while (isSgCastExp(op_exp)) {
+    op_exp = isSgCastExp(op_exp)->get_operand();
+  }
+  if (isSgEnumVal(op_exp)) {
+    op = (PSReduceOp)isSgEnumVal(op_exp)->get_value();
+  } else if (isSgIntVal(op_exp)) {
+    op = (PSReduceOp)isSgIntVal(op_exp)->get_value();
+  } else {
+    return false;
+  }
+  return true;
+}
+
 } // namespace translator
 } // namespace physis
 
@@ -13,6 +13,7 @@
 #include "translator/translator_common.h"
 #include "translator/grid.h"
 #include "physis/physis_util.h"
+#include "physis/reduce.h"
 
 #define REDUCE_NAME ("PSReduce")
 
@@ -31,6 +32,12 @@ class Reduce: public AstAttribute {
   bool IsKernel() const;
   //! Returns the variable referencing the grid to be reduced.
   SgVarRefExp *GetGrid() const;
+  //! Returns the reduction operator if it is a constant.
+  /*!
+    \param op Set to the operator when it is a constant.
+    \return True if the operator is known at translation time.
+   */
+  bool GetStaticOp(PSReduceOp &op) const;
   //! Returns true if a call is to the reduce intrinsic.
   /*!
     \param call A function call.
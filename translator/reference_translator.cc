@@ -8,10 +8,14 @@
 
 #include "translator/reference_translator.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 #include "translator/rose_util.h"
 #include "translator/translation_context.h"
 #include "translator/reference_runtime_builder.h"
 #include "translator/runtime_builder.h"
+#include "translator/translation_util.h"
 
 namespace si = SageInterface;
 namespace sb = SageBuilder;
@@ -23,9 +27,29 @@ ReferenceTranslator::ReferenceTranslator(const Configuration &config):
     Translator(config),
     flag_constant_grid_size_optimization_(true),
     validate_ast_(true),
+    temporal_blocking_steps_(0),
+    temporal_blocking_size_(8),
     grid_create_name_("__PSGridNew"),
     rt_builder_(NULL) {
   target_specific_macro_ = "PHYSIS_REF";
+  double v;
+  const pu::LuaValue *lv
+      = config.Lookup(Configuration::TEMPORAL_BLOCKING);
+  if (lv) {
+    PSAssert(lv->get(v));
+    temporal_blocking_steps_ = (int)v;
+  }
+  lv = config.Lookup(Configuration::TEMPORAL_BLOCKING_SIZE);
+  if (lv) {
+    PSAssert(lv->get(v));
+    temporal_blocking_size_ = (int)v;
+    PSAssert(temporal_blocking_size_ > 0);
+  }
+  if (temporal_blocking_steps_ > 1) {
+    LOG_INFO() << "Temporal blocking enabled: "
+               << temporal_blocking_steps_ << " steps, "
+               << temporal_blocking_size_ << " planes per tile.\n";
+  }
 }
 
 ReferenceTranslator::~ReferenceTranslator() {
@@ -686,6 +710,11 @@ SgFunctionDeclaration *ReferenceTranslator::BuildRunKernel(StencilMap *s) {
 }
 
 SgBasicBlock *ReferenceTranslator::BuildRunBody(Run *run) {
+  int radius;
+  if (temporal_blocking_steps_ > 1 &&
+      IsTemporalBlockingEligible(run, radius)) {
+    return BuildTemporallyBlockedRunBody(run, radius);
+  }
   SgBasicBlock *block = sb::buildBasicBlock();
   si::attachComment(block, "Generated by " + string(__FUNCTION__));
   SgVariableDeclaration *lv
@@ -723,6 +752,222 @@ SgBasicBlock *ReferenceTranslator::BuildRunBody(Run *run) {
   return block;
 }
 
+bool ReferenceTranslator::IsTemporalBlockingEligible(Run *run,
+                                                     int &radius) {
+  radius = 0;
+  int num_dim = run->stencils().front().second->getNumDim();
+  FOREACH (it, run->stencils().begin(), run->stencils().end()) {
+    StencilMap *s = it->second;
+    if (s->getNumDim() != num_dim) {
+      LOG_INFO() << "Not temporally blocked: mixed dimensions\n";
+      return false;
+    }
+    Kernel *kernel = tx_->findKernel(s->getKernel());
+    FOREACH (pit, s->grid_params().begin(), s->grid_params().end()) {
+      SgInitializedName *gv = *pit;
+      if (!kernel->isGridParamRead(gv)) continue;
+      if (!isContained<SgInitializedName*, StencilRange>(
+              s->grid_stencil_range_map(), gv) ||
+          s->IsGridPeriodic(gv)) {
+        LOG_INFO() << "Not temporally blocked: non-neighbor access\n";
+        return false;
+      }
+      IntVector offset_min, offset_max;
+      StencilRange &sr = s->GetStencilRange(gv);
+      if (sr.num_dims() != num_dim ||
+          !sr.GetNeighborAccess(offset_min, offset_max)) {
+        LOG_INFO() << "Not temporally blocked: non-neighbor access\n";
+        return false;
+      }
+      radius = std::max(radius, std::abs((int)offset_min[num_dim-1]));
+      radius = std::max(radius, std::abs((int)offset_max[num_dim-1]));
+    }
+    // Tiles of different time steps update a grid in place, which
+    // is not possible if reads and writes go to separate buffers.
+    if (s->HasReadWriteGrid(tx_)) {
+      LOG_INFO() << "Not temporally blocked: read-write grid\n";
+      return false;
+    }
+#if defined(AUTO_DOUBLE_BUFFERING)
+    // Grids read and written by any map are double buffered
+    FOREACH (ait, s->grid_args().begin(), s->grid_args().end()) {
+      const GridSet *gs = tx_->findGrid(*ait);
+      if (!gs) return false;
+      FOREACH (git, gs->begin(), gs->end()) {
+        if (*git == NULL || (*git)->isReadWrite()) {
+          LOG_INFO() << "Not temporally blocked: double-buffered grid\n";
+          return false;
+        }
+      }
+    }
+#endif
+  }
+  return true;
+}
+
+SgBasicBlock *ReferenceTranslator::BuildTemporallyBlockedRunBody(
+    Run *run, int radius) {
+  // Generate code like this for stencils s0, ..., sN-1, where sj is
+  // the j-th step of a time block:
+  // for (i = 0; i < iter; i += TB) {
+  //   nt = min(iter - i, TB);
+  //   for (zb = tb_min; zb < tb_max + (nt * N - 1) * R; zb += B) {
+  //     for (t = 0; t < nt; ++t) {
+  //       step = t * N + j;
+  //       sj_tb.dom.local_min[d] = max(tb_minj, zb - step * R);
+  //       sj_tb.dom.local_max[d] = min(tb_maxj, zb + B - step * R);
+  //       if (sj_tb.dom.local_min[d] < sj_tb.dom.local_max[d])
+  //         run_kernel(&sj_tb);
+  //     }
+  //   }
+  // }
+  // Each step lags R planes behind its preceding step, so that the
+  // planes it reads have already been computed within the tile and
+  // the planes it overwrites are no longer read by preceding steps.
+  SgBasicBlock *block = sb::buildBasicBlock();
+  si::attachComment(block, "Generated by " + string(__FUNCTION__));
+  int num_stencils = run->stencils().size();
+  int dim = run->stencils().front().second->getNumDim() - 1;
+  SgType *index_type = BuildIndexType2(block);
+  LOG_INFO() << "Temporally blocking " << run->GetName()
+             << " with radius " << radius << "\n";
+
+  SgVariableDeclaration *lv
+      = sb::buildVariableDeclaration("i", sb::buildIntType(), NULL, block);
+  si::appendStatement(lv, block);
+  vector<SgVariableDeclaration*> tile_stencils;
+  vector<SgVariableDeclaration*> dom_mins;
+  vector<SgVariableDeclaration*> dom_maxs;
+  SgExpression *tb_min = NULL;
+  SgExpression *tb_max = NULL;
+  ENUMERATE(i, it, run->stencils().begin(), run->stencils().end()) {
+    StencilMap *s = it->second;
+    string stencil_name = "s" + toString(i);
+    SgVariableDeclaration *ts = rose_util::buildVarDecl(
+        stencil_name + "_tb", s->stencil_type(),
+        sb::buildVarRefExp(stencil_name, block), block);
+    tile_stencils.push_back(ts);
+    SgVariableDeclaration *dmin = rose_util::buildVarDecl(
+        "tb_min" + toString(i), index_type,
+        BuildStencilDomMinRef(sb::buildVarRefExp(ts), dim), block);
+    SgVariableDeclaration *dmax = rose_util::buildVarDecl(
+        "tb_max" + toString(i), index_type,
+        BuildStencilDomMaxRef(sb::buildVarRefExp(ts), dim), block);
+    dom_mins.push_back(dmin);
+    dom_maxs.push_back(dmax);
+    tb_min = tb_min ?
+        rose_util::BuildMin(tb_min, sb::buildVarRefExp(dmin)) :
+        sb::buildVarRefExp(dmin);
+    tb_max = tb_max ?
+        rose_util::BuildMax(tb_max, sb::buildVarRefExp(dmax)) :
+        sb::buildVarRefExp(dmax);
+  }
+  SgVariableDeclaration *tb_min_decl =
+      rose_util::buildVarDecl("tb_min", index_type, tb_min, block);
+  SgVariableDeclaration *tb_max_decl =
+      rose_util::buildVarDecl("tb_max", index_type, tb_max, block);
+
+  SgBasicBlock *loop_body = sb::buildBasicBlock();
+  SgVariableDeclaration *nt = rose_util::buildVarDecl(
+      "nt", sb::buildIntType(),
+      rose_util::BuildMin(
+          sb::buildSubtractOp(sb::buildVarRefExp("iter", block),
+                              sb::buildVarRefExp(lv)),
+          sb::buildIntVal(temporal_blocking_steps_)),
+      loop_body);
+  SgVariableDeclaration *zb = sb::buildVariableDeclaration(
+      "zb", index_type, NULL, loop_body);
+  si::appendStatement(zb, loop_body);
+  SgVariableDeclaration *t = sb::buildVariableDeclaration(
+      "t", sb::buildIntType(), NULL, loop_body);
+  si::appendStatement(t, loop_body);
+
+  SgBasicBlock *step_body = sb::buildBasicBlock();
+  ENUMERATE(i, it, run->stencils().begin(), run->stencils().end()) {
+    StencilMap *s = it->second;
+    SgFunctionSymbol *fs = rose_util::getFunctionSymbol(s->run());
+    assert(fs);
+    SgVariableDeclaration *ts = tile_stencils[i];
+    // zb - (t * N + j) * R
+    SgExpression *skew = sb::buildMultiplyOp(
+        sb::buildAddOp(
+            sb::buildMultiplyOp(sb::buildVarRefExp(t),
+                                sb::buildIntVal(num_stencils)),
+            sb::buildIntVal(i)),
+        sb::buildIntVal(radius));
+    rose_util::AppendExprStatement(
+        step_body,
+        sb::buildAssignOp(
+            BuildStencilDomMinRef(sb::buildVarRefExp(ts), dim),
+            rose_util::BuildMax(
+                sb::buildVarRefExp(dom_mins[i]),
+                sb::buildSubtractOp(sb::buildVarRefExp(zb), skew))));
+    rose_util::AppendExprStatement(
+        step_body,
+        sb::buildAssignOp(
+            BuildStencilDomMaxRef(sb::buildVarRefExp(ts), dim),
+            rose_util::BuildMin(
+                sb::buildVarRefExp(dom_maxs[i]),
+                sb::buildSubtractOp(
+                    sb::buildAddOp(
+                        sb::buildVarRefExp(zb),
+                        sb::buildIntVal(temporal_blocking_size_)),
+                    si::copyExpression(skew)))));
+    SgExprListExp *args = sb::buildExprListExp(
+        sb::buildAddressOfOp(sb::buildVarRefExp(ts)));
+    SgStatement *call = sb::buildExprStatement(
+        sb::buildFunctionCallExp(fs, args));
+    si::appendStatement(
+        sb::buildIfStmt(
+            sb::buildLessThanOp(
+                BuildStencilDomMinRef(sb::buildVarRefExp(ts), dim),
+                BuildStencilDomMaxRef(sb::buildVarRefExp(ts), dim)),
+            call, NULL),
+        step_body);
+  }
+  SgForStatement *step_loop = sb::buildForStatement(
+      sb::buildAssignStatement(sb::buildVarRefExp(t), sb::buildIntVal(0)),
+      sb::buildExprStatement(
+          sb::buildLessThanOp(sb::buildVarRefExp(t),
+                              sb::buildVarRefExp(nt))),
+      sb::buildPlusPlusOp(sb::buildVarRefExp(t)),
+      step_body);
+
+  // zb < tb_max + (nt * N - 1) * R
+  SgExpression *tile_end = sb::buildAddOp(
+      sb::buildVarRefExp(tb_max_decl),
+      sb::buildMultiplyOp(
+          sb::buildSubtractOp(
+              sb::buildMultiplyOp(sb::buildVarRefExp(nt),
+                                  sb::buildIntVal(num_stencils)),
+              sb::buildIntVal(1)),
+          sb::buildIntVal(radius)));
+  SgForStatement *tile_loop = sb::buildForStatement(
+      sb::buildAssignStatement(sb::buildVarRefExp(zb),
+                               sb::buildVarRefExp(tb_min_decl)),
+      sb::buildExprStatement(
+          sb::buildLessThanOp(sb::buildVarRefExp(zb), tile_end)),
+      sb::buildPlusAssignOp(sb::buildVarRefExp(zb),
+                            sb::buildIntVal(temporal_blocking_size_)),
+      sb::buildBasicBlock(step_loop));
+  si::appendStatement(tile_loop, loop_body);
+  // No grid swap is needed since none of the grids is read-write.
+
+  SgForStatement *loop =
+      sb::buildForStatement(
+          sb::buildAssignStatement(sb::buildVarRefExp(lv),
+                                   sb::buildIntVal(0)),
+          sb::buildExprStatement(
+              sb::buildLessThanOp(sb::buildVarRefExp(lv),
+                                  sb::buildVarRefExp("iter", block))),
+          sb::buildPlusAssignOp(sb::buildVarRefExp(lv),
+                                sb::buildIntVal(temporal_blocking_steps_)),
+          loop_body);
+
+  TraceStencilRun(run, loop, block);
+  return block;
+}
+
 void ReferenceTranslator::TraceStencilRun(Run *run,
                                           SgScopeStatement *loop,
                                           SgScopeStatement *cur_scope) {
@@ -735,6 +980,27 @@ void ReferenceTranslator::TraceStencilRun(Run *run,
   // Call the pre trace function
   rose_util::AppendExprStatement(
       cur_scope, BuildTraceStencilPre(sb::buildStringVal(sj.str())));
+  // Pass the performance model of each stencil
+  ENUMERATE (i, it, run->stencils().begin(), run->stencils().end()) {
+    StencilMap *s = it->second;
+    // Stencils are passed as pointers in some targets
+    string stencil_name = "s" + toString(i);
+    SgVariableSymbol *vs =
+        si::lookupVariableSymbolInParentScopes(stencil_name, cur_scope);
+    SgExpression *stencil = sb::buildVarRefExp(stencil_name, cur_scope);
+    SgExpression *field = sb::buildVarRefExp(GetStencilDomName(),
+                                             s->GetStencilTypeDefinition());
+    SgExpression *dom = (vs && si::isPointerType(vs->get_type())) ?
+        (SgExpression*)sb::buildArrowExp(stencil, field) :
+        (SgExpression*)sb::buildDotExp(stencil, field);
+    SgExprStatement *model = sb::buildExprStatement(
+        BuildTraceStencilModel(sb::buildAddressOfOp(dom), s->getNumDim(),
+                               sb::buildVarRefExp("iter", cur_scope),
+                               s->performance_model()));
+    si::attachComment(model, s->getKernel()->get_name().str() + ": " +
+                      s->performance_model().toString());
+    si::appendStatement(model, cur_scope);
+  }
   // Declare a stopwatch
   SgVariableDeclaration *st_decl = BuildStopwatch("st", cur_scope, global_scope_);
   si::appendStatement(st_decl, cur_scope);
@@ -1020,9 +1286,200 @@ SgFunctionDeclaration *ReferenceTranslator::BuildReduceGrid(Reduce *rd) {
   return NULL;
 }
 
-void ReferenceTranslator::TranslateReduceKernel(Reduce *rd) {
-  LOG_ERROR() << "Not implemented yet.";
+// Returns the identity of a reduction operator.
+static SgExpression *BuildReduceIdentity(PSReduceOp op, SgType *type,
+                                         SgScopeStatement *scope) {
+  string max_name = isSgTypeFloat(type) ? "FLT_MAX" : "DBL_MAX";
+  switch (op) {
+    case PS_MAX:
+      return sb::buildMinusOp(sb::buildOpaqueVarRefExp(max_name, scope));
+    case PS_MIN:
+      return sb::buildOpaqueVarRefExp(max_name, scope);
+    case PS_SUM:
+      return sb::buildIntVal(0);
+    case PS_PROD:
+      return sb::buildIntVal(1);
+  }
+  LOG_ERROR() << "Unsupported reduction operator: " << op << "\n";
   PSAbort(1);
+  return NULL;
+}
+
+// Returns the OpenMP reduction identifier of an operator.
+static string GetReduceOMPIdentifier(PSReduceOp op) {
+  switch (op) {
+    case PS_MAX: return "max";
+    case PS_MIN: return "min";
+    case PS_SUM: return "+";
+    case PS_PROD: return "*";
+  }
+  return "";
+}
+
+// Appends statements accumulating value into acc.
+static void AppendReduceAccumulation(PSReduceOp op,
+                                     SgVariableDeclaration *acc,
+                                     SgExpression *value,
+                                     SgScopeStatement *scope) {
+  if (op == PS_SUM) {
+    rose_util::AppendExprStatement(
+        scope, sb::buildPlusAssignOp(sb::buildVarRefExp(acc), value));
+    return;
+  } else if (op == PS_PROD) {
+    rose_util::AppendExprStatement(
+        scope, sb::buildMultAssignOp(sb::buildVarRefExp(acc), value));
+    return;
+  }
+  // The kernel value is evaluated once to a temporary for max/min.
+  SgType *type = acc->get_variables()[0]->get_type();
+  SgVariableDeclaration *t = rose_util::buildVarDecl("t", type, value,
+                                                     scope);
+  SgExpression *cond = (op == PS_MAX) ?
+      (SgExpression*)sb::buildGreaterThanOp(sb::buildVarRefExp(t),
+                                            sb::buildVarRefExp(acc)) :
+      (SgExpression*)sb::buildLessThanOp(sb::buildVarRefExp(t),
+                                         sb::buildVarRefExp(acc));
+  si::appendStatement(
+      sb::buildIfStmt(sb::buildExprStatement(cond),
+                      sb::buildAssignStatement(sb::buildVarRefExp(acc),
+                                               sb::buildVarRefExp(t)),
+                      NULL),
+      scope);
+}
+
+SgFunctionDeclaration *ReferenceTranslator::BuildReduceKernel(Reduce *rd) {
+  StencilMap *s = tx_->findMap(rd->reduce_call());
+  PSAssert(s);
+  PSReduceOp op;
+  if (!rd->GetStaticOp(op)) {
+    LOG_ERROR() << "Reduction operator must be a constant: "
+                << rd->reduce_call()->unparseToString() << "\n";
+    PSAbort(1);
+  }
+  SgType *elm_type = s->getKernel()->get_type()->get_return_type();
+  SgType *base_type = elm_type->stripTypedefsAndModifiers();
+  if (!(isSgTypeFloat(base_type) || isSgTypeDouble(base_type))) {
+    LOG_ERROR() << "Unsupported reduction kernel type: "
+                << elm_type->unparseToString() << "\n";
+    PSAbort(1);
+  }
+
+  SgFunctionParameterList *parlist = sb::buildFunctionParameterList();
+  SgType *stencil_type =
+      sb::buildConstType(sb::buildPointerType(
+          sb::buildConstType(s->stencil_type())));
+  SgInitializedName *stencil_param =
+      sb::buildInitializedName(getStencilArgName(), stencil_type);
+  si::appendArg(parlist, stencil_param);
+  SgFunctionDeclaration *reduce_func =
+      sb::buildDefiningFunctionDeclaration(s->getReduceName(),
+                                           elm_type, parlist,
+                                           global_scope_);
+  rose_util::SetFunctionStatic(reduce_func);
+  si::attachComment(reduce_func, "Generated by " + string(__FUNCTION__));
+
+  // Generate code like this
+  // float v = 0;
+  // #pragma omp parallel for reduction(+:v) -- with OPT_OPENMP
+  // for (int k = dom.local_min[2]; k < dom.local_max[2]; k++) {
+  //   for (int j = dom.local_min[1]; j < dom.local_max[1]; j++) {
+  //     for (int i = dom.local_min[0]; i < dom.local_max[0]; i++) {
+  //       v += kernel(i, j, k, g);
+  //     }
+  //   }
+  // }
+  // return v;
+  // The kernel values are never stored to memory; with OpenMP, each
+  // thread accumulates its own partial, which is combined at the end.
+  SgBasicBlock *block = sb::buildBasicBlock();
+  SgVariableDeclaration *acc =
+      rose_util::buildVarDecl("v", elm_type,
+                              BuildReduceIdentity(op, base_type, block),
+                              block);
+  SgExpressionPtrList indexArgs;
+  SgBasicBlock *innerMostBlock = NULL;
+  SgVariableDeclaration *indexDecl = NULL;
+  SgStatement *loopStatement = NULL;
+  for (int i = 0; i < s->getNumDim(); i++) {
+    SgBasicBlock *innerBlock = sb::buildBasicBlock();
+    if (!innerMostBlock) innerMostBlock = innerBlock;
+    if (indexDecl) {
+      si::appendStatement(indexDecl, innerBlock);
+      si::appendStatement(loopStatement, innerBlock);
+    }
+    indexDecl =
+        sb::buildVariableDeclaration(getLoopIndexName(i),
+                                     sb::buildUnsignedIntType(),
+                                     NULL, block);
+    indexArgs.push_back(sb::buildVarRefExp(indexDecl));
+    SgStatement *init =
+        sb::buildAssignStatement(
+            sb::buildVarRefExp(indexDecl),
+            BuildStencilDomMinRef(sb::buildVarRefExp(stencil_param), i));
+    SgStatement *test =
+        sb::buildExprStatement(
+            sb::buildLessThanOp(
+                sb::buildVarRefExp(indexDecl),
+                BuildStencilDomMaxRef(sb::buildVarRefExp(stencil_param),
+                                      i)));
+    SgExpression *incr = sb::buildPlusPlusOp(
+        sb::buildVarRefExp(indexDecl));
+    loopStatement = sb::buildForStatement(init, test, incr, innerBlock);
+  }
+  si::appendStatement(indexDecl, block);
+  // Parallelized only with OPT_OPENMP like the loops of stencil maps
+  if (config_.LookupFlag("OPT_OPENMP")) {
+    si::appendStatement(
+        sb::buildPragmaDeclaration(
+            "omp parallel for reduction(" + GetReduceOMPIdentifier(op)
+            + ":v)", block),
+        block);
+  }
+  si::appendStatement(loopStatement, block);
+
+  AppendReduceAccumulation(op, acc,
+                           BuildKernelCall(s, indexArgs, stencil_param),
+                           innerMostBlock);
+  si::appendStatement(sb::buildReturnStmt(sb::buildVarRefExp(acc)),
+                      block);
+  rose_util::ReplaceFuncBody(reduce_func, block);
+  return reduce_func;
+}
+
+void ReferenceTranslator::TranslateReduceKernel(Reduce *rd) {
+  SgFunctionCallExp *original_rdcall = rd->reduce_call();
+  StencilMap *s = tx_->findMap(original_rdcall);
+  PSAssert(s);
+  SgFunctionDeclaration *reduce_func = BuildReduceKernel(rd);
+  si::insertStatementBefore(getContainingFunction(original_rdcall),
+                            reduce_func);
+
+  // Generate code like this
+  // {
+  //   __PSStencil_kernel s = __PSStencilMap_kernel(dom, g);
+  //   *(&v) = __PSStencilReduce_kernel_0(&s);
+  // }
+  SgBasicBlock *tmp_block = sb::buildBasicBlock();
+  SgExpressionPtrList &args = original_rdcall->get_args()->get_expressions();
+  SgExprListExp *map_args = sb::buildExprListExp();
+  FOREACH (it, args.begin() + s->GetKernelArgIndex() + 1, args.end()) {
+    si::appendExpression(map_args, si::copyExpression(*it));
+  }
+  SgVariableDeclaration *sdecl =
+      rose_util::buildVarDecl(
+          "s", s->stencil_type(),
+          sb::buildFunctionCallExp(rose_util::getFunctionSymbol(s->getFunc()),
+                                   map_args),
+          tmp_block);
+  SgExpression *reduce_exp = sb::buildFunctionCallExp(
+      rose_util::getFunctionSymbol(reduce_func),
+      sb::buildExprListExp(sb::buildAddressOfOp(sb::buildVarRefExp(sdecl))));
+  si::appendStatement(
+      sb::buildAssignStatement(
+          sb::buildPointerDerefExp(si::copyExpression(args[0])),
+          reduce_exp),
+      tmp_block);
+  si::replaceStatement(getContainingStatement(original_rdcall), tmp_block);
 }
 
 void ReferenceTranslator::FixGridType() {
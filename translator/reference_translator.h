@@ -43,6 +43,10 @@ class ReferenceTranslator : public Translator {
 
  protected:
   bool validate_ast_;
+  //! Number of iterations fused by temporal blocking; 0 disables it.
+  int temporal_blocking_steps_;
+  //! Number of planes of the outermost dimension in a tile.
+  int temporal_blocking_size_;
   //! Fixes inconsistency in AST.
   virtual void FixAST();
   //! Validates AST consistency.
@@ -107,6 +111,24 @@ class ReferenceTranslator : public Translator {
       SgInitializedName *stencil_param);
   virtual void defineMapSpecificTypesAndFunctions();
   virtual SgBasicBlock *BuildRunBody(Run *run);
+  //! Returns true if the stencils of a run can be temporally blocked.
+  /*!
+    \param run The stencil run.
+    \param radius Set to the maximum offset of the neighbor accesses
+    along the outermost dimension.
+    \return True if eligible.
+   */
+  virtual bool IsTemporalBlockingEligible(Run *run, int &radius);
+  //! Builds the body of a run function with temporal blocking.
+  /*!
+    Fuses temporal_blocking_steps_ iterations by sweeping
+    time-skewed tiles along the outermost dimension.
+    \param run The stencil run.
+    \param radius The stencil radius along the outermost dimension.
+    \return The body of the run function.
+   */
+  virtual SgBasicBlock *BuildTemporallyBlockedRunBody(Run *run,
+                                                       int radius);
   virtual SgFunctionDeclaration *GenerateRun(Run *run);
   virtual void translateRun(SgFunctionCallExp *node, Run *run);
 
@@ -118,6 +140,15 @@ class ReferenceTranslator : public Translator {
     \return A function declaration for reducing the grid.
    */
   virtual SgFunctionDeclaration *BuildReduceGrid(Reduce *rd);
+  //! Build a function reducing the values of a kernel.
+  /*!
+    The kernel is evaluated at each point of the local domain of the
+    stencil, and its values are accumulated without being stored to
+    any grid.
+    \param rd A reduction of kernel.
+    \return A function declaration returning the reduced value.
+   */
+  virtual SgFunctionDeclaration *BuildReduceKernel(Reduce *rd);
 
   virtual void optimizeConstantSizedGrids();
   string grid_create_name_;
@@ -30,6 +30,19 @@ SgFunctionCallExp *BuildTraceStencilPost(SgExpression *time) {
   return fc;
 }
 
+SgFunctionCallExp *BuildTraceStencilModel(SgExpression *dom, int num_dims,
+                                          SgExpression *iter,
+                                          const StencilPerformanceModel &pm) {
+  SgFunctionSymbol *fs
+      = si::lookupFunctionSymbolInParentScopes("__PSTraceStencilModel");
+  SgFunctionCallExp *fc =
+      sb::buildFunctionCallExp(
+          fs, sb::buildExprListExp(dom, sb::buildIntVal(num_dims), iter,
+                                   sb::buildDoubleVal(pm.num_flops),
+                                   sb::buildDoubleVal(pm.num_bytes)));
+  return fc;
+}
+
 SgVariableDeclaration *BuildStopwatch(const std::string &name,
                                       SgScopeStatement *scope,
                                       SgScopeStatement *global_scope) {
@@ -20,6 +20,16 @@ namespace translator {
 
 SgFunctionCallExp *BuildTraceStencilPre(SgExpression *msg);
 SgFunctionCallExp *BuildTraceStencilPost(SgExpression *time);
+//! Build a call to __PSTraceStencilModel.
+/*!
+  \param dom Pointer to the domain of the stencil.
+  \param num_dims Number of dimensions of the domain.
+  \param iter Number of iterations.
+  \param pm Performance model of the stencil.
+ */
+SgFunctionCallExp *BuildTraceStencilModel(SgExpression *dom, int num_dims,
+                                          SgExpression *iter,
+                                          const StencilPerformanceModel &pm);
 
 SgVariableDeclaration *BuildStopwatch(const std::string &name,
                                       SgScopeStatement *scope,
@@ -255,5 +255,41 @@ void AnalyzeStencilRange(StencilMap &sm, TranslationContext &tx) {
 }
 #endif
 
+// Returns true if e is a floating-point arithmetic operation.
+static bool IsFlop(SgBinaryOp *e) {
+  if (!(isSgAddOp(e) || isSgSubtractOp(e) || isSgMultiplyOp(e) ||
+        isSgDivideOp(e) || isSgPlusAssignOp(e) || isSgMinusAssignOp(e) ||
+        isSgMultAssignOp(e) || isSgDivAssignOp(e))) {
+    return false;
+  }
+  SgType *ty = e->get_type()->stripTypedefsAndModifiers();
+  return isSgTypeFloat(ty) || isSgTypeDouble(ty);
+}
+
+void AnalyzeStencilPerformance(StencilMap &sm, TranslationContext &tx) {
+  SgFunctionDeclaration *kernel = sm.getKernel();
+  SgFunctionDefinition *def = kernel->get_definition();
+  StencilPerformanceModel &pm = sm.performance_model();
+  pm = StencilPerformanceModel();
+  pm.num_loads = tx.getGridGetCalls(def).size()
+      + tx.getGridGetPeriodicCalls(def).size();
+  pm.num_stores = tx.getGridEmitCalls(def).size();
+  vector<SgBinaryOp*> ops = si::querySubTree<SgBinaryOp>(def, V_SgBinaryOp);
+  FOREACH (it, ops.begin(), ops.end()) {
+    if (IsFlop(*it)) ++pm.num_flops;
+  }
+  Kernel *k = tx.findKernel(kernel);
+  FOREACH (it, sm.grid_params().begin(), sm.grid_params().end()) {
+    SgInitializedName *gv = *it;
+    GridType *gt = tx.findGridType(gv);
+    int elm_size = isSgTypeFloat(gt->elm_type()) ?
+        sizeof(float) : sizeof(double);
+    if (k->isGridParamRead(gv)) pm.num_bytes += elm_size;
+    if (k->isGridParamModified(gv)) pm.num_bytes += elm_size;
+  }
+  LOG_INFO() << "Performance model of " << kernel->get_name().str()
+             << ": " << pm.toString() << "\n";
+}
+
 } // namespace translator
 } // namespace physis
@@ -18,6 +18,11 @@ namespace translator {
 bool AnalyzeStencilIndex(SgExpression *arg, StencilIndex &idx,
                          SgFunctionDeclaration *kernel);
 void AnalyzeStencilRange(StencilMap &sm, TranslationContext &tx);
+//! Count the operations and bytes per point of a stencil.
+/*!
+  Sets the performance model of the stencil map.
+ */
+void AnalyzeStencilPerformance(StencilMap &sm, TranslationContext &tx);
 
 } // namespace translator
 } // namespace physis
@@ -206,7 +206,7 @@ static bool propagateGridVarMapAcrossStencilCall(SgFunctionCallExp *c,
                                                  TranslationContext &tx) {
   LOG_DEBUG() << "StencilMap: " << m->getKernel()->get_name().str() << "\n";
   SgExpressionPtrList args(
-      c->get_args()->get_expressions().begin() + 2,
+      c->get_args()->get_expressions().begin() + m->GetKernelArgIndex() + 2,
       c->get_args()->get_expressions().end());
   SgInitializedNamePtrList params(
       m->getKernel()->get_args().begin() + m->getNumDim(),
@@ -289,7 +289,7 @@ void TranslationContext::analyzeGridVars(DefUseAnalysis &dua) {
                                       aop->get_rhs_operand(),
                                       *this);
     }
-    // Handle stencil map
+    // Handle stencil maps and kernel reductions
     FOREACH(it, mapBegin(), mapEnd()) {
       SgFunctionCallExp *c = isSgFunctionCallExp(it->first);
       if (!c) continue;
@@ -297,9 +297,6 @@ void TranslationContext::analyzeGridVars(DefUseAnalysis &dua) {
       changed |= propagateGridVarMapAcrossStencilCall(c, m, *this);
     }
     
-    // Note: grids are read-only in reduction kernels, so no need to
-    // analyze them
-    
     // Handle normal function call
     FOREACH (it, calls.begin(), calls.end()) {
       SgFunctionCallExp *c = isSgFunctionCallExp(*it);
@@ -422,6 +419,7 @@ void TranslationContext::build() {
   
   FOREACH (it, stencil_map_.begin(), stencil_map_.end()) {
     AnalyzeStencilRange(*(it->second), *this);
+    AnalyzeStencilPerformance(*(it->second), *this);
   }
 
   LOG_INFO() << "Translation context built\n";
@@ -816,6 +814,11 @@ void TranslationContext::AnalyzeReduce() {
                 << call->unparseToString() << "\n";
     Reduce *rd = new Reduce(call);
     rose_util::AddASTAttribute(call, rd);
+    // Kernel reductions are analyzed just like stencil maps so that
+    // the kernel and its grid accesses are translated as such.
+    if (rd->IsKernel()) {
+      registerMap(call, new StencilMap(call, this));
+    }
   }
   LOG_INFO() << "Reduction analysis done.\n";  
 }
@@ -185,6 +185,18 @@ void Translator::Visit(SgFunctionCallExp *node) {
     return;
   }
 
+  // Kernel reductions are also registered as maps, so this must
+  // precede the check for maps.
+  Reduce *rd = rose_util::GetASTAttribute<Reduce>(node);
+  if (rd) {
+    LOG_DEBUG() << "Translating Reduce\n";
+    LOG_DEBUG() << node->unparseToString() << "\n";
+    if (rd->IsGrid()) TranslateReduceGrid(rd);
+    else TranslateReduceKernel(rd);
+    setSkipChildren();
+    return;
+  }
+
   if (tx_->isMap(node)) {
     LOG_DEBUG() << "Translating map\n";
     LOG_DEBUG() << node->unparseToString() << "\n";
@@ -209,16 +221,6 @@ void Translator::Visit(SgFunctionCallExp *node) {
     return;
   }
 
-  Reduce *rd = rose_util::GetASTAttribute<Reduce>(node);
-  if (rd) {
-    LOG_DEBUG() << "Translating Reduce\n";
-    LOG_DEBUG() << node->unparseToString() << "\n";
-    if (rd->IsGrid()) TranslateReduceGrid(rd);
-    else TranslateReduceKernel(rd);
-    setSkipChildren();
-    return;
-  }
-
   // This is not related to physis grids; leave it as is
   return;
 }